@@ -64,6 +64,7 @@
 #include "nautilus-shell-search-provider.h"
 #include "nautilus-signaller.h"
 #include "nautilus-tag-manager.h"
+#include "nautilus-thumbnail-warmup.h"
 #include "nautilus-localsearch-utilities.h"
 #include "nautilus-trash-monitor.h"
 #include "nautilus-ui-utilities.h"
@@ -508,6 +509,14 @@ do_cmdline_sanity_checks (GVariantDict *options)
         return FALSE;
     }
 
+    if (g_variant_dict_contains (options, "generate-thumbnails") &&
+        !g_variant_dict_contains (options, G_OPTION_REMAINING))
+    {
+        g_printerr ("%s\n",
+                    _("--generate-thumbnails must be used with at least an URI."));
+        return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -795,6 +804,119 @@ nautilus_application_handle_file_args (NautilusApplication *self,
     return EXIT_SUCCESS;
 }
 
+typedef struct
+{
+    NautilusApplication *self;
+    GApplicationCommandLine *command_line;
+    GPtrArray *roots;
+    guint next_root;
+    gint64 last_progress_time;
+    gboolean failed;
+} ThumbnailWarmupData;
+
+static void thumbnail_warmup_next (ThumbnailWarmupData *data);
+
+static void
+thumbnail_warmup_progress_cb (GFile    *file,
+                              guint     n_done,
+                              guint     n_found,
+                              gpointer  user_data)
+{
+    ThumbnailWarmupData *data = user_data;
+    gint64 now = g_get_monotonic_time ();
+
+    /* Don't flood the invoking terminal, it's reached over D-Bus */
+    if (now - data->last_progress_time < G_USEC_PER_SEC)
+    {
+        return;
+    }
+
+    data->last_progress_time = now;
+    g_application_command_line_print (data->command_line,
+                                      _("%u of %u files processed\n"),
+                                      n_done, n_found);
+}
+
+static void
+thumbnail_warmup_done_cb (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+    ThumbnailWarmupData *data = user_data;
+    GFile *root = g_ptr_array_index (data->roots, data->next_root - 1);
+    g_autofree char *uri = g_file_get_uri (root);
+    g_autoptr (GError) error = NULL;
+    guint n_generated = 0;
+
+    if (nautilus_thumbnail_warmup_finish (result, &n_generated, &error))
+    {
+        g_application_command_line_print (data->command_line,
+                                          _("%s: %u thumbnails generated\n"),
+                                          uri, n_generated);
+    }
+    else
+    {
+        g_application_command_line_printerr (data->command_line,
+                                             "%s: %s\n", uri, error->message);
+        data->failed = TRUE;
+    }
+
+    thumbnail_warmup_next (data);
+}
+
+static void
+thumbnail_warmup_next (ThumbnailWarmupData *data)
+{
+    if (data->next_root < data->roots->len)
+    {
+        GFile *root = g_ptr_array_index (data->roots, data->next_root);
+
+        data->next_root += 1;
+        nautilus_thumbnail_warmup_async (root, NULL,
+                                         thumbnail_warmup_progress_cb, data,
+                                         thumbnail_warmup_done_cb, data);
+        return;
+    }
+
+    g_application_command_line_set_exit_status (data->command_line,
+                                                data->failed ? EXIT_FAILURE : EXIT_SUCCESS);
+    g_application_release (G_APPLICATION (data->self));
+
+    g_object_unref (data->command_line);
+    g_ptr_array_unref (data->roots);
+    g_free (data);
+}
+
+/* Generates the missing thumbnails of the given folders, one after the other.
+ * The invoking command line stays around until done, to report progress. */
+static gint
+nautilus_application_generate_thumbnails (NautilusApplication     *self,
+                                          GApplicationCommandLine *command_line,
+                                          GVariantDict            *options)
+{
+    g_autofree const char **remaining = NULL;
+    ThumbnailWarmupData *data;
+
+    g_variant_dict_lookup (options, G_OPTION_REMAINING, "^a&s", &remaining);
+
+    data = g_new0 (ThumbnailWarmupData, 1);
+    data->self = self;
+    data->command_line = g_object_ref (command_line);
+    data->roots = g_ptr_array_new_with_free_func (g_object_unref);
+
+    for (guint i = 0; remaining[i] != NULL; i++)
+    {
+        g_ptr_array_add (data->roots,
+                         g_application_command_line_create_file_for_arg (command_line,
+                                                                         remaining[i]));
+    }
+
+    g_application_hold (G_APPLICATION (self));
+    thumbnail_warmup_next (data);
+
+    return EXIT_SUCCESS;
+}
+
 static gint
 nautilus_application_command_line (GApplication            *application,
                                    GApplicationCommandLine *command_line)
@@ -819,6 +941,10 @@ nautilus_application_command_line (GApplication            *application,
                                         "kill", NULL);
         return -1;
     }
+    else if (g_variant_dict_contains (options, "generate-thumbnails"))
+    {
+        return nautilus_application_generate_thumbnails (self, command_line, options);
+    }
     else
     {
         return nautilus_application_handle_file_args (self, options);
@@ -846,6 +972,10 @@ nautilus_application_init (NautilusApplication *self)
             "select", 's', 0, G_OPTION_ARG_NONE, NULL,
             N_("Select specified URI in parent folder."), NULL
         },
+        {
+            "generate-thumbnails", '\0', 0, G_OPTION_ARG_NONE, NULL,
+            N_("Generate missing thumbnails for the files in the specified folders."), NULL
+        },
         { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, NULL, NULL, N_("[URI…]") },
 
         /* The following are old options which have no effect anymore. We keep
@@ -45,6 +45,9 @@
 /* Keep async. jobs down to this number for all directories. */
 #define MAX_ASYNC_JOBS 10
 
+/* Most local files queried in one go by a single "file info" job. */
+#define GET_INFO_BATCH_SIZE 256
+
 struct ThumbnailInfoState
 {
     NautilusDirectory *directory;
@@ -80,12 +83,45 @@ struct DirectoryLoadState
     GFileEnumerator *enumerator;
     NautilusFile *load_directory_file;
     int load_file_count;
+
+    /* Fingerprint of the listing, see DirectoryPollState */
+    guint n_children;
+    guint names_hash;
+};
+
+struct DirectoryPollState
+{
+    NautilusDirectory *directory;
+    GCancellable *cancellable;
+    guint timeout_id;
+    gboolean in_flight;
+
+    /* Fingerprint from the last poll or load. Loads don't know the
+     * modification time, which is then only compared from the next poll. */
+    gboolean has_fingerprint;
+    gboolean has_mtime;
+    guint64 mtime;
+    guint n_children;
+    guint names_hash;
 };
 
+typedef struct
+{
+    guint64 mtime;
+    guint n_children;
+    guint names_hash;
+} DirectoryFingerprint;
+
 struct GetInfoState
 {
     NautilusDirectory *directory;
     GCancellable *cancellable;
+
+    /* Only used when several local files are queried in one batch. */
+    GPtrArray *files;
+    GPtrArray *locations;
+    GPtrArray *infos;
+    GPtrArray *errors;
 };
 
 struct NewFilesState
@@ -659,6 +695,266 @@ mime_db_changed_callback (GObject           *ignore,
     nautilus_directory_force_reload_internal (dir, NAUTILUS_ATTRIBUTE_INFO);
 }
 
+static void directory_poll_schedule (DirectoryPollState *state);
+
+static void
+directory_fingerprint_thread (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
+{
+    GFile *location = source_object;
+    g_autofree DirectoryFingerprint *fingerprint = g_new0 (DirectoryFingerprint, 1);
+    g_autoptr (GFileInfo) info = NULL;
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    GError *error = NULL;
+
+    info = g_file_query_info (location, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                              G_FILE_QUERY_INFO_NONE, cancellable, &error);
+    if (info == NULL)
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+    fingerprint->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+    /* Listing just the names is much cheaper than a reload, and catches
+     * servers which don't update the modification time of folders. */
+    enumerator = g_file_enumerate_children (location, G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                            G_FILE_QUERY_INFO_NONE, cancellable, &error);
+    if (enumerator == NULL)
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    while (TRUE)
+    {
+        GFileInfo *child_info;
+
+        if (!g_file_enumerator_iterate (enumerator, &child_info, NULL, cancellable, &error))
+        {
+            g_task_return_error (task, error);
+            return;
+        }
+        if (child_info == NULL)
+        {
+            break;
+        }
+
+        fingerprint->n_children++;
+        /* Order independent, as servers may list in any order. */
+        fingerprint->names_hash += g_str_hash (g_file_info_get_name (child_info));
+    }
+
+    g_task_return_pointer (task, g_steal_pointer (&fingerprint), g_free);
+}
+
+static void
+directory_fingerprint_callback (GObject      *source_object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+    DirectoryPollState *state = user_data;
+    NautilusDirectory *directory = state->directory;
+    g_autofree DirectoryFingerprint *fingerprint = NULL;
+    gboolean changed;
+
+    fingerprint = g_task_propagate_pointer (G_TASK (result), NULL);
+    state->in_flight = FALSE;
+
+    if (directory == NULL)
+    {
+        /* Polling was stopped. */
+        g_object_unref (state->cancellable);
+        g_free (state);
+        return;
+    }
+
+    if (fingerprint == NULL)
+    {
+        /* Try again later, e.g. the connection may come back. */
+        directory_poll_schedule (state);
+        return;
+    }
+
+    changed = state->has_fingerprint &&
+              ((state->has_mtime && fingerprint->mtime != state->mtime) ||
+               fingerprint->n_children != state->n_children ||
+               fingerprint->names_hash != state->names_hash);
+
+    state->has_fingerprint = TRUE;
+    state->has_mtime = TRUE;
+    state->mtime = fingerprint->mtime;
+    state->n_children = fingerprint->n_children;
+    state->names_hash = fingerprint->names_hash;
+
+    if (changed)
+    {
+        if (nautilus_directory_is_monitoring_suspended (directory))
+        {
+            directory->details->changed_while_suspended = TRUE;
+        }
+        else
+        {
+            nautilus_directory_force_reload_internal (directory, 0);
+        }
+    }
+
+    directory_poll_schedule (state);
+}
+
+static gboolean
+directory_poll_timeout_callback (gpointer user_data)
+{
+    DirectoryPollState *state = user_data;
+    NautilusDirectory *directory = state->directory;
+    g_autoptr (GTask) task = NULL;
+
+    state->timeout_id = 0;
+
+    if (directory->details->directory_load_in_progress != NULL)
+    {
+        /* A load in progress will pick up any change anyway. */
+        directory_poll_schedule (state);
+        return G_SOURCE_REMOVE;
+    }
+
+    state->in_flight = TRUE;
+    task = g_task_new (directory->details->location, state->cancellable,
+                       directory_fingerprint_callback, state);
+    g_task_set_source_tag (task, directory_poll_timeout_callback);
+    g_task_set_priority (task, G_PRIORITY_LOW);
+    g_task_run_in_thread (task, directory_fingerprint_thread);
+
+    return G_SOURCE_REMOVE;
+}
+
+static guint
+get_remote_poll_interval (void)
+{
+    return g_settings_get_uint (nautilus_preferences,
+                                NAUTILUS_PREFERENCES_REMOTE_POLL_INTERVAL);
+}
+
+static void
+directory_poll_schedule (DirectoryPollState *state)
+{
+    guint interval = get_remote_poll_interval ();
+
+    if (interval > 0)
+    {
+        state->timeout_id = g_timeout_add_seconds (interval,
+                                                   directory_poll_timeout_callback,
+                                                   state);
+    }
+}
+
+/* Remote locations whose backend can't monitor changes are polled instead.
+ * Each poll computes a cheap fingerprint of the directory and only reloads
+ * it, diffing against the known files, if the fingerprint changed. The
+ * reference fingerprint is taken by the load of the directory.
+ */
+static void
+directory_poll_start (NautilusDirectory *directory)
+{
+    DirectoryPollState *state;
+
+    if (directory->details->poll_state != NULL ||
+        get_remote_poll_interval () == 0 ||
+        g_file_is_native (directory->details->location) ||
+        nautilus_monitor_is_active (directory->details->monitor))
+    {
+        return;
+    }
+
+    state = g_new0 (DirectoryPollState, 1);
+    state->directory = directory;
+    state->cancellable = g_cancellable_new ();
+    directory->details->poll_state = state;
+
+    if (directory->details->directory_loaded &&
+        directory->details->directory_load_in_progress == NULL)
+    {
+        /* No load is coming to take the reference, so take it now. */
+        state->timeout_id = g_idle_add (directory_poll_timeout_callback, state);
+    }
+    else
+    {
+        directory_poll_schedule (state);
+    }
+}
+
+static void
+directory_poll_cancel (NautilusDirectory *directory)
+{
+    DirectoryPollState *state = directory->details->poll_state;
+
+    if (state == NULL)
+    {
+        return;
+    }
+
+    directory->details->poll_state = NULL;
+    state->directory = NULL;
+
+    if (state->in_flight)
+    {
+        /* Freed by directory_fingerprint_callback */
+        g_cancellable_cancel (state->cancellable);
+    }
+    else
+    {
+        g_clear_handle_id (&state->timeout_id, g_source_remove);
+        g_object_unref (state->cancellable);
+        g_free (state);
+    }
+}
+
+static void
+directory_poll_set_reference (NautilusDirectory *directory,
+                              guint              n_children,
+                              guint              names_hash)
+{
+    DirectoryPollState *state = directory->details->poll_state;
+
+    if (state == NULL)
+    {
+        return;
+    }
+
+    state->has_fingerprint = TRUE;
+    state->has_mtime = FALSE;
+    state->n_children = n_children;
+    state->names_hash = names_hash;
+}
+
+/* Called when the remote-poll-interval preference changes. */
+void
+nautilus_directory_remote_poll_interval_changed (NautilusDirectory *directory)
+{
+    DirectoryPollState *state = directory->details->poll_state;
+
+    if (directory->details->monitor == NULL)
+    {
+        return;
+    }
+
+    if (state == NULL)
+    {
+        directory_poll_start (directory);
+    }
+    else if (get_remote_poll_interval () == 0)
+    {
+        directory_poll_cancel (directory);
+    }
+    else if (!state->in_flight)
+    {
+        g_clear_handle_id (&state->timeout_id, g_source_remove);
+        directory_poll_schedule (state);
+    }
+}
+
 void
 nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
                                          NautilusFile              *file,
@@ -706,6 +1002,7 @@ nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
     if (directory->details->monitor == NULL && file == NULL)
     {
         directory->details->monitor = nautilus_monitor_directory (directory->details->location);
+        directory_poll_start (directory);
     }
 
 
@@ -752,10 +1049,12 @@ set_file_unconfirmed (NautilusFile *file,
     if (unconfirmed)
     {
         directory->details->confirmed_file_count--;
+        g_hash_table_add (directory->details->unconfirmed_files, file);
     }
     else
     {
         directory->details->confirmed_file_count++;
+        g_hash_table_remove (directory->details->unconfirmed_files, file);
     }
 }
 
@@ -815,7 +1114,7 @@ static gboolean
 dequeue_pending_idle_callback (gpointer callback_data)
 {
     g_autoptr (NautilusDirectory) directory = nautilus_directory_ref (callback_data);
-    GList *node, *next;
+    GList *node;
     NautilusFile *file;
     GList *changed_files, *added_files;
     GFileInfo *file_info;
@@ -897,21 +1196,21 @@ dequeue_pending_idle_callback (gpointer callback_data)
     /* If we are done loading, then we assume that any unconfirmed
      * files are gone.
      */
-    if (directory->details->directory_loaded)
+    if (directory->details->directory_loaded &&
+        g_hash_table_size (directory->details->unconfirmed_files) > 0)
     {
-        for (node = directory->details->file_list;
-             node != NULL; node = next)
+        g_autoptr (NautilusFileList) gone_files = NULL;
+
+        /* Marking a file gone removes it from the set, so walk a copy. */
+        gone_files = g_hash_table_get_keys (directory->details->unconfirmed_files);
+        for (node = gone_files; node != NULL; node = node->next)
         {
             file = NAUTILUS_FILE (node->data);
-            next = node->next;
 
-            if (file->details->unconfirmed)
-            {
-                nautilus_file_ref (file);
-                changed_files = g_list_prepend (changed_files, file);
+            nautilus_file_ref (file);
+            changed_files = g_list_prepend (changed_files, file);
 
-                nautilus_file_mark_gone (file);
-            }
+            nautilus_file_mark_gone (file);
         }
     }
 
@@ -1050,8 +1349,10 @@ directory_load_done (NautilusDirectory *directory,
          * they won't be marked "gone" later -- we don't know enough
          * about them to know whether they are really gone.
          */
-        for (node = directory->details->file_list;
-             node != NULL; node = node->next)
+        g_autoptr (NautilusFileList) unconfirmed_files = NULL;
+
+        unconfirmed_files = g_hash_table_get_keys (directory->details->unconfirmed_files);
+        for (node = unconfirmed_files; node != NULL; node = node->next)
         {
             set_file_unconfirmed (NAUTILUS_FILE (node->data), FALSE);
         }
@@ -1087,6 +1388,7 @@ nautilus_directory_monitor_remove_internal (NautilusDirectory *directory,
     {
         nautilus_monitor_cancel (directory->details->monitor);
         directory->details->monitor = NULL;
+        directory_poll_cancel (directory);
     }
 
     /* XXX - do we need to remove anything from the work queue? */
@@ -1674,16 +1976,14 @@ has_problem (NautilusDirectory *directory,
              NautilusFile      *file,
              FileCheck          problem)
 {
-    GList *node;
-
     if (file != NULL)
     {
         return (*problem)(file);
     }
 
-    for (node = directory->details->file_list; node != NULL; node = node->next)
+    for (guint i = 0; i < directory->details->files->len; i++)
     {
-        if ((*problem)(node->data))
+        if ((*problem)(g_ptr_array_index (directory->details->files, i)))
         {
             return TRUE;
         }
@@ -1938,6 +2238,85 @@ nautilus_directory_is_anyone_monitoring_file_list (NautilusDirectory *directory)
     return FALSE;
 }
 
+/* This checks if everyone monitoring the file list has suspended their
+ * monitor, e.g. because they are in a background tab. Changes to such a
+ * directory are only flagged, and picked up by a reload on resume.
+ */
+gboolean
+nautilus_directory_is_monitoring_suspended (NautilusDirectory *directory)
+{
+    GList *monitors;
+
+    if (directory->details->suspended_clients == NULL ||
+        g_hash_table_size (directory->details->suspended_clients) == 0 ||
+        request_counter_has (directory->details->call_when_ready_counters,
+                             NAUTILUS_ATTRIBUTE_FILE_LIST))
+    {
+        return FALSE;
+    }
+
+    monitors = lookup_all_files_monitors (directory->details->monitor_table);
+    if (monitors == NULL)
+    {
+        return FALSE;
+    }
+
+    for (GList *node = monitors; node != NULL; node = node->next)
+    {
+        Monitor *monitor = node->data;
+
+        if (!g_hash_table_contains (directory->details->suspended_clients, monitor->client))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Like nautilus_directory_is_monitoring_suspended(), but a client that
+ * monitors this specific file without being suspended still wants to see
+ * its changes right away.
+ */
+gboolean
+nautilus_directory_is_file_monitoring_suspended (NautilusDirectory *directory,
+                                                 NautilusFile      *file)
+{
+    if (!nautilus_directory_is_monitoring_suspended (directory))
+    {
+        return FALSE;
+    }
+
+    for (GList *node = lookup_monitors (directory->details->monitor_table, file);
+         node != NULL; node = node->next)
+    {
+        Monitor *monitor = node->data;
+
+        if (!g_hash_table_contains (directory->details->suspended_clients, monitor->client))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+void
+nautilus_directory_reconcile_if_resumed (NautilusDirectory *directory)
+{
+    if (!directory->details->changed_while_suspended ||
+        nautilus_directory_is_monitoring_suspended (directory))
+    {
+        return;
+    }
+
+    directory->details->changed_while_suspended = FALSE;
+
+    /* Reloading re-enumerates the directory and compares against the known
+     * files, so only what actually changed gets signalled. */
+    nautilus_directory_force_reload_internal (directory, 0);
+}
+
 /* This checks if the file list being monitored. */
 gboolean
 nautilus_directory_is_file_list_monitored (NautilusDirectory *directory)
@@ -1948,13 +2327,9 @@ nautilus_directory_is_file_list_monitored (NautilusDirectory *directory)
 static void
 mark_all_files_unconfirmed (NautilusDirectory *directory)
 {
-    GList *node;
-    NautilusFile *file;
-
-    for (node = directory->details->file_list; node != NULL; node = node->next)
+    for (guint i = 0; i < directory->details->files->len; i++)
     {
-        file = node->data;
-        set_file_unconfirmed (file, TRUE);
+        set_file_unconfirmed (g_ptr_array_index (directory->details->files, i), TRUE);
     }
 }
 
@@ -2008,12 +2383,22 @@ more_files_callback (GObject      *source_object,
     for (l = files; l != NULL; l = l->next)
     {
         info = l->data;
+        if (g_file_info_get_name (info) != NULL)
+        {
+            state->n_children++;
+            state->names_hash += g_str_hash (g_file_info_get_name (info));
+        }
         directory_load_one (directory, info);
         g_object_unref (info);
     }
 
     if (files == NULL)
     {
+        if (error == NULL)
+        {
+            /* Anything changing from now on is noticed by the next poll. */
+            directory_poll_set_reference (directory, state->n_children, state->names_hash);
+        }
         directory_load_done (directory, error);
         directory_load_state_free (state);
     }
@@ -2089,7 +2474,7 @@ start_monitoring_file_list (NautilusDirectory *directory)
     {
         g_assert (!directory->details->directory_load_in_progress);
         directory->details->file_list_monitored = TRUE;
-        g_list_foreach (directory->details->file_list, (GFunc) nautilus_file_ref, NULL);
+        g_ptr_array_foreach (directory->details->files, (GFunc) nautilus_file_ref, NULL);
     }
 
     if (directory->details->directory_loaded ||
@@ -2141,7 +2526,7 @@ nautilus_directory_stop_monitoring_file_list (NautilusDirectory *directory)
 
     directory->details->file_list_monitored = FALSE;
     file_list_cancel (directory);
-    g_list_foreach (directory->details->file_list, (GFunc) nautilus_file_unref, NULL);
+    g_ptr_array_foreach (directory->details->files, (GFunc) nautilus_file_unref, NULL);
     directory->details->directory_loaded = FALSE;
 }
 
@@ -2189,13 +2574,11 @@ static void
 nautilus_directory_invalidate_attributes (NautilusDirectory  *directory,
                                           NautilusAttributes  attributes)
 {
-    GList *node;
-
     cancel_loading_attributes (directory, attributes);
 
-    for (node = directory->details->file_list; node != NULL; node = node->next)
+    for (guint i = 0; i < directory->details->files->len; i++)
     {
-        nautilus_file_invalidate_attributes_internal (NAUTILUS_FILE (node->data),
+        nautilus_file_invalidate_attributes_internal (g_ptr_array_index (directory->details->files, i),
                                                       attributes);
     }
 
@@ -2928,10 +3311,48 @@ deep_count_start (NautilusDirectory *directory,
 static void
 get_info_state_free (GetInfoState *state)
 {
+    if (state->files != NULL)
+    {
+        g_ptr_array_unref (state->files);
+        g_ptr_array_unref (state->locations);
+
+        for (guint i = 0; i < state->infos->len; i++)
+        {
+            g_clear_object (&g_ptr_array_index (state->infos, i));
+            g_clear_error ((GError **) &g_ptr_array_index (state->errors, i));
+        }
+        g_ptr_array_unref (state->infos);
+        g_ptr_array_unref (state->errors);
+    }
+
     g_object_unref (state->cancellable);
     g_free (state);
 }
 
+/* Takes ownership of @error. */
+static void
+update_file_from_query_info (NautilusFile *file,
+                             GFileInfo    *info,
+                             GError       *error)
+{
+    if (info == NULL)
+    {
+        if (error->domain == G_IO_ERROR && error->code == G_IO_ERROR_NOT_FOUND)
+        {
+            /* mark file as gone */
+            nautilus_file_mark_gone (file);
+        }
+        file->details->file_info_is_up_to_date = TRUE;
+        nautilus_file_clear_info (file);
+        file->details->get_info_failed = TRUE;
+        file->details->get_info_error = error;
+    }
+    else
+    {
+        nautilus_file_update_info (file, info);
+    }
+}
+
 static void
 query_info_callback (GObject      *source_object,
                      GAsyncResult *res,
@@ -2969,26 +3390,95 @@ query_info_callback (GObject      *source_object,
     error = NULL;
     info = g_file_query_info_finish (G_FILE (source_object), res, &error);
 
-    if (info == NULL)
+    update_file_from_query_info (get_info_file, info, error);
+    g_clear_object (&info);
+
+    nautilus_file_changed (get_info_file);
+    nautilus_file_unref (get_info_file);
+
+    async_job_end (directory, "file info");
+    nautilus_directory_async_state_changed (directory);
+
+    nautilus_directory_unref (directory);
+
+    get_info_state_free (state);
+}
+
+static void
+query_info_batch_thread (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+    GetInfoState *state = task_data;
+
+    for (guint i = 0; i < state->locations->len; i++)
     {
-        if (error->domain == G_IO_ERROR && error->code == G_IO_ERROR_NOT_FOUND)
+        GFileInfo *info;
+        GError *error = NULL;
+
+        if (g_cancellable_is_cancelled (cancellable))
         {
-            /* mark file as gone */
-            nautilus_file_mark_gone (get_info_file);
+            break;
         }
-        get_info_file->details->file_info_is_up_to_date = TRUE;
-        nautilus_file_clear_info (get_info_file);
-        get_info_file->details->get_info_failed = TRUE;
-        get_info_file->details->get_info_error = error;
+
+        info = g_file_query_info (g_ptr_array_index (state->locations, i),
+                                  NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
+                                  G_FILE_QUERY_INFO_NONE,
+                                  cancellable, &error);
+        g_ptr_array_add (state->infos, info);
+        g_ptr_array_add (state->errors, error);
     }
-    else
+
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+query_info_batch_callback (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+    NautilusDirectory *directory;
+    GetInfoState *state;
+    g_autoptr (NautilusFileList) changed_files = NULL;
+
+    state = user_data;
+
+    if (state->directory == NULL)
     {
-        nautilus_file_update_info (get_info_file, info);
-        g_object_unref (info);
+        /* Operation was cancelled. Bail out */
+        get_info_state_free (state);
+        return;
     }
 
-    nautilus_file_changed (get_info_file);
-    nautilus_file_unref (get_info_file);
+    directory = nautilus_directory_ref (state->directory);
+
+    directory->details->get_info_file = NULL;
+    directory->details->get_info_in_progress = NULL;
+
+    /* Files the worker didn't get to stay needy and are picked up again. */
+    for (guint i = 0; i < state->infos->len; i++)
+    {
+        NautilusFile *file = g_ptr_array_index (state->files, i);
+        GError *error = g_ptr_array_index (state->errors, i);
+
+        g_ptr_array_index (state->errors, i) = NULL;
+        update_file_from_query_info (file, g_ptr_array_index (state->infos, i), error);
+
+        if (nautilus_file_is_self_owned (file))
+        {
+            nautilus_file_emit_changed (file);
+        }
+        else
+        {
+            changed_files = g_list_prepend (changed_files, file);
+        }
+    }
+
+    if (changed_files != NULL)
+    {
+        nautilus_directory_emit_change_signals (directory, changed_files);
+    }
 
     async_job_end (directory, "file info");
     nautilus_directory_async_state_changed (directory);
@@ -3021,6 +3511,68 @@ file_info_stop (NautilusDirectory *directory)
     }
 }
 
+static void
+reset_get_info_error (NautilusFile *file)
+{
+    file->details->get_info_failed = FALSE;
+    if (file->details->get_info_error)
+    {
+        g_error_free (file->details->get_info_error);
+        file->details->get_info_error = NULL;
+    }
+}
+
+/* A burst of changes (e.g. a git checkout) leaves thousands of local files
+ * needing new info. Rather than one async query per file, query the needy
+ * files at the head of the queue in a single worker task and apply all the
+ * results at once.
+ */
+static gboolean
+file_info_start_batch (NautilusDirectory *directory,
+                       GetInfoState      *state)
+{
+    GList *node;
+    g_autoptr (GTask) task = NULL;
+
+    state->files = g_ptr_array_new_with_free_func ((GDestroyNotify) nautilus_file_unref);
+
+    for (node = g_queue_peek_head_link ((GQueue *) directory->details->high_priority_queue);
+         node != NULL && state->files->len < GET_INFO_BATCH_SIZE;
+         node = node->next)
+    {
+        NautilusFile *file = node->data;
+
+        if (is_needy (file, lacks_info, NAUTILUS_ATTRIBUTE_INFO))
+        {
+            g_ptr_array_add (state->files, nautilus_file_ref (file));
+        }
+    }
+
+    if (state->files->len < 2)
+    {
+        g_clear_pointer (&state->files, g_ptr_array_unref);
+        return FALSE;
+    }
+
+    state->locations = g_ptr_array_new_full (state->files->len, g_object_unref);
+    state->infos = g_ptr_array_new_full (state->files->len, NULL);
+    state->errors = g_ptr_array_new_full (state->files->len, NULL);
+    for (guint i = 0; i < state->files->len; i++)
+    {
+        NautilusFile *file = g_ptr_array_index (state->files, i);
+
+        reset_get_info_error (file);
+        g_ptr_array_add (state->locations, nautilus_file_get_location (file));
+    }
+
+    task = g_task_new (NULL, state->cancellable, query_info_batch_callback, state);
+    g_task_set_source_tag (task, file_info_start_batch);
+    g_task_set_task_data (task, state, NULL);
+    g_task_run_in_thread (task, query_info_batch_thread);
+
+    return TRUE;
+}
+
 static void
 file_info_start (NautilusDirectory *directory,
                  NautilusFile      *file,
@@ -3049,19 +3601,20 @@ file_info_start (NautilusDirectory *directory,
     }
 
     directory->details->get_info_file = file;
-    file->details->get_info_failed = FALSE;
-    if (file->details->get_info_error)
-    {
-        g_error_free (file->details->get_info_error);
-        file->details->get_info_error = NULL;
-    }
+    reset_get_info_error (file);
 
-    state = g_new (GetInfoState, 1);
+    state = g_new0 (GetInfoState, 1);
     state->directory = directory;
     state->cancellable = g_cancellable_new ();
 
     directory->details->get_info_in_progress = state;
 
+    if (g_file_is_native (directory->details->location) &&
+        file_info_start_batch (directory, state))
+    {
+        return;
+    }
+
     location = nautilus_file_get_location (file);
     g_file_query_info_async (location,
                              NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
@@ -4064,6 +4617,7 @@ nautilus_directory_cancel (NautilusDirectory *directory)
     /* Arbitrary order (kept alphabetical). */
     deep_count_cancel (directory);
     directory_count_cancel (directory);
+    directory_poll_cancel (directory);
     file_info_cancel (directory);
     file_list_cancel (directory);
     new_files_cancel (directory);
@@ -4108,7 +4662,11 @@ static void
 cancel_file_info_for_file (NautilusDirectory *directory,
                            NautilusFile      *file)
 {
-    if (directory->details->get_info_file == file)
+    GetInfoState *state = directory->details->get_info_in_progress;
+
+    if (directory->details->get_info_file == file ||
+        (state != NULL && state->files != NULL &&
+         g_ptr_array_find (state->files, file, NULL)))
     {
         file_info_cancel (directory);
     }
@@ -4267,14 +4825,10 @@ nautilus_directory_prioritze_file (NautilusDirectory *directory,
 static void
 add_all_files_to_work_queue (NautilusDirectory *directory)
 {
-    GList *node;
-    NautilusFile *file;
-
-    for (node = directory->details->file_list; node != NULL; node = node->next)
+    for (guint i = 0; i < directory->details->files->len; i++)
     {
-        file = NAUTILUS_FILE (node->data);
-
-        nautilus_directory_add_file_to_work_queue (directory, file);
+        nautilus_directory_add_file_to_work_queue (directory,
+                                                   g_ptr_array_index (directory->details->files, i));
     }
 }
 
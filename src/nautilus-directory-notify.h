@@ -42,6 +42,18 @@ void nautilus_directory_notify_files_removed (GList *files);
  * due to an unmount event. */
 void nautilus_directory_mark_files_unmounted (GList *files);
 
+/* Counters of the throttling of change notifications, for debugging and
+ * benchmarks. Files which are refreshed while still changing count as
+ * throttled. */
+typedef struct {
+	guint n_refreshed;
+	guint n_throttled;
+	guint n_suppressed;
+	guint n_deferred;
+} NautilusChangeThrottleStats;
+
+void nautilus_directory_get_change_throttle_stats (NautilusChangeThrottleStats *stats);
+
 /* Change notification hack.
  * This is called when code modifies the file and it needs to trigger
  * a notification. Eventually this should become private, but for now
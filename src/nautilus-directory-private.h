@@ -39,6 +39,7 @@ typedef struct ThumbnailInfoState ThumbnailInfoState;
 typedef struct ThumbnailBufState ThumbnailBufState;
 typedef struct MountState MountState;
 typedef struct FilesystemInfoState FilesystemInfoState;
+typedef struct DirectoryPollState DirectoryPollState;
 
 /* Counts number of attribute requests of one or more files. */
 typedef gint32 RequestCounter[NAUTILUS_ATTRIBUTE_N_TOTAL];
@@ -50,7 +51,7 @@ struct NautilusDirectoryPrivate
 
 	/* The file objects. */
 	NautilusFile *as_file;
-	GList *file_list;
+	GPtrArray *files;
 	GHashTable *file_hash;
 
 	/* Queues of files needing some I/O done. */
@@ -74,18 +75,23 @@ struct NautilusDirectoryPrivate
 	guint call_ready_idle_id;
 
 	NautilusMonitor *monitor;
+	DirectoryPollState *poll_state;
 	gulong 		 mime_db_monitor;
 
 	gboolean in_async_service_loop;
 	gboolean state_changed;
 
 	gboolean file_list_monitored;
+	/* Monitor clients that aren't displaying the directory right now. */
+	GHashTable *suspended_clients;
+	gboolean changed_while_suspended;
 	gboolean directory_loaded;
 	gboolean directory_loaded_sent_notification;
 	DirectoryLoadState *directory_load_in_progress;
 
 	GList *pending_file_info; /* list of GnomeVFSFileInfo's that are pending */
 	int confirmed_file_count;
+	GHashTable *unconfirmed_files; /* set of NautilusFile * */
         guint dequeue_pending_idle_id;
 
 	GList *new_files_in_progress; /* list of NewFilesState * */
@@ -154,6 +160,12 @@ NautilusFile *     nautilus_directory_get_existing_corresponding_file (NautilusD
 void               nautilus_directory_invalidate_count                (NautilusDirectory         *directory);
 gboolean           nautilus_directory_is_file_list_monitored          (NautilusDirectory         *directory);
 gboolean           nautilus_directory_is_anyone_monitoring_file_list  (NautilusDirectory         *directory);
+gboolean           nautilus_directory_is_monitoring_suspended         (NautilusDirectory         *directory);
+gboolean           nautilus_directory_is_file_monitoring_suspended    (NautilusDirectory         *directory,
+							       NautilusFile              *file);
+void               nautilus_directory_reconcile_if_resumed            (NautilusDirectory         *directory);
+void               nautilus_directory_reschedule_change_refresh       (NautilusFile              *file);
+void               nautilus_directory_remote_poll_interval_changed    (NautilusDirectory         *directory);
 gboolean           nautilus_directory_has_request_for_file            (NautilusDirectory         *directory,
 								       NautilusFile              *file);
 void               nautilus_directory_schedule_dequeue_pending        (NautilusDirectory         *directory);
@@ -194,11 +206,11 @@ FileMonitors *     nautilus_directory_remove_file_monitors            (NautilusD
 void               nautilus_directory_add_file_monitors               (NautilusDirectory         *directory,
 								       NautilusFile              *file,
 								       FileMonitors              *monitors);
-GList *            nautilus_directory_begin_file_name_change          (NautilusDirectory         *directory,
+gboolean           nautilus_directory_begin_file_name_change          (NautilusDirectory         *directory,
 								       NautilusFile              *file);
 void               nautilus_directory_end_file_name_change            (NautilusDirectory         *directory,
 								       NautilusFile              *file,
-								       GList                     *node);
+								       gboolean                   in_file_hash);
 void               nautilus_directory_moved                           (const char                *from_uri,
 								       const char                *to_uri);
 /* Interface to the work queue. */
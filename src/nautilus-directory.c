@@ -27,6 +27,7 @@
 #include "nautilus-directory-notify.h"
 #include "nautilus-directory-private.h"
 #include "nautilus-enums.h"
+#include "nautilus-file-changes-queue.h"
 #include "nautilus-file-private.h"
 #include "nautilus-file-utilities.h"
 #include "nautilus-global-preferences.h"
@@ -56,10 +57,15 @@ static guint signals[LAST_SIGNAL];
 static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 static GHashTable *directories;
+static GHashTable *directory_children;
 
 static NautilusDirectory *nautilus_directory_new (GFile *location);
 static void               set_directory_location (NautilusDirectory *directory,
                                                   GFile             *location);
+static void               index_directory_location   (GFile *location);
+static void               unindex_directory_location (GFile *location);
+static void               collect_directories_at_or_below (GFile  *location,
+                                                           GList **directory_list);
 
 G_DEFINE_TYPE_WITH_PRIVATE (NautilusDirectory, nautilus_directory, G_TYPE_OBJECT);
 
@@ -83,7 +89,7 @@ real_are_all_files_seen (NautilusDirectory *directory)
 static gboolean
 real_is_not_empty (NautilusDirectory *directory)
 {
-    return directory->details->file_list != NULL;
+    return directory->details->files->len > 0;
 }
 
 static gboolean
@@ -96,10 +102,23 @@ is_not_tentative (NautilusFile *file,
     return file->details->got_file_info && file->details->is_added;
 }
 
+static NautilusFileList *
+copy_file_array (GPtrArray *files)
+{
+    NautilusFileList *list = NULL;
+
+    for (guint i = files->len; i > 0; i--)
+    {
+        list = g_list_prepend (list, nautilus_file_ref (g_ptr_array_index (files, i - 1)));
+    }
+
+    return list;
+}
+
 static GList *
 real_get_file_list (NautilusDirectory *directory)
 {
-    NautilusFileList *file_list_copy = nautilus_file_list_copy (directory->details->file_list);
+    NautilusFileList *file_list_copy = copy_file_array (directory->details->files);
 
     return nautilus_file_list_filter (file_list_copy,
                                       is_not_tentative,
@@ -133,6 +152,7 @@ nautilus_directory_finalize (GObject *object)
     directory = NAUTILUS_DIRECTORY (object);
 
     g_hash_table_remove (directories, directory->details->location);
+    unindex_directory_location (directory->details->location);
 
     nautilus_directory_cancel (directory);
     g_warn_if_fail (directory->details->count_in_progress == NULL);
@@ -174,8 +194,11 @@ nautilus_directory_finalize (GObject *object)
         g_object_unref (directory->details->location);
     }
 
-    g_warn_if_fail (directory->details->file_list == NULL);
+    g_warn_if_fail (directory->details->files->len == 0);
+    g_ptr_array_unref (directory->details->files);
     g_hash_table_destroy (directory->details->file_hash);
+    g_hash_table_destroy (directory->details->unconfirmed_files);
+    g_clear_pointer (&directory->details->suspended_clients, g_hash_table_unref);
 
     nautilus_hash_queue_destroy (directory->details->high_priority_queue);
     nautilus_hash_queue_destroy (directory->details->low_priority_queue);
@@ -305,8 +328,10 @@ static void
 nautilus_directory_init (NautilusDirectory *directory)
 {
     directory->details = nautilus_directory_get_instance_private (directory);
+    directory->details->files = g_ptr_array_new ();
     directory->details->file_hash = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                            g_free, NULL);
+    directory->details->unconfirmed_files = g_hash_table_new (NULL, NULL);
     directory->details->high_priority_queue = nautilus_hash_queue_new (g_direct_hash, g_direct_equal, g_object_unref, NULL);
     directory->details->low_priority_queue = nautilus_hash_queue_new (g_direct_hash, g_direct_equal, g_object_unref, NULL);
     directory->details->extension_queue = nautilus_hash_queue_new (g_direct_hash, g_direct_equal, g_object_unref, NULL);
@@ -364,7 +389,7 @@ emit_change_signals_for_all_files (NautilusDirectory *directory)
 {
     g_autolist (NautilusFile) files = NULL;
 
-    files = nautilus_file_list_copy (directory->details->file_list);
+    files = copy_file_array (directory->details->files);
     if (directory->details->as_file != NULL)
     {
         files = g_list_prepend (files, g_object_ref (directory->details->as_file));
@@ -414,6 +439,54 @@ async_data_preference_changed_callback (gpointer callback_data)
     g_hash_table_foreach (directories, async_state_changed_one, NULL);
 }
 
+static void
+remote_poll_interval_changed_one (gpointer key,
+                                  gpointer value,
+                                  gpointer user_data)
+{
+    nautilus_directory_remote_poll_interval_changed (NAUTILUS_DIRECTORY (value));
+}
+
+static void
+remote_poll_interval_changed_callback (gpointer callback_data)
+{
+    g_hash_table_foreach (directories, remote_poll_interval_changed_one, NULL);
+}
+
+/* Currently, some GVfs backends which support monitoring never emit
+ * G_FILE_MONITOR_EVENT_UNMOUNTED, nor _DELETED events when the location
+ * is unmounted. Use GVolumeMonitor in addition to GFileMonitor, looking up
+ * the monitored directories on the mount in the location tree.
+ */
+static void
+mount_removed_callback (GVolumeMonitor *volume_monitor,
+                        GMount         *mount,
+                        gpointer        user_data)
+{
+    g_autoptr (GFile) mount_location = g_mount_get_root (mount);
+    g_autoptr (GList) affected_directories = NULL;
+    gboolean queued = FALSE;
+
+    collect_directories_at_or_below (mount_location, &affected_directories);
+
+    for (GList *l = affected_directories; l != NULL; l = l->next)
+    {
+        NautilusDirectory *directory = l->data;
+
+        if (directory->details->monitor != NULL &&
+            !g_file_is_native (directory->details->location))
+        {
+            nautilus_file_changes_queue_file_unmounted (directory->details->location);
+            queued = TRUE;
+        }
+    }
+
+    if (queued)
+    {
+        nautilus_monitor_schedule_consume_changes ();
+    }
+}
+
 static void
 ensure_directories_hash_table (void)
 {
@@ -424,6 +497,12 @@ ensure_directories_hash_table (void)
 
     /* Create a hash table to reuse existing directory objects */
     directories = g_hash_table_new (g_file_hash, (GCompareFunc) g_file_equal);
+    directory_children = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                g_object_unref,
+                                                (GDestroyNotify) g_hash_table_unref);
+
+    g_signal_connect (g_volume_monitor_get (), "mount-removed",
+                      G_CALLBACK (mount_removed_callback), NULL);
 
     nautilus_global_preferences_init ();
 
@@ -435,6 +514,10 @@ ensure_directories_hash_table (void)
                               "changed::" NAUTILUS_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS,
                               G_CALLBACK (async_data_preference_changed_callback),
                               NULL);
+    g_signal_connect_swapped (nautilus_preferences,
+                              "changed::" NAUTILUS_PREFERENCES_REMOTE_POLL_INTERVAL,
+                              G_CALLBACK (remote_poll_interval_changed_callback),
+                              NULL);
 }
 
 /**
@@ -478,6 +561,7 @@ nautilus_directory_get (GFile *location)
 
     /* Put it in the hash table. */
     g_hash_table_insert (directories, directory->details->location, directory);
+    index_directory_location (directory->details->location);
 
     return directory;
 }
@@ -753,36 +837,29 @@ nautilus_directory_are_all_files_seen (NautilusDirectory *directory)
 
 static void
 add_to_hash_table (NautilusDirectory *directory,
-                   NautilusFile      *file,
-                   GList             *node)
+                   NautilusFile      *file)
 {
     const char *name = nautilus_file_get_name (file);
 
     g_return_if_fail (name != NULL);
-    g_return_if_fail (node != NULL);
     g_return_if_fail (g_hash_table_lookup (directory->details->file_hash,
                                            name) == NULL);
 
-    g_hash_table_insert (directory->details->file_hash, g_strdup (name), node);
+    g_hash_table_insert (directory->details->file_hash, g_strdup (name), file);
 }
 
-static GList *
-extract_from_hash_table (NautilusDirectory *directory,
-                         NautilusFile      *file)
+static gboolean
+remove_from_hash_table (NautilusDirectory *directory,
+                        NautilusFile      *file)
 {
     const char *name = nautilus_file_get_name (file);
-    GList *node;
 
     if (name == NULL)
     {
-        return NULL;
+        return FALSE;
     }
 
-    /* Find the list node in the hash table. */
-    node = g_hash_table_lookup (directory->details->file_hash, name);
-    g_hash_table_remove (directory->details->file_hash, name);
-
-    return node;
+    return g_hash_table_remove (directory->details->file_hash, name);
 }
 
 void
@@ -792,13 +869,15 @@ nautilus_directory_add_file (NautilusDirectory *directory,
     g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
     g_return_if_fail (NAUTILUS_IS_FILE (file));
 
-    /* Add to list. */
-    GList *node = g_list_prepend (directory->details->file_list, file);
-    directory->details->file_list = node;
+    /* Add to array. */
+    file->details->directory_index = directory->details->files->len;
+    g_ptr_array_add (directory->details->files, file);
 
     /* Add to hash table. */
-    add_to_hash_table (directory, file, node);
+    add_to_hash_table (directory, file);
 
+    /* A file moved in from another directory starts out confirmed here. */
+    file->details->unconfirmed = FALSE;
     directory->details->confirmed_file_count++;
 
     gboolean add_to_work_queue = FALSE;
@@ -826,18 +905,26 @@ void
 nautilus_directory_remove_file (NautilusDirectory *directory,
                                 NautilusFile      *file)
 {
+    GPtrArray *files;
+    guint index;
+
     g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
     g_return_if_fail (NAUTILUS_IS_FILE (file));
 
-    /* Find the list node in the hash table. */
-    GList *node = extract_from_hash_table (directory, file);
-    g_return_if_fail (node != NULL);
-    g_return_if_fail (node->data == file);
+    files = directory->details->files;
+    index = file->details->directory_index;
+    g_return_if_fail (index < files->len);
+    g_return_if_fail (g_ptr_array_index (files, index) == file);
+
+    remove_from_hash_table (directory, file);
 
-    /* Remove the item from the list. */
-    directory->details->file_list = g_list_remove_link
-                                        (directory->details->file_list, node);
-    g_list_free_1 (node);
+    /* Remove the item from the array, moving the last one into its place. */
+    g_ptr_array_remove_index_fast (files, index);
+    if (index < files->len)
+    {
+        NautilusFile *moved_file = g_ptr_array_index (files, index);
+        moved_file->details->directory_index = index;
+    }
 
     nautilus_directory_remove_file_from_work_queue (directory, file);
 
@@ -845,6 +932,10 @@ nautilus_directory_remove_file (NautilusDirectory *directory,
     {
         directory->details->confirmed_file_count--;
     }
+    else
+    {
+        g_hash_table_remove (directory->details->unconfirmed_files, file);
+    }
 
     /* Unref if we are monitoring. */
     if (nautilus_directory_is_file_list_monitored (directory))
@@ -853,26 +944,26 @@ nautilus_directory_remove_file (NautilusDirectory *directory,
     }
 }
 
-GList *
+gboolean
 nautilus_directory_begin_file_name_change (NautilusDirectory *directory,
                                            NautilusFile      *file)
 {
-    /* Find the list node in the hash table. */
-    return extract_from_hash_table (directory, file);
+    /* Drop the old name from the hash table. */
+    return remove_from_hash_table (directory, file);
 }
 
 void
 nautilus_directory_end_file_name_change (NautilusDirectory *directory,
                                          NautilusFile      *file,
-                                         GList             *node)
+                                         gboolean           in_file_hash)
 {
     g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
     g_return_if_fail (NAUTILUS_IS_FILE (file));
 
-    /* Add the list node to the hash table. */
-    if (node != NULL)
+    /* Add the file back to the hash table under its new name. */
+    if (in_file_hash)
     {
-        add_to_hash_table (directory, file, node);
+        add_to_hash_table (directory, file);
     }
 }
 
@@ -880,14 +971,10 @@ NautilusFile *
 nautilus_directory_find_file_by_name (NautilusDirectory *directory,
                                       const char        *name)
 {
-    GList *node;
-
     g_return_val_if_fail (NAUTILUS_IS_DIRECTORY (directory), NULL);
     g_return_val_if_fail (name != NULL, NULL);
 
-    node = g_hash_table_lookup (directory->details->file_hash,
-                                name);
-    return node == NULL ? NULL : NAUTILUS_FILE (node->data);
+    return g_hash_table_lookup (directory->details->file_hash, name);
 }
 
 void
@@ -1057,6 +1144,12 @@ nautilus_directory_notify_files_added (GList *files)
             continue;
         }
 
+        if (nautilus_directory_is_monitoring_suspended (directory))
+        {
+            directory->details->changed_while_suspended = TRUE;
+            continue;
+        }
+
         g_autoptr (NautilusFile) file = nautilus_file_get_existing (location);
         /* We check is_added here, because the file could have been added
          * to the directory by a nautilus_file_get() but not gotten
@@ -1084,12 +1177,206 @@ nautilus_directory_notify_files_added (GList *files)
     g_hash_table_foreach (parent_directories, (GHFunc) nautilus_directory_invalidate_count, NULL);
 }
 
+/* Change notifications are throttled per file: a file which keeps changing
+ * (a log being written, a download) is refreshed at most once per interval,
+ * and the interval doubles while changes keep coming in, up to a cap. The
+ * changes in between are folded into a deferred refresh at the end of the
+ * interval, so the final state is always picked up. Files scrolled out of
+ * sight in a view wait longer. */
+#define CHANGE_REFRESH_MIN_INTERVAL_MS 250
+#define CHANGE_REFRESH_MAX_INTERVAL_MS 4000
+#define CHANGE_REFRESH_OFF_SCREEN_INTERVAL_MS 30000
+
+/* Files with a deferred refresh. Holds a reference on them. */
+static GHashTable *deferred_changes;
+static guint deferred_changes_timeout_id;
+/* Monotonic time the timeout above is scheduled for */
+static gint64 deferred_changes_due_time;
+
+static NautilusChangeThrottleStats change_throttle_stats;
+
+static guint
+get_change_refresh_interval (NautilusFile *file)
+{
+    guint interval = file->details->change_refresh_interval;
+
+    if (interval > 0 && nautilus_file_is_off_screen (file))
+    {
+        interval = MAX (interval, CHANGE_REFRESH_OFF_SCREEN_INTERVAL_MS);
+    }
+
+    return interval;
+}
+
+static gint64
+get_change_refresh_due_time (NautilusFile *file)
+{
+    return file->details->change_refresh_time +
+           get_change_refresh_interval (file) * (gint64) 1000;
+}
+
+static gboolean
+is_change_refresh_due (NautilusFile *file,
+                       gint64        now)
+{
+    gint64 elapsed = (now - file->details->change_refresh_time) / 1000;
+    guint interval = get_change_refresh_interval (file);
+
+    if (elapsed < interval)
+    {
+        return FALSE;
+    }
+
+    if (elapsed < 2 * MAX (interval, CHANGE_REFRESH_MIN_INTERVAL_MS))
+    {
+        /* Still hot */
+        file->details->change_refresh_interval = CLAMP (2 * file->details->change_refresh_interval,
+                                                        CHANGE_REFRESH_MIN_INTERVAL_MS,
+                                                        CHANGE_REFRESH_MAX_INTERVAL_MS);
+        change_throttle_stats.n_throttled += 1;
+    }
+    else
+    {
+        file->details->change_refresh_interval = 0;
+    }
+
+    file->details->change_refresh_time = now;
+
+    return TRUE;
+}
+
+static void
+refresh_changed_file (GHashTable   *changed_lists,
+                      NautilusFile *file)
+{
+    NautilusDirectory *directory = nautilus_file_get_directory (file);
+
+    /* Tell it to re-get info now, and later emit
+     * a changed signal.
+     */
+    file->details->file_info_is_up_to_date = FALSE;
+    nautilus_file_invalidate_extension_info_internal (file);
+
+    hash_table_list_insert (changed_lists, directory, nautilus_file_ref (file));
+    change_throttle_stats.n_refreshed += 1;
+}
+
+static gboolean deferred_changes_timeout_cb (gpointer user_data);
+
+static void
+schedule_deferred_changes (gint64 due_time)
+{
+    if (deferred_changes_timeout_id != 0 && deferred_changes_due_time <= due_time)
+    {
+        return;
+    }
+
+    gint64 delay = MAX (0, due_time - g_get_monotonic_time ());
+
+    g_clear_handle_id (&deferred_changes_timeout_id, g_source_remove);
+    deferred_changes_due_time = due_time;
+    /* Rounded up, so that the refresh is due when the timeout fires. */
+    deferred_changes_timeout_id = g_timeout_add ((delay + 999) / 1000,
+                                                 deferred_changes_timeout_cb,
+                                                 NULL);
+}
+
+static gboolean
+deferred_changes_timeout_cb (gpointer user_data)
+{
+    g_autoptr (GHashTable) changed_lists =
+        g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) nautilus_file_list_free);
+    gint64 now = g_get_monotonic_time ();
+    gint64 next_due_time = G_MAXINT64;
+    GHashTableIter iter;
+    NautilusFile *file;
+
+    deferred_changes_timeout_id = 0;
+
+    g_hash_table_iter_init (&iter, deferred_changes);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+    {
+        if (nautilus_file_is_gone (file))
+        {
+            g_hash_table_iter_remove (&iter);
+        }
+        else if (is_change_refresh_due (file, now))
+        {
+            refresh_changed_file (changed_lists, file);
+            g_hash_table_iter_remove (&iter);
+        }
+        else
+        {
+            next_due_time = MIN (next_due_time, get_change_refresh_due_time (file));
+        }
+    }
+
+    change_throttle_stats.n_deferred = g_hash_table_size (deferred_changes);
+
+    if (next_due_time != G_MAXINT64)
+    {
+        schedule_deferred_changes (next_due_time);
+    }
+    else
+    {
+        g_debug ("Change notifications: %u refreshed, %u throttled, %u suppressed",
+                 change_throttle_stats.n_refreshed, change_throttle_stats.n_throttled,
+                 change_throttle_stats.n_suppressed);
+    }
+
+    g_hash_table_foreach (changed_lists, (GHFunc) add_to_directory_work_queue, NULL);
+    g_hash_table_foreach (changed_lists, (GHFunc) notify_directory_changes, NULL);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+defer_change_refresh (NautilusFile *file)
+{
+    if (deferred_changes == NULL)
+    {
+        deferred_changes = g_hash_table_new_full (NULL, NULL,
+                                                  (GDestroyNotify) nautilus_file_unref,
+                                                  NULL);
+    }
+
+    if (!g_hash_table_contains (deferred_changes, file))
+    {
+        g_hash_table_add (deferred_changes, nautilus_file_ref (file));
+        change_throttle_stats.n_deferred = g_hash_table_size (deferred_changes);
+    }
+
+    change_throttle_stats.n_suppressed += 1;
+
+    schedule_deferred_changes (get_change_refresh_due_time (file));
+}
+
+/* Called when @file scrolls into sight, which may make its deferred refresh
+ * due earlier. */
+void
+nautilus_directory_reschedule_change_refresh (NautilusFile *file)
+{
+    if (deferred_changes != NULL && g_hash_table_contains (deferred_changes, file))
+    {
+        schedule_deferred_changes (get_change_refresh_due_time (file));
+    }
+}
+
+void
+nautilus_directory_get_change_throttle_stats (NautilusChangeThrottleStats *stats)
+{
+    g_return_if_fail (stats != NULL);
+
+    *stats = change_throttle_stats;
+}
+
 void
 nautilus_directory_notify_files_changed (GList *files)
 {
     /* Make a list of changed files in each directory. */
     g_autoptr (GHashTable) changed_lists =
         g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) nautilus_file_list_free);
+    gint64 now = g_get_monotonic_time ();
 
     /* Go through all the notifications. */
     for (GList *node = files; node != NULL; node = node->next)
@@ -1102,13 +1389,26 @@ nautilus_directory_notify_files_changed (GList *files)
         {
             NautilusDirectory *directory = nautilus_file_get_directory (file);
 
-            /* Tell it to re-get info now, and later emit
-             * a changed signal.
-             */
-            file->details->file_info_is_up_to_date = FALSE;
-            nautilus_file_invalidate_extension_info_internal (file);
-
-            hash_table_list_insert (changed_lists, directory, g_steal_pointer (&file));
+            if (!nautilus_file_is_self_owned (file) &&
+                nautilus_directory_is_file_monitoring_suspended (directory, file))
+            {
+                /* Picked up by the reload on resume */
+                directory->details->changed_while_suspended = TRUE;
+                change_throttle_stats.n_suppressed += 1;
+            }
+            else if (deferred_changes != NULL && g_hash_table_contains (deferred_changes, file))
+            {
+                /* Already going to be refreshed */
+                change_throttle_stats.n_suppressed += 1;
+            }
+            else if (is_change_refresh_due (file, now))
+            {
+                refresh_changed_file (changed_lists, file);
+            }
+            else
+            {
+                defer_change_refresh (file);
+            }
         }
         else
         {
@@ -1196,6 +1496,101 @@ set_directory_location (NautilusDirectory *directory,
     }
 }
 
+/* The locations of all existing directories are also kept in a tree,
+ * directory_children, which maps a location to the set of its children that
+ * either have a directory object or have one somewhere below them. This lets
+ * a move visit only the directories under the moved location instead of
+ * every directory in the hash table.
+ */
+static void
+index_directory_location (GFile *location)
+{
+    g_autoptr (GFile) child = g_object_ref (location);
+    g_autoptr (GFile) parent = g_file_get_parent (child);
+
+    while (parent != NULL)
+    {
+        GHashTable *children = g_hash_table_lookup (directory_children, parent);
+        gboolean parent_indexed = (children != NULL);
+
+        if (!parent_indexed)
+        {
+            children = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                              g_object_unref, NULL);
+            g_hash_table_insert (directory_children, g_object_ref (parent), children);
+        }
+
+        if (!g_hash_table_contains (children, child))
+        {
+            g_hash_table_add (children, g_object_ref (child));
+        }
+
+        if (parent_indexed)
+        {
+            /* Ancestors are already linked. */
+            break;
+        }
+
+        g_set_object (&child, parent);
+        g_clear_object (&parent);
+        parent = g_file_get_parent (child);
+    }
+}
+
+static void
+unindex_directory_location (GFile *location)
+{
+    g_autoptr (GFile) child = g_object_ref (location);
+
+    /* Prune the branch up to the first location that is still needed. */
+    while (!g_hash_table_contains (directories, child) &&
+           !g_hash_table_contains (directory_children, child))
+    {
+        g_autoptr (GFile) parent = g_file_get_parent (child);
+        GHashTable *children;
+
+        children = (parent != NULL) ? g_hash_table_lookup (directory_children, parent) : NULL;
+        if (children == NULL)
+        {
+            break;
+        }
+
+        g_hash_table_remove (children, child);
+        if (g_hash_table_size (children) > 0)
+        {
+            break;
+        }
+
+        g_hash_table_remove (directory_children, parent);
+        g_set_object (&child, parent);
+    }
+}
+
+static void
+collect_directories_at_or_below (GFile  *location,
+                                 GList **directory_list)
+{
+    NautilusDirectory *directory = g_hash_table_lookup (directories, location);
+    GHashTable *children = g_hash_table_lookup (directory_children, location);
+
+    if (directory != NULL)
+    {
+        *directory_list = g_list_prepend (*directory_list, directory);
+    }
+
+    if (children != NULL)
+    {
+        GHashTableIter iter;
+        gpointer child;
+
+        g_hash_table_iter_init (&iter, children);
+        while (g_hash_table_iter_next (&iter, &child, NULL))
+        {
+            collect_directories_at_or_below (child, directory_list);
+        }
+    }
+}
+
 static void
 change_directory_location (NautilusDirectory *directory,
                            GFile             *new_location)
@@ -1208,12 +1603,14 @@ change_directory_location (NautilusDirectory *directory,
 
     g_hash_table_remove (directories,
                          directory->details->location);
+    unindex_directory_location (directory->details->location);
 
     set_directory_location (directory, new_location);
 
     g_hash_table_insert (directories,
                          directory->details->location,
                          directory);
+    index_directory_location (directory->details->location);
 }
 
 typedef struct
@@ -1227,26 +1624,21 @@ nautilus_directory_moved_internal (GFile *old_location,
                                    GFile *new_location)
 {
     GList *moved = NULL;
+    g_autoptr (GList) affected_directories = NULL;
 
-    /* The GHashTableIter gets invalidated on change_directory_location
-     * calls, so gather all moved directories into a list first.
+    ensure_directories_hash_table ();
+
+    /* The location tree gets modified by change_directory_location calls,
+     * so gather all moved directories into a list first.
      */
-    GHashTableIter directories_iter;
-    g_hash_table_iter_init (&directories_iter, directories);
-    gpointer value;
+    collect_directories_at_or_below (old_location, &affected_directories);
 
-    while (g_hash_table_iter_next (&directories_iter, NULL, &value))
+    for (GList *l = affected_directories; l != NULL; l = l->next)
     {
-        NautilusDirectory *directory = value;
+        NautilusDirectory *directory = l->data;
         GFile *dir_location = directory->details->location;
 
         gboolean is_equal = g_file_equal (dir_location, old_location);
-        if (!is_equal && !g_file_has_prefix (dir_location, old_location))
-        {
-            /* Directory is not affected by move */
-            continue;
-        }
-
         GFile *new_directory_location;
 
         if (is_equal)
@@ -1295,7 +1687,7 @@ nautilus_directory_moved_internal (GFile *old_location,
                                              nautilus_file_ref (directory->details->as_file));
         }
         affected_files = g_list_concat (affected_files,
-                                        nautilus_file_list_copy (directory->details->file_list));
+                                        copy_file_array (directory->details->files));
     }
 
     return affected_files;
@@ -1510,8 +1902,56 @@ nautilus_directory_file_monitor_remove (NautilusDirectory *directory,
     g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
     g_return_if_fail (client != NULL);
 
+    if (directory->details->suspended_clients != NULL)
+    {
+        g_hash_table_remove (directory->details->suspended_clients, client);
+    }
+
     NAUTILUS_DIRECTORY_CLASS (G_OBJECT_GET_CLASS (directory))->file_monitor_remove
         (directory, client);
+
+    if (!nautilus_directory_is_anyone_monitoring_file_list (directory))
+    {
+        /* Nobody left to show a reload to */
+        directory->details->changed_while_suspended = FALSE;
+        return;
+    }
+
+    nautilus_directory_reconcile_if_resumed (directory);
+}
+
+/**
+ * nautilus_directory_file_monitor_set_suspended:
+ * @directory: a #NautilusDirectory
+ * @client: the client of a monitor added with nautilus_directory_file_monitor_add()
+ * @suspended: whether the client is currently not displaying the directory
+ *
+ * While all clients monitoring the directory are suspended, added and changed
+ * files are not processed, only noted. Once a client resumes, the directory
+ * is reloaded and the differences are signalled.
+ */
+void
+nautilus_directory_file_monitor_set_suspended (NautilusDirectory *directory,
+                                               gconstpointer      client,
+                                               gboolean           suspended)
+{
+    g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+    g_return_if_fail (client != NULL);
+
+    if (suspended)
+    {
+        if (directory->details->suspended_clients == NULL)
+        {
+            directory->details->suspended_clients = g_hash_table_new (NULL, NULL);
+        }
+        g_hash_table_add (directory->details->suspended_clients, (gpointer) client);
+    }
+    else if (directory->details->suspended_clients != NULL)
+    {
+        g_hash_table_remove (directory->details->suspended_clients, client);
+    }
+
+    nautilus_directory_reconcile_if_resumed (directory);
 }
 
 void
@@ -204,6 +204,9 @@ void               nautilus_directory_file_monitor_add         (NautilusDirector
 								gpointer                   callback_data);
 void               nautilus_directory_file_monitor_remove      (NautilusDirectory         *directory,
 								gconstpointer              client);
+void               nautilus_directory_file_monitor_set_suspended (NautilusDirectory       *directory,
+								  gconstpointer            client,
+								  gboolean                 suspended);
 void               nautilus_directory_force_reload             (NautilusDirectory         *directory);
 
 /* Get a list of all files currently known in the directory. */
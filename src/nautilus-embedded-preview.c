@@ -0,0 +1,796 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "nautilus-embedded-preview"
+
+#include "nautilus-embedded-preview.h"
+
+#include <string.h>
+
+/* Extraction of previews which are already embedded in a file, like the EXIF
+ * thumbnail of a JPEG, the preview of a camera RAW or the cover art of an MP4.
+ *
+ * Only the structures leading to the preview are read, using seeks instead of
+ * reading the file sequentially, so that usually only a few KB of headers are
+ * touched besides the preview itself. */
+
+/* Largest preview we are willing to read into memory. */
+#define MAX_PREVIEW_LENGTH (16 * 1024 * 1024)
+
+/* Bounds on the number of structures visited, so that malformed files with
+ * looping offsets can't keep us busy. */
+#define MAX_IFDS 16
+#define MAX_JPEG_MARKERS 32
+#define MAX_ATOMS 256
+
+#define JPEG_MARKER_SOF0 0xc0
+#define JPEG_MARKER_DHT 0xc4
+#define JPEG_MARKER_JPG 0xc8
+#define JPEG_MARKER_DAC 0xcc
+#define JPEG_MARKER_SOF15 0xcf
+#define JPEG_MARKER_RST0 0xd0
+#define JPEG_MARKER_RST7 0xd7
+#define JPEG_MARKER_APP1 0xe1
+#define JPEG_MARKER_SOS 0xda
+#define JPEG_MARKER_EOI 0xd9
+#define JPEG_MARKER_TEM 0x01
+
+#define TIFF_TYPE_SHORT 3
+
+#define TIFF_TAG_NEW_SUBFILE_TYPE 0x00fe
+#define TIFF_TAG_COMPRESSION 0x0103
+#define TIFF_TAG_STRIP_OFFSETS 0x0111
+#define TIFF_TAG_ORIENTATION 0x0112
+#define TIFF_TAG_STRIP_BYTE_COUNTS 0x0117
+#define TIFF_TAG_SUB_IFDS 0x014a
+#define TIFF_TAG_JPEG_OFFSET 0x0201
+#define TIFF_TAG_JPEG_LENGTH 0x0202
+
+#define TIFF_COMPRESSION_OLD_JPEG 6
+#define TIFF_COMPRESSION_JPEG 7
+
+#define RAF_MAGIC "FUJIFILMCCD-RAW "
+#define RAF_JPEG_OFFSET_POSITION 84
+
+typedef enum
+{
+    CONTAINER_NONE,
+    CONTAINER_JPEG,
+    CONTAINER_TIFF,
+    CONTAINER_RAF,
+    CONTAINER_ISO_BMFF,
+} ContainerType;
+
+static const struct
+{
+    const char *mime_type;
+    ContainerType container;
+} supported_types[] =
+{
+    { "image/jpeg", CONTAINER_JPEG },
+    { "image/x-adobe-dng", CONTAINER_TIFF },
+    { "image/x-canon-cr2", CONTAINER_TIFF },
+    { "image/x-nikon-nef", CONTAINER_TIFF },
+    { "image/x-nikon-nrw", CONTAINER_TIFF },
+    { "image/x-olympus-orf", CONTAINER_TIFF },
+    { "image/x-panasonic-rw2", CONTAINER_TIFF },
+    { "image/x-pentax-pef", CONTAINER_TIFF },
+    { "image/x-sony-arw", CONTAINER_TIFF },
+    { "image/x-fuji-raf", CONTAINER_RAF },
+    { "audio/mp4", CONTAINER_ISO_BMFF },
+    { "audio/x-m4a", CONTAINER_ISO_BMFF },
+    { "video/mp4", CONTAINER_ISO_BMFF },
+    { "video/quicktime", CONTAINER_ISO_BMFF },
+    { "video/x-m4v", CONTAINER_ISO_BMFF },
+};
+
+typedef struct
+{
+    GInputStream *stream;
+    GCancellable *cancellable;
+    /* Offsets are relative to this position in the file */
+    goffset base;
+    gboolean big_endian;
+} Reader;
+
+typedef struct
+{
+    /* Absolute position in the file */
+    goffset offset;
+    gsize length;
+} Preview;
+
+static ContainerType
+get_container_type (const char *mime_type)
+{
+    for (gsize i = 0; mime_type != NULL && i < G_N_ELEMENTS (supported_types); i++)
+    {
+        if (g_str_equal (mime_type, supported_types[i].mime_type))
+        {
+            return supported_types[i].container;
+        }
+    }
+
+    return CONTAINER_NONE;
+}
+
+static gboolean
+read_at (Reader   *reader,
+         goffset   offset,
+         void     *buffer,
+         gsize     length,
+         GError  **error)
+{
+    gsize bytes_read;
+
+    if (!g_seekable_seek (G_SEEKABLE (reader->stream), reader->base + offset,
+                          G_SEEK_SET, reader->cancellable, error) ||
+        !g_input_stream_read_all (reader->stream, buffer, length, &bytes_read,
+                                  reader->cancellable, error))
+    {
+        return FALSE;
+    }
+
+    if (bytes_read != length)
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Unexpected end of file");
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static guint16
+get_u16 (Reader       *reader,
+         const guchar *data)
+{
+    return reader->big_endian
+           ? (guint16) (data[0] << 8 | data[1])
+           : (guint16) (data[1] << 8 | data[0]);
+}
+
+static guint32
+get_u32 (Reader       *reader,
+         const guchar *data)
+{
+    return reader->big_endian
+           ? (guint32) data[0] << 24 | (guint32) data[1] << 16 | (guint32) data[2] << 8 | data[3]
+           : (guint32) data[3] << 24 | (guint32) data[2] << 16 | (guint32) data[1] << 8 | data[0];
+}
+
+static void
+consider_preview (Preview *preview,
+                  Reader  *reader,
+                  goffset  offset,
+                  gsize    length)
+{
+    /* Files often carry several previews, prefer the largest one. */
+    if (offset > 0 &&
+        length > preview->length &&
+        length <= MAX_PREVIEW_LENGTH)
+    {
+        preview->offset = reader->base + offset;
+        preview->length = length;
+    }
+}
+
+static gboolean
+parse_tiff (Reader   *reader,
+            Preview  *preview,
+            int      *orientation,
+            GError  **error)
+{
+    guchar header[8];
+
+    if (!read_at (reader, 0, header, sizeof (header), error))
+    {
+        return FALSE;
+    }
+
+    /* Only the byte order is checked, as some RAW formats use their own magic
+     * number in an otherwise valid TIFF structure. */
+    if (memcmp (header, "II", 2) == 0)
+    {
+        reader->big_endian = FALSE;
+    }
+    else if (memcmp (header, "MM", 2) == 0)
+    {
+        reader->big_endian = TRUE;
+    }
+    else
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Not a TIFF structure");
+
+        return FALSE;
+    }
+
+    guint32 pending[MAX_IFDS];
+    guint n_pending = 0;
+    gboolean is_first_ifd = TRUE;
+
+    pending[n_pending++] = get_u32 (reader, header + 4);
+
+    for (guint n_visited = 0; n_pending > 0 && n_visited < MAX_IFDS; n_visited++)
+    {
+        guint32 ifd_offset = pending[--n_pending];
+        guchar count_buffer[2];
+
+        if (ifd_offset == 0 ||
+            !read_at (reader, ifd_offset, count_buffer, sizeof (count_buffer), NULL))
+        {
+            continue;
+        }
+
+        guint16 n_entries = get_u16 (reader, count_buffer);
+        /* Entries are followed by the offset of the next IFD */
+        gsize entries_length = n_entries * 12 + 4;
+        g_autofree guchar *entries = g_malloc (entries_length);
+
+        if (!read_at (reader, ifd_offset + 2, entries, entries_length, NULL))
+        {
+            continue;
+        }
+
+        guint32 jpeg_offset = 0;
+        guint32 jpeg_length = 0;
+        guint32 strip_offset = 0;
+        guint32 strip_length = 0;
+        guint32 subfile_type = 0;
+        guint32 compression = 0;
+
+        for (guint i = 0; i < n_entries; i++)
+        {
+            const guchar *entry = entries + i * 12;
+            guint16 tag = get_u16 (reader, entry);
+            guint16 type = get_u16 (reader, entry + 2);
+            guint32 count = get_u32 (reader, entry + 4);
+            guint32 value = type == TIFF_TYPE_SHORT
+                            ? get_u16 (reader, entry + 8)
+                            : get_u32 (reader, entry + 8);
+
+            switch (tag)
+            {
+                case TIFF_TAG_NEW_SUBFILE_TYPE:
+                {
+                    subfile_type = value;
+                }
+                break;
+
+                case TIFF_TAG_COMPRESSION:
+                {
+                    compression = value;
+                }
+                break;
+
+                case TIFF_TAG_STRIP_OFFSETS:
+                {
+                    strip_offset = count == 1 ? value : 0;
+                }
+                break;
+
+                case TIFF_TAG_STRIP_BYTE_COUNTS:
+                {
+                    strip_length = count == 1 ? value : 0;
+                }
+                break;
+
+                case TIFF_TAG_ORIENTATION:
+                {
+                    if (is_first_ifd && orientation != NULL)
+                    {
+                        *orientation = value;
+                    }
+                }
+                break;
+
+                case TIFF_TAG_JPEG_OFFSET:
+                {
+                    jpeg_offset = value;
+                }
+                break;
+
+                case TIFF_TAG_JPEG_LENGTH:
+                {
+                    jpeg_length = value;
+                }
+                break;
+
+                case TIFF_TAG_SUB_IFDS:
+                {
+                    if (count == 1 && n_pending < MAX_IFDS)
+                    {
+                        pending[n_pending++] = value;
+                    }
+                    else if (count > 1)
+                    {
+                        guint n_offsets = MIN (count, MAX_IFDS - n_pending);
+                        g_autofree guchar *offsets = g_malloc (n_offsets * 4);
+
+                        if (read_at (reader, value, offsets, n_offsets * 4, NULL))
+                        {
+                            for (guint j = 0; j < n_offsets; j++)
+                            {
+                                pending[n_pending++] = get_u32 (reader, offsets + j * 4);
+                            }
+                        }
+                    }
+                }
+                break;
+
+                default:
+                {
+                }
+                break;
+            }
+        }
+
+        consider_preview (preview, reader, jpeg_offset, jpeg_length);
+
+        /* Single strip JPEG images, as long as they are not the lossless
+         * compressed raw data itself, which isn't decodable. */
+        if (compression == TIFF_COMPRESSION_OLD_JPEG ||
+            (compression == TIFF_COMPRESSION_JPEG && (subfile_type & 1) != 0))
+        {
+            consider_preview (preview, reader, strip_offset, strip_length);
+        }
+
+        guint32 next_ifd = get_u32 (reader, entries + n_entries * 12);
+
+        if (next_ifd != 0 && n_pending < MAX_IFDS)
+        {
+            pending[n_pending++] = next_ifd;
+        }
+
+        is_first_ifd = FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+parse_jpeg (Reader   *reader,
+            Preview  *preview,
+            int      *orientation,
+            GError  **error)
+{
+    guchar marker[4];
+    goffset offset = 2;
+
+    if (!read_at (reader, 0, marker, 2, error))
+    {
+        return FALSE;
+    }
+
+    if (marker[0] != 0xff || marker[1] != 0xd8)
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Not a JPEG file");
+
+        return FALSE;
+    }
+
+    /* The EXIF data is in one of the first segments, before the image data. */
+    for (guint i = 0; i < MAX_JPEG_MARKERS; i++)
+    {
+        if (!read_at (reader, offset, marker, sizeof (marker), error))
+        {
+            return FALSE;
+        }
+
+        if (marker[0] != 0xff ||
+            marker[1] == JPEG_MARKER_SOS ||
+            marker[1] == JPEG_MARKER_EOI)
+        {
+            break;
+        }
+
+        guint16 segment_length = marker[2] << 8 | marker[3];
+        char exif_header[6];
+
+        if (marker[1] == JPEG_MARKER_APP1 &&
+            segment_length > 2 + sizeof (exif_header) &&
+            read_at (reader, offset + 4, exif_header, sizeof (exif_header), NULL) &&
+            memcmp (exif_header, "Exif\0\0", sizeof (exif_header)) == 0)
+        {
+            Reader tiff_reader =
+            {
+                .stream = reader->stream,
+                .cancellable = reader->cancellable,
+                .base = reader->base + offset + 4 + sizeof (exif_header),
+            };
+
+            return parse_tiff (&tiff_reader, preview, orientation, error);
+        }
+
+        offset += 2 + segment_length;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+parse_raf (Reader   *reader,
+           Preview  *preview,
+           GError  **error)
+{
+    guchar header[sizeof (RAF_MAGIC) - 1];
+    guchar jpeg_location[8];
+
+    if (!read_at (reader, 0, header, sizeof (header), error) ||
+        !read_at (reader, RAF_JPEG_OFFSET_POSITION, jpeg_location, sizeof (jpeg_location), error))
+    {
+        return FALSE;
+    }
+
+    if (memcmp (header, RAF_MAGIC, sizeof (header)) != 0)
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Not a RAF file");
+
+        return FALSE;
+    }
+
+    reader->big_endian = TRUE;
+    consider_preview (preview, reader,
+                      get_u32 (reader, jpeg_location),
+                      get_u32 (reader, jpeg_location + 4));
+
+    return TRUE;
+}
+
+static gboolean
+find_atom (Reader     *reader,
+           goffset     start,
+           goffset     end,
+           const char *type,
+           goffset    *content_start,
+           goffset    *content_end)
+{
+    goffset offset = start;
+
+    for (guint i = 0; i < MAX_ATOMS && offset + 8 <= end; i++)
+    {
+        guchar header[16];
+        goffset header_length = 8;
+
+        if (!read_at (reader, offset, header, 8, NULL))
+        {
+            return FALSE;
+        }
+
+        guint64 size = get_u32 (reader, header);
+
+        if (size == 1)
+        {
+            /* 64-bit extended size */
+            if (!read_at (reader, offset + 8, header + 8, 8, NULL))
+            {
+                return FALSE;
+            }
+
+            size = (guint64) get_u32 (reader, header + 8) << 32 | get_u32 (reader, header + 12);
+            header_length = 16;
+        }
+        else if (size == 0)
+        {
+            /* Extends to the end of the enclosing atom */
+            size = end - offset;
+        }
+
+        if (size < (guint64) header_length || size > (guint64) (end - offset))
+        {
+            return FALSE;
+        }
+
+        if (memcmp (header + 4, type, 4) == 0)
+        {
+            *content_start = offset + header_length;
+            *content_end = offset + size;
+
+            return TRUE;
+        }
+
+        offset += size;
+    }
+
+    return FALSE;
+}
+
+static gboolean
+parse_iso_bmff (Reader   *reader,
+                Preview  *preview,
+                GError  **error)
+{
+    g_autoptr (GFileInfo) info = g_file_input_stream_query_info (G_FILE_INPUT_STREAM (reader->stream),
+                                                                 G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                                                                 reader->cancellable,
+                                                                 error);
+
+    if (info == NULL)
+    {
+        return FALSE;
+    }
+
+    goffset start = 0;
+    goffset end = g_file_info_get_size (info);
+    guchar meta_version[4];
+
+    reader->big_endian = TRUE;
+
+    /* Cover art lives in moov/udta/meta/ilst/covr/data. The media data can be
+     * placed before the movie header, and is skipped without being read. */
+    if (!find_atom (reader, start, end, "moov", &start, &end) ||
+        !find_atom (reader, start, end, "udta", &start, &end) ||
+        !find_atom (reader, start, end, "meta", &start, &end) ||
+        !read_at (reader, start, meta_version, sizeof (meta_version), NULL))
+    {
+        return TRUE;
+    }
+
+    /* In MP4 files "meta" is a full box, starting with version and flags,
+     * while in QuickTime files it directly contains other atoms. */
+    if (get_u32 (reader, meta_version) == 0)
+    {
+        start += sizeof (meta_version);
+    }
+
+    if (!find_atom (reader, start, end, "ilst", &start, &end) ||
+        !find_atom (reader, start, end, "covr", &start, &end) ||
+        !find_atom (reader, start, end, "data", &start, &end) ||
+        end - start <= 8)
+    {
+        return TRUE;
+    }
+
+    /* Skip the data type and locale */
+    start += 8;
+    consider_preview (preview, reader, start, end - start);
+
+    return TRUE;
+}
+
+static gboolean
+has_image_signature (const guchar *data,
+                     gsize         length)
+{
+    static const guchar png_signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    return (length >= 2 && data[0] == 0xff && data[1] == 0xd8) ||
+           (length >= sizeof (png_signature) &&
+            memcmp (data, png_signature, sizeof (png_signature)) == 0);
+}
+
+static gboolean
+get_jpeg_size (const guchar *data,
+               gsize         length,
+               guint        *width,
+               guint        *height)
+{
+    gsize offset = 2;
+
+    for (guint i = 0; i < MAX_JPEG_MARKERS && offset + 4 <= length;)
+    {
+        guchar marker = data[offset + 1];
+
+        if (data[offset] != 0xff)
+        {
+            return FALSE;
+        }
+
+        if (marker == 0xff)
+        {
+            /* Fill byte */
+            offset += 1;
+            continue;
+        }
+
+        i++;
+
+        if (marker == JPEG_MARKER_TEM ||
+            (marker >= JPEG_MARKER_RST0 && marker <= JPEG_MARKER_RST7))
+        {
+            offset += 2;
+            continue;
+        }
+
+        if (marker == JPEG_MARKER_SOS || marker == JPEG_MARKER_EOI)
+        {
+            return FALSE;
+        }
+
+        guint16 segment_length = data[offset + 2] << 8 | data[offset + 3];
+
+        if (marker >= JPEG_MARKER_SOF0 && marker <= JPEG_MARKER_SOF15 &&
+            marker != JPEG_MARKER_DHT &&
+            marker != JPEG_MARKER_JPG &&
+            marker != JPEG_MARKER_DAC)
+        {
+            /* Length, sample precision, height, width */
+            if (segment_length < 7 || offset + 9 > length)
+            {
+                return FALSE;
+            }
+
+            *height = data[offset + 5] << 8 | data[offset + 6];
+            *width = data[offset + 7] << 8 | data[offset + 8];
+
+            return TRUE;
+        }
+
+        offset += 2 + segment_length;
+    }
+
+    return FALSE;
+}
+
+/**
+ * nautilus_embedded_preview_get_size:
+ * @preview: A preview returned by nautilus_embedded_preview_extract()
+ * @width: (out): Return location for the width of the preview
+ * @height: (out): Return location for the height of the preview
+ *
+ * Reads the dimensions of @preview from its header, without decoding it.
+ *
+ * Returns: Whether the dimensions could be read.
+ */
+gboolean
+nautilus_embedded_preview_get_size (GBytes *preview,
+                                    guint  *width,
+                                    guint  *height)
+{
+    gsize length;
+    const guchar *data = g_bytes_get_data (preview, &length);
+
+    if (length >= 2 && data[0] == 0xff && data[1] == 0xd8)
+    {
+        return get_jpeg_size (data, length, width, height);
+    }
+
+    /* Signature, then the IHDR chunk: length, type, width, height */
+    if (length >= 24 && has_image_signature (data, length) &&
+        memcmp (data + 12, "IHDR", 4) == 0)
+    {
+        *width = (guint) data[16] << 24 | (guint) data[17] << 16 | (guint) data[18] << 8 | data[19];
+        *height = (guint) data[20] << 24 | (guint) data[21] << 16 | (guint) data[22] << 8 | data[23];
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * nautilus_embedded_preview_is_supported:
+ * @mime_type: The content type of a file
+ *
+ * Returns: Whether files of @mime_type may contain a preview which
+ *   nautilus_embedded_preview_extract() can find.
+ */
+gboolean
+nautilus_embedded_preview_is_supported (const char *mime_type)
+{
+    return get_container_type (mime_type) != CONTAINER_NONE;
+}
+
+/**
+ * nautilus_embedded_preview_extract:
+ * @file: The file to look for a preview in
+ * @mime_type: The content type of @file
+ * @orientation: (out) (optional): Return location for the EXIF orientation
+ *   which applies to the preview, 1 if unknown
+ * @cancellable: (nullable): A #GCancellable
+ * @error: Return location for a #GError
+ *
+ * Looks for the largest embedded preview image in @file. This does blocking
+ * I/O, so it must be called from a thread.
+ *
+ * Returns: (transfer full): The encoded JPEG or PNG preview, or %NULL with
+ *   @error set if none was found.
+ */
+GBytes *
+nautilus_embedded_preview_extract (GFile         *file,
+                                   const char    *mime_type,
+                                   int           *orientation,
+                                   GCancellable  *cancellable,
+                                   GError       **error)
+{
+    ContainerType container = get_container_type (mime_type);
+
+    if (container == CONTAINER_NONE)
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                     "No embedded previews in files of type %s", mime_type);
+
+        return NULL;
+    }
+
+    g_autoptr (GFileInputStream) stream = g_file_read (file, cancellable, error);
+
+    if (stream == NULL)
+    {
+        return NULL;
+    }
+
+    if (!g_seekable_can_seek (G_SEEKABLE (stream)))
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                     "Embedded previews require seekable files");
+
+        return NULL;
+    }
+
+    Reader reader = { .stream = G_INPUT_STREAM (stream), .cancellable = cancellable };
+    Preview preview = { 0 };
+    int preview_orientation = 1;
+    gboolean success = FALSE;
+
+    switch (container)
+    {
+        case CONTAINER_JPEG:
+        {
+            success = parse_jpeg (&reader, &preview, &preview_orientation, error);
+        }
+        break;
+
+        case CONTAINER_TIFF:
+        {
+            success = parse_tiff (&reader, &preview, &preview_orientation, error);
+        }
+        break;
+
+        case CONTAINER_RAF:
+        {
+            success = parse_raf (&reader, &preview, error);
+        }
+        break;
+
+        case CONTAINER_ISO_BMFF:
+        {
+            success = parse_iso_bmff (&reader, &preview, error);
+        }
+        break;
+
+        case CONTAINER_NONE:
+        default:
+        {
+            g_assert_not_reached ();
+        }
+    }
+
+    if (!success)
+    {
+        return NULL;
+    }
+
+    if (preview.length == 0)
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No embedded preview");
+
+        return NULL;
+    }
+
+    g_autofree guchar *data = g_malloc (preview.length);
+
+    reader.base = 0;
+    if (!read_at (&reader, preview.offset, data, preview.length, error))
+    {
+        return NULL;
+    }
+
+    if (!has_image_signature (data, preview.length))
+    {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "Embedded preview is not a JPEG or PNG image");
+
+        return NULL;
+    }
+
+    if (orientation != NULL)
+    {
+        *orientation = preview_orientation;
+    }
+
+    return g_bytes_new_take (g_steal_pointer (&data), preview.length);
+}
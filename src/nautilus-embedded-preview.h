@@ -0,0 +1,25 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+gboolean nautilus_embedded_preview_is_supported (const char    *mime_type);
+
+GBytes * nautilus_embedded_preview_extract      (GFile         *file,
+                                                 const char    *mime_type,
+                                                 int           *orientation,
+                                                 GCancellable  *cancellable,
+                                                 GError       **error);
+
+gboolean nautilus_embedded_preview_get_size     (GBytes        *preview,
+                                                 guint         *width,
+                                                 guint         *height);
+
+G_END_DECLS
@@ -21,6 +21,7 @@
 #include "nautilus-file-changes-queue.h"
 
 #include "nautilus-directory-notify.h"
+#include "nautilus-file.h"
 #include "nautilus-tag-manager.h"
 
 typedef enum
@@ -148,158 +149,333 @@ pairs_list_free (GList *pairs)
     g_list_free_full (pairs, g_free);
 }
 
-/* go through changes in the change queue, send ones with the same kind
- * in a list to the different nautilus_directory_notify calls
- */
-void
-nautilus_file_changes_consume_changes (void)
+/* A run of changes of the same kind, notified in a single call. */
+typedef struct
 {
-    NautilusFileChange *change;
-    GList *additions, *changes, *deletions, *moves;
-    GList *unmounts = NULL;
-    GFilePair *pair;
-    GAsyncQueue *queue;
-    gboolean flush_needed;
+    NautilusFileChangeKind kind;
+    GPtrArray *changes;
+} ChangeBatch;
 
+/* The latest change seen for a location and the batch it went to, and the
+ * latest batch touching the location or anything below it. Batches are -1
+ * until there is one. */
+typedef struct
+{
+    NautilusFileChange *change;     /* NULL if none, or cancelled out */
+    int batch;
+    int subtree_batch;
+} LocationState;
 
-    additions = NULL;
-    changes = NULL;
-    deletions = NULL;
-    moves = NULL;
+static void
+change_free (NautilusFileChange *change)
+{
+    g_clear_object (&change->from);
+    g_clear_object (&change->to);
+    g_free (change);
+}
 
-    queue = nautilus_file_changes_queue_get ();
+static void
+change_batch_free (ChangeBatch *batch)
+{
+    g_ptr_array_unref (batch->changes);
+    g_free (batch);
+}
+
+static NautilusFileChangeKind
+get_batch_kind (NautilusFileChangeKind kind)
+{
+    /* In some cases, GFileMonitor sends both DELETE and UNMOUNT events
+     * for the same location, so we want to deal with both at the same
+     * time. And even by itself, UNMOUNTED implies REMOVED anyway. */
+    return kind == CHANGE_FILE_UNMOUNTED ? CHANGE_FILE_REMOVED : kind;
+}
+
+/* Merges @change into the previous change for the same location, if any.
+ * Returns %TRUE if @change is redundant and must be dropped. Superseded
+ * changes are turned into CHANGE_FILE_INITIAL, which is skipped later. */
+static gboolean
+coalesce_change (NautilusFileChange *previous,
+                 NautilusFileChange *change)
+{
+    switch (change->kind)
+    {
+        case CHANGE_FILE_CHANGED:
+        {
+            /* N changes are 1 change, and a new file is up to date anyway. */
+            return previous->kind == CHANGE_FILE_ADDED ||
+                   previous->kind == CHANGE_FILE_CHANGED;
+        }
+
+        case CHANGE_FILE_REMOVED:
+        case CHANGE_FILE_UNMOUNTED:
+        {
+            if (previous->kind == CHANGE_FILE_REMOVED ||
+                previous->kind == CHANGE_FILE_UNMOUNTED)
+            {
+                /* GFileMonitor may send both DELETE and UNMOUNT events for
+                 * the same location. Notify once, as an unmount if any. */
+                if (change->kind == CHANGE_FILE_UNMOUNTED)
+                {
+                    previous->kind = CHANGE_FILE_UNMOUNTED;
+                }
+
+                return TRUE;
+            }
+
+            if (previous->kind == CHANGE_FILE_ADDED)
+            {
+                g_autoptr (NautilusFile) file = nautilus_file_get_existing (change->from);
 
-    /* Consume changes from the queue, stuffing them into one of three lists,
-     * keep doing it while the changes are of the same kind, then send them off.
-     * This is to ensure that the changes get sent off in the same order that they
-     * arrived.
-     */
-    for (;;)
+                previous->kind = CHANGE_FILE_INITIAL;
+
+                /* A short-lived file cancels out, unless the location was
+                 * known before, e.g. when a copy overwrote it. */
+                return file == NULL;
+            }
+
+            /* Don't bother updating a file which is gone. */
+            if (previous->kind == CHANGE_FILE_CHANGED)
+            {
+                previous->kind = CHANGE_FILE_INITIAL;
+            }
+
+            return FALSE;
+        }
+
+        default:
+        {
+            return FALSE;
+        }
+    }
+}
+
+static LocationState *
+get_location_state (GHashTable *locations,
+                    GFile      *location)
+{
+    LocationState *state = g_hash_table_lookup (locations, location);
+
+    if (state == NULL)
     {
-        change = g_async_queue_try_pop (queue);
+        state = g_new0 (LocationState, 1);
+        state->batch = -1;
+        state->subtree_batch = -1;
+        g_hash_table_insert (locations, g_object_ref (location), state);
+    }
+
+    return state;
+}
+
+static void
+notify_batch (ChangeBatch *batch)
+{
+    g_autolist (GFile) unmounts = NULL;
+    GList *files = NULL;
+    GList *pairs = NULL;
+
+    for (guint i = batch->changes->len; i > 0; i--)
+    {
+        NautilusFileChange *change = g_ptr_array_index (batch->changes, i - 1);
+
+        if (change->kind == CHANGE_FILE_INITIAL)
+        {
+            /* Superseded by a later change */
+            continue;
+        }
+        else if (change->kind == CHANGE_FILE_MOVED)
+        {
+            GFilePair *pair = g_new (GFilePair, 1);
+
+            pair->from = g_object_ref (change->from);
+            pair->to = g_object_ref (change->to);
+            pairs = g_list_prepend (pairs, pair);
+
+            continue;
+        }
+        else if (change->kind == CHANGE_FILE_UNMOUNTED)
+        {
+            unmounts = g_list_prepend (unmounts, g_object_ref (change->from));
+        }
+
+        files = g_list_prepend (files, g_object_ref (change->from));
+    }
 
-        /* figure out if we need to flush the pending changes that we collected sofar */
+    if (files == NULL && pairs == NULL)
+    {
+        return;
+    }
 
-        if (change == NULL)
+    switch (batch->kind)
+    {
+        case CHANGE_FILE_ADDED:
         {
-            flush_needed = TRUE;
-            /* no changes left, flush everything */
+            nautilus_directory_notify_files_added (files);
         }
-        else
+        break;
+
+        case CHANGE_FILE_CHANGED:
         {
-            flush_needed = additions != NULL
-                           && change->kind != CHANGE_FILE_ADDED;
+            nautilus_directory_notify_files_changed (files);
+        }
+        break;
 
-            flush_needed |= changes != NULL
-                            && change->kind != CHANGE_FILE_CHANGED;
+        case CHANGE_FILE_REMOVED:
+        {
+            /* Mark unmounted files before notifying their removal, for
+             * clients to know this is why the file is gone. */
+            nautilus_directory_mark_files_unmounted (unmounts);
+            nautilus_directory_notify_files_removed (files);
+        }
+        break;
 
-            flush_needed |= moves != NULL
-                            && change->kind != CHANGE_FILE_MOVED;
+        case CHANGE_FILE_MOVED:
+        {
+            nautilus_directory_notify_files_moved (pairs);
+        }
+        break;
 
-            /* In some cases, GFileMonitor sends both DELETE and UNMOUNT events
-             * for the same location, so we want to deal with both at the same
-             * time. And even by itself, UNMOUNTED implies REMOVED anyway. */
-            flush_needed |= deletions != NULL
-                            && change->kind != CHANGE_FILE_UNMOUNTED
-                            && change->kind != CHANGE_FILE_REMOVED;
+        default:
+        {
+            g_assert_not_reached ();
         }
+        break;
+    }
+
+    g_list_free_full (files, g_object_unref);
+    pairs_list_free (pairs);
+}
 
-        if (flush_needed)
+/* Drains the change queue and sends the changes to the different
+ * nautilus_directory_notify calls, batched by kind.
+ *
+ * Changes to the same location are coalesced first: repeated changes and
+ * removals are sent once, a change following an addition is dropped, a
+ * removal supersedes the pending changes, and cancels out with a pending
+ * addition of a location which wasn't known before.
+ *
+ * A change then joins the latest batch of its kind, as long as that batch
+ * comes after the last one touching its location, anything below it, or any
+ * of its ancestors: changes to unrelated locations commute, so interleaved streams of additions and
+ * changes still result in a couple of calls, while each location sees its
+ * changes in the order they arrived. Moves may affect whole subtrees, so
+ * nothing is batched across them.
+ */
+void
+nautilus_file_changes_consume_changes (void)
+{
+    GAsyncQueue *queue = nautilus_file_changes_queue_get ();
+    g_autoptr (GPtrArray) batches = g_ptr_array_new_with_free_func ((GDestroyNotify) change_batch_free);
+    g_autoptr (GPtrArray) changes = g_ptr_array_new_with_free_func ((GDestroyNotify) change_free);
+    g_autoptr (GHashTable) locations = g_hash_table_new_full (g_file_hash,
+                                                              (GEqualFunc) g_file_equal,
+                                                              g_object_unref, g_free);
+    /* Latest batch of each kind, or -1 */
+    int last_batch[CHANGE_FILE_MOVED + 1] = { -1, -1, -1, -1, -1, -1 };
+    /* Batches before this one are closed, because of a move */
+    int barrier = 0;
+    NautilusFileChange *change;
+
+    while ((change = g_async_queue_try_pop (queue)) != NULL)
+    {
+        g_ptr_array_add (changes, change);
+
+        if (change->kind == CHANGE_FILE_MOVED)
         {
-            /* Send changes we collected off.
-             * At one time we may only have one of the lists
-             * contain changes.
-             */
+            nautilus_tag_manager_update_moved_uris (nautilus_tag_manager_get (),
+                                                    change->from,
+                                                    change->to);
 
-            if (deletions != NULL)
-            {
-                /* Mark unmounted files before notifying their removal, for
-                 * clients to know this is why the file is gone. */
-                nautilus_directory_mark_files_unmounted (unmounts);
-                g_clear_list (&unmounts, g_object_unref);
-
-                deletions = g_list_reverse (deletions);
-                nautilus_directory_notify_files_removed (deletions);
-                g_list_free_full (deletions, g_object_unref);
-                deletions = NULL;
-            }
-            if (moves != NULL)
+            if (last_batch[CHANGE_FILE_MOVED] < 0 ||
+                (guint) last_batch[CHANGE_FILE_MOVED] != batches->len - 1)
             {
-                moves = g_list_reverse (moves);
-                nautilus_directory_notify_files_moved (moves);
-                pairs_list_free (moves);
-                moves = NULL;
-            }
-            if (additions != NULL)
-            {
-                additions = g_list_reverse (additions);
-                nautilus_directory_notify_files_added (additions);
-                g_list_free_full (additions, g_object_unref);
-                additions = NULL;
+                ChangeBatch *batch = g_new0 (ChangeBatch, 1);
+
+                batch->kind = CHANGE_FILE_MOVED;
+                batch->changes = g_ptr_array_new ();
+                g_ptr_array_add (batches, batch);
+                last_batch[CHANGE_FILE_MOVED] = batches->len - 1;
             }
-            if (changes != NULL)
+
+            ChangeBatch *batch = g_ptr_array_index (batches, last_batch[CHANGE_FILE_MOVED]);
+
+            g_ptr_array_add (batch->changes, change);
+            barrier = batches->len - 1;
+            g_hash_table_remove_all (locations);
+
+            continue;
+        }
+
+        LocationState *state = g_hash_table_lookup (locations, change->from);
+
+        if (state != NULL && state->change != NULL && coalesce_change (state->change, change))
+        {
+            if (state->change->kind == CHANGE_FILE_INITIAL)
             {
-                changes = g_list_reverse (changes);
-                nautilus_directory_notify_files_changed (changes);
-                g_list_free_full (changes, g_object_unref);
-                changes = NULL;
+                /* Cancelled out, later changes don't follow up on it */
+                state->change = NULL;
             }
+
+            change->kind = CHANGE_FILE_INITIAL;
+            continue;
         }
 
-        if (change == NULL)
+        /* The earliest batch this change may go to */
+        int min_batch = barrier;
+
+        if (state != NULL)
         {
-            /* we are done */
-            return;
+            min_batch = MAX (min_batch, state->subtree_batch + 1);
         }
 
-        /* add the new change to the list */
-        switch (change->kind)
+        /* A change of any ancestor, e.g. the removal of a folder a few
+         * levels up, orders the changes below it too. */
+        g_autoptr (GPtrArray) ancestors = g_ptr_array_new_with_free_func (g_object_unref);
+
+        for (GFile *ancestor = g_file_get_parent (change->from);
+             ancestor != NULL;
+             ancestor = g_file_get_parent (ancestor))
         {
-            case CHANGE_FILE_ADDED:
-            {
-                additions = g_list_prepend (additions, change->from);
-            }
-            break;
+            LocationState *ancestor_state = g_hash_table_lookup (locations, ancestor);
 
-            case CHANGE_FILE_CHANGED:
-            {
-                changes = g_list_prepend (changes, change->from);
-            }
-            break;
+            g_ptr_array_add (ancestors, ancestor);
 
-            case CHANGE_FILE_UNMOUNTED:
+            if (ancestor_state != NULL)
             {
-                deletions = g_list_prepend (deletions, change->from);
-                unmounts = g_list_prepend (unmounts, g_object_ref (change->from));
+                min_batch = MAX (min_batch, ancestor_state->batch + 1);
             }
-            break;
+        }
 
-            case CHANGE_FILE_REMOVED:
-            {
-                deletions = g_list_prepend (deletions, change->from);
-            }
-            break;
+        NautilusFileChangeKind kind = get_batch_kind (change->kind);
 
-            case CHANGE_FILE_MOVED:
-            {
-                nautilus_tag_manager_update_moved_uris (nautilus_tag_manager_get (),
-                                                        change->from,
-                                                        change->to);
-
-                pair = g_new (GFilePair, 1);
-                pair->from = change->from;
-                pair->to = change->to;
-                moves = g_list_prepend (moves, pair);
-            }
-            break;
+        if (last_batch[kind] < min_batch)
+        {
+            ChangeBatch *batch = g_new0 (ChangeBatch, 1);
 
-            default:
-            {
-                g_assert_not_reached ();
-            }
-            break;
+            batch->kind = kind;
+            batch->changes = g_ptr_array_new ();
+            g_ptr_array_add (batches, batch);
+            last_batch[kind] = batches->len - 1;
         }
 
-        g_free (change);
+        ChangeBatch *batch = g_ptr_array_index (batches, last_batch[kind]);
+
+        g_ptr_array_add (batch->changes, change);
+
+        state = get_location_state (locations, change->from);
+        state->change = change;
+        state->batch = last_batch[kind];
+        state->subtree_batch = MAX (state->subtree_batch, state->batch);
+
+        for (guint i = 0; i < ancestors->len; i++)
+        {
+            LocationState *ancestor_state = get_location_state (locations, ancestors->pdata[i]);
+
+            ancestor_state->subtree_batch = MAX (ancestor_state->subtree_batch, state->batch);
+        }
+    }
+
+    for (guint i = 0; i < batches->len; i++)
+    {
+        notify_batch (g_ptr_array_index (batches, i));
     }
 }
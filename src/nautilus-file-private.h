@@ -119,6 +119,9 @@ struct NautilusFilePrivate
 
 	/* Mount for mountpoint or the references GMount for a "mountable" */
 	GMount *mount;
+
+	/* Position in the parent directory's file array. */
+	guint directory_index;
 	
 	/* boolean fields: bitfield to save space, since there can be
            many NautilusFile objects. */
@@ -190,6 +193,15 @@ struct NautilusFilePrivate
 
 	guint64 free_space; /* (guint)-1 for unknown */
 	time_t free_space_read; /* The time free_space was updated, or 0 for never */
+
+	/* Number of view items displaying this file */
+	guint on_screen_count;
+	/* Number of view items in views which bind items while visible */
+	guint in_view_count;
+
+	/* Throttling of change notifications, see nautilus-directory.c */
+	gint64 change_refresh_time; /* Monotonic time of the last refresh */
+	guint change_refresh_interval; /* In ms, grows while changes keep coming */
 };
 
 typedef struct {
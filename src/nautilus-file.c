@@ -2413,7 +2413,7 @@ update_info_internal (NautilusFile *file,
                       GFileInfo    *info,
                       gboolean      update_name)
 {
-    GList *node;
+    gboolean in_file_hash;
     gboolean changed;
     gboolean is_symlink, is_hidden, is_mountpoint;
     gboolean has_permissions;
@@ -2865,7 +2865,7 @@ update_info_internal (NautilusFile *file,
         {
             changed = TRUE;
 
-            node = nautilus_directory_begin_file_name_change
+            in_file_hash = nautilus_directory_begin_file_name_change
                        (file->details->directory, file);
 
             g_clear_pointer (&file->details->name, g_ref_string_release);
@@ -2889,7 +2889,7 @@ update_info_internal (NautilusFile *file,
             }
 
             nautilus_directory_end_file_name_change
-                (file->details->directory, file, node);
+                (file->details->directory, file, in_file_hash);
         }
     }
 
@@ -2955,7 +2955,7 @@ update_name_internal (NautilusFile *file,
                       const char   *name,
                       gboolean      in_directory)
 {
-    GList *node;
+    gboolean in_file_hash;
 
     g_assert (name != NULL);
 
@@ -2969,10 +2969,10 @@ update_name_internal (NautilusFile *file,
         return FALSE;
     }
 
-    node = NULL;
+    in_file_hash = FALSE;
     if (in_directory)
     {
-        node = nautilus_directory_begin_file_name_change
+        in_file_hash = nautilus_directory_begin_file_name_change
                    (file->details->directory, file);
     }
 
@@ -2987,7 +2987,7 @@ update_name_internal (NautilusFile *file,
     if (in_directory)
     {
         nautilus_directory_end_file_name_change
-            (file->details->directory, file, node);
+            (file->details->directory, file, in_file_hash);
     }
 
     return TRUE;
@@ -4493,27 +4493,11 @@ get_speed_tradeoff_preference_for_file (NautilusFile               *file,
                                       NULL : nautilus_file_get_parent (file);
     GFilesystemPreviewType use_preview = get_filesystem_use_preview (file, parent);
 
-    if (use_preview == G_FILESYSTEM_PREVIEW_TYPE_NEVER)
-    {
-        /* file system says to never preview anything */
-        return FALSE;
-    }
-    else if (value == NAUTILUS_SPEED_TRADEOFF_ALWAYS)
-    {
-        /* we don't care whether it's local or not */
-        return TRUE;
-    }
-    /* value == NAUTILUS_SPEED_TRADEOFF_LOCAL_ONLY */
-    else if (use_preview == G_FILESYSTEM_PREVIEW_TYPE_IF_LOCAL)
-    {
-        /* file system says we should treat file as if it's local */
-        return TRUE;
-    }
-    else
-    {
-        /* check whether file is not remote */
-        return !get_filesystem_remote (file, parent);
-    }
+    /* Only look up whether the file is remote if that matters */
+    return nautilus_speed_tradeoff_applies (value, use_preview,
+                                            value == NAUTILUS_SPEED_TRADEOFF_LOCAL_ONLY &&
+                                            use_preview == G_FILESYSTEM_PREVIEW_TYPE_IF_ALWAYS &&
+                                            get_filesystem_remote (file, parent));
 }
 
 gboolean
@@ -7862,6 +7846,75 @@ nautilus_file_invalidate_all_attributes (NautilusFile *file)
     nautilus_file_invalidate_attributes (file, all_attributes);
 }
 
+/**
+ * nautilus_file_set_in_view:
+ * @file: A #NautilusFile
+ * @in_view: Whether an item for @file was added to or removed from a view
+ *   which binds its items only while they are visible
+ *
+ * Calls must be balanced. Only files in such views can be known to be off
+ * screen, see nautilus_file_is_off_screen().
+ */
+void
+nautilus_file_set_in_view (NautilusFile *file,
+                           gboolean      in_view)
+{
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+
+    if (in_view)
+    {
+        file->details->in_view_count += 1;
+    }
+    else
+    {
+        g_return_if_fail (file->details->in_view_count > 0);
+        file->details->in_view_count -= 1;
+    }
+}
+
+/**
+ * nautilus_file_set_on_screen:
+ * @file: A #NautilusFile
+ * @on_screen: Whether a view item started or stopped displaying @file
+ *
+ * Calls must be balanced.
+ */
+void
+nautilus_file_set_on_screen (NautilusFile *file,
+                             gboolean      on_screen)
+{
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+
+    if (on_screen)
+    {
+        file->details->on_screen_count += 1;
+        nautilus_directory_reschedule_change_refresh (file);
+    }
+    else
+    {
+        g_return_if_fail (file->details->on_screen_count > 0);
+        file->details->on_screen_count -= 1;
+    }
+}
+
+/**
+ * nautilus_file_is_off_screen:
+ * @file: A #NautilusFile
+ *
+ * Changes to files which are off screen are refreshed less eagerly.
+ *
+ * Returns: Whether @file is in a view, but scrolled out of sight. Files
+ *   which are only used elsewhere, like in the properties dialog or by
+ *   models without a view, are not off screen.
+ */
+gboolean
+nautilus_file_is_off_screen (NautilusFile *file)
+{
+    g_return_val_if_fail (NAUTILUS_IS_FILE (file), FALSE);
+
+    return file->details->in_view_count > 0 && file->details->on_screen_count == 0;
+}
+
 
 /**
  * nautilus_file_dump
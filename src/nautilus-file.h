@@ -143,6 +143,11 @@ gboolean                nautilus_file_check_if_ready                    (Nautilu
 void                    nautilus_file_invalidate_attributes             (NautilusFile                   *file,
 									 NautilusAttributes              attributes);
 void                    nautilus_file_invalidate_all_attributes         (NautilusFile                   *file);
+void                    nautilus_file_set_in_view                       (NautilusFile                   *file,
+									 gboolean                        in_view);
+void                    nautilus_file_set_on_screen                     (NautilusFile                   *file,
+									 gboolean                        on_screen);
+gboolean                nautilus_file_is_off_screen                     (NautilusFile                   *file);
 
 /* Basic attributes for file objects. */
 gboolean                nautilus_file_contains_text                     (NautilusFile                   *file);
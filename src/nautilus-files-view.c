@@ -218,6 +218,9 @@ struct _NautilusFilesView
     NautilusDirectoryList *subdirectory_list;
     NautilusDirectoryList *subdirectories_loading;
 
+    /* Set while the view is in a background tab */
+    gboolean monitoring_suspended;
+
     GMenu *selection_menu_model;
     GMenu *background_menu_model;
 
@@ -1026,6 +1029,38 @@ nautilus_files_view_is_searching (NautilusFilesView *self)
     return NAUTILUS_IS_SEARCH_DIRECTORY (self->directory);
 }
 
+/**
+ * nautilus_files_view_set_monitoring_suspended:
+ * @self: a #NautilusFilesView
+ * @suspended: whether the view is hidden
+ *
+ * Lets the directories shown by a hidden view skip processing changes until
+ * the view is shown again. See nautilus_directory_file_monitor_set_suspended().
+ */
+void
+nautilus_files_view_set_monitoring_suspended (NautilusFilesView *self,
+                                              gboolean           suspended)
+{
+    g_return_if_fail (NAUTILUS_IS_FILES_VIEW (self));
+
+    if (self->monitoring_suspended == suspended)
+    {
+        return;
+    }
+
+    self->monitoring_suspended = suspended;
+
+    if (self->directory != NULL)
+    {
+        nautilus_directory_file_monitor_set_suspended (self->directory, &self->directory, suspended);
+    }
+
+    for (NautilusDirectoryList *l = self->subdirectory_list; l != NULL; l = l->next)
+    {
+        nautilus_directory_file_monitor_set_suspended (l->data, &self->directory, suspended);
+    }
+}
+
 /**
  * nautilus_files_view_get_view_id:
  * @self: a #NautilusFilesView
@@ -4166,6 +4201,7 @@ nautilus_files_view_add_files (NautilusFilesView *self,
     NautilusSelectionSource tmp_source = self->in_progress_selection_source;
 
     items = g_list_copy_deep (files, (GCopyFunc) nautilus_view_item_new, NULL);
+    g_list_foreach (items, (GFunc) nautilus_view_item_track_visibility, NULL);
     /* Adding files can change selection indices, causing changed signal which
      * is interpereted as manual selection source from the user. Instead,
      * override that here. The selection of operation results is handled
@@ -4742,6 +4778,10 @@ nautilus_files_view_add_subdirectory (NautilusFilesView *self,
                                          self->show_hidden_files,
                                          attributes,
                                          files_added_callback, self);
+    if (self->monitoring_suspended)
+    {
+        nautilus_directory_file_monitor_set_suspended (directory, &self->directory, TRUE);
+    }
 
     g_signal_connect
         (directory, "files-added",
@@ -8590,6 +8630,10 @@ finish_loading (NautilusFilesView *self)
                                          self->show_hidden_files,
                                          attributes,
                                          files_added_callback, self);
+    if (self->monitoring_suspended)
+    {
+        nautilus_directory_file_monitor_set_suspended (self->directory, &self->directory, TRUE);
+    }
 
     /* If escaping search we can release the search directory now that the view
      * is now monitoring the base directory directly. */
@@ -74,6 +74,9 @@ gboolean
 nautilus_files_view_is_loading (NautilusFilesView *self);
 gboolean
 nautilus_files_view_is_searching (NautilusFilesView *self);
+void
+nautilus_files_view_set_monitoring_suspended (NautilusFilesView *self,
+                                              gboolean           suspended);
 
 /* Wrappers for signal emitters. These are normally called
  * only by NautilusFilesView itself. They have corresponding signals
@@ -151,3 +151,41 @@ nautilus_global_preferences_get_use_extra_buttons (void)
 {
     return mouse_extra_buttons;
 }
+
+/**
+ * nautilus_speed_tradeoff_applies:
+ * @value: The setting, e.g. whether to show thumbnails
+ * @use_preview: The preview type of the file system
+ * @is_remote: Whether the file system is remote
+ *
+ * Returns: Whether the slow operation controlled by @value should be done
+ *   for files on the given file system.
+ */
+gboolean
+nautilus_speed_tradeoff_applies (NautilusSpeedTradeoffValue value,
+                                 GFilesystemPreviewType     use_preview,
+                                 gboolean                   is_remote)
+{
+    if (value == NAUTILUS_SPEED_TRADEOFF_NEVER ||
+        use_preview == G_FILESYSTEM_PREVIEW_TYPE_NEVER)
+    {
+        /* file system says to never preview anything */
+        return FALSE;
+    }
+    else if (value == NAUTILUS_SPEED_TRADEOFF_ALWAYS)
+    {
+        /* we don't care whether it's local or not */
+        return TRUE;
+    }
+    /* value == NAUTILUS_SPEED_TRADEOFF_LOCAL_ONLY */
+    else if (use_preview == G_FILESYSTEM_PREVIEW_TYPE_IF_LOCAL)
+    {
+        /* file system says we should treat file as if it's local */
+        return TRUE;
+    }
+    else
+    {
+        /* check whether file is not remote */
+        return !is_remote;
+    }
+}
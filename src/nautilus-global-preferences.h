@@ -97,6 +97,7 @@ typedef enum
 } NautilusSpeedTradeoffValue;
 
 #define NAUTILUS_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS "show-directory-item-counts"
+#define NAUTILUS_PREFERENCES_REMOTE_POLL_INTERVAL	"remote-poll-interval"
 #define NAUTILUS_PREFERENCES_SHOW_FILE_THUMBNAILS	"show-image-thumbnails"
 #define NAUTILUS_PREFERENCES_FILE_THUMBNAIL_LIMIT	"thumbnail-limit"
 
@@ -114,6 +115,7 @@ typedef enum
 
 /* Search behaviour */
 #define NAUTILUS_PREFERENCES_RECURSIVE_SEARCH "recursive-search"
+#define NAUTILUS_PREFERENCES_FUZZY_SEARCH "fuzzy-search"
 
 /* Context menu options */
 #define NAUTILUS_PREFERENCES_SHOW_DELETE_PERMANENTLY "show-delete-permanently"
@@ -138,6 +140,9 @@ void nautilus_global_preferences_init                      (void);
 guint nautilus_global_preferences_get_back_button (void);
 guint nautilus_global_preferences_get_forward_button (void);
 gboolean nautilus_global_preferences_get_use_extra_buttons (void);
+gboolean nautilus_speed_tradeoff_applies (NautilusSpeedTradeoffValue value,
+                                          GFilesystemPreviewType     use_preview,
+                                          gboolean                   is_remote);
 
 extern GSettings *nautilus_preferences;
 extern GSettings *nautilus_compression_preferences;
@@ -0,0 +1,466 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "nautilus-icon-atlas"
+
+#include "nautilus-icon-atlas.h"
+
+#include <string.h>
+
+/**
+ * NautilusIconAtlasPaintable:
+ *
+ * A paintable which draws one icon out of a shared atlas texture.
+ *
+ * Themed icons are rasterized once into pages holding many icons of the same
+ * size and scale. As all icons in a page share a #GdkTexture, drawing a view
+ * full of generic file type icons only needs to upload and bind a single
+ * texture, instead of one per distinct icon.
+ *
+ * Pages grow by rows as icons are added, and only the slots drawn since the
+ * last upload are uploaded again.
+ */
+
+/* Largest edge of an atlas page, in device pixels. */
+#define ATLAS_MAX_EDGE 2048
+/* Upper bound of icons per row, to keep pages for small icons small. */
+#define ATLAS_MAX_COLUMNS 16
+/* Icons big enough that fewer than this many fit in a row aren't worth it. */
+#define ATLAS_MIN_COLUMNS 4
+/* Transparent border around each icon, so that filtering never samples the
+ * neighbouring icons. */
+#define ATLAS_PADDING 1
+
+typedef struct
+{
+    int slot_edge;
+    int columns;
+    /* Rows of slots allocated so far, up to @columns */
+    int n_rows;
+    gsize stride;
+    guchar *pixels;
+
+    guint n_used;
+    GArray *free_slots;
+
+    /* Lazily uploaded. Slots drawn since then are in @dirty. */
+    GdkTexture *texture;
+    cairo_region_t *dirty;
+} AtlasPage;
+
+static void
+atlas_page_clear (AtlasPage *page)
+{
+    g_free (page->pixels);
+    g_array_unref (page->free_slots);
+    g_clear_object (&page->texture);
+    g_clear_pointer (&page->dirty, cairo_region_destroy);
+}
+
+static AtlasPage *
+atlas_page_new (int slot_edge,
+                int columns)
+{
+    AtlasPage *page = g_rc_box_new0 (AtlasPage);
+
+    page->slot_edge = slot_edge;
+    page->columns = columns;
+    page->stride = slot_edge * columns * 4;
+    page->free_slots = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    return page;
+}
+
+static AtlasPage *
+atlas_page_ref (AtlasPage *page)
+{
+    return g_rc_box_acquire (page);
+}
+
+static void
+atlas_page_unref (AtlasPage *page)
+{
+    g_rc_box_release_full (page, (GDestroyNotify) atlas_page_clear);
+}
+
+static gboolean
+atlas_page_is_full (AtlasPage *page)
+{
+    return page->free_slots->len == 0 &&
+           page->n_used >= (guint) (page->columns * page->columns);
+}
+
+static guint
+atlas_page_take_slot (AtlasPage *page)
+{
+    if (page->free_slots->len > 0)
+    {
+        guint slot = g_array_index (page->free_slots, guint, page->free_slots->len - 1);
+
+        g_array_set_size (page->free_slots, page->free_slots->len - 1);
+
+        return slot;
+    }
+
+    return page->n_used++;
+}
+
+static void
+atlas_page_release_slot (AtlasPage *page,
+                         guint      slot)
+{
+    g_array_append_val (page->free_slots, slot);
+}
+
+static void
+atlas_page_ensure_rows (AtlasPage *page,
+                        int        n_rows)
+{
+    if (n_rows <= page->n_rows)
+    {
+        return;
+    }
+
+    /* Grown geometrically, as the texture changes size and is uploaded
+     * again in full. */
+    int new_n_rows = MIN (page->columns, MAX (n_rows, 2 * page->n_rows));
+    gsize row_size = page->stride * page->slot_edge;
+
+    page->pixels = g_realloc (page->pixels, row_size * new_n_rows);
+    memset (page->pixels + row_size * page->n_rows, 0, row_size * (new_n_rows - page->n_rows));
+    page->n_rows = new_n_rows;
+
+    g_clear_object (&page->texture);
+    g_clear_pointer (&page->dirty, cairo_region_destroy);
+}
+
+static GdkTexture *
+atlas_page_get_texture (AtlasPage *page)
+{
+    if (page->texture == NULL || page->dirty != NULL)
+    {
+        int height = page->slot_edge * page->n_rows;
+        g_autoptr (GBytes) bytes = g_bytes_new (page->pixels, page->stride * height);
+        g_autoptr (GdkMemoryTextureBuilder) builder = gdk_memory_texture_builder_new ();
+
+        gdk_memory_texture_builder_set_bytes (builder, bytes);
+        gdk_memory_texture_builder_set_stride (builder, page->stride);
+        gdk_memory_texture_builder_set_width (builder, page->slot_edge * page->columns);
+        gdk_memory_texture_builder_set_height (builder, height);
+        gdk_memory_texture_builder_set_format (builder, GDK_MEMORY_DEFAULT);
+
+        if (page->texture != NULL)
+        {
+            /* Lets renderers upload the drawn slots only. */
+            gdk_memory_texture_builder_set_update_texture (builder, page->texture);
+            gdk_memory_texture_builder_set_update_region (builder, page->dirty);
+        }
+
+        GdkTexture *texture = gdk_memory_texture_builder_build (builder);
+
+        g_clear_object (&page->texture);
+        page->texture = texture;
+        g_clear_pointer (&page->dirty, cairo_region_destroy);
+    }
+
+    return page->texture;
+}
+
+static GskRenderer *
+get_renderer (void)
+{
+    static GskRenderer *renderer = NULL;
+    static gboolean failed = FALSE;
+
+    if (G_LIKELY (renderer != NULL || failed))
+    {
+        return renderer;
+    }
+
+    g_autoptr (GError) error = NULL;
+    GdkDisplay *display = gdk_display_get_default ();
+
+    renderer = gsk_cairo_renderer_new ();
+    if (display == NULL ||
+        !gsk_renderer_realize_for_display (renderer, display, &error))
+    {
+        g_warning ("Unable to realize renderer for the icon atlas: %s",
+                   error != NULL ? error->message : "no display");
+        g_clear_object (&renderer);
+        failed = TRUE;
+    }
+
+    return renderer;
+}
+
+/* Rasterizes @icon into @slot of @page. The icon is drawn at device pixel
+ * resolution, the atlas paintable takes care of scaling it back down. */
+static gboolean
+atlas_page_draw_icon (AtlasPage    *page,
+                      guint         slot,
+                      GdkPaintable *icon)
+{
+    GskRenderer *renderer = get_renderer ();
+
+    if (renderer == NULL)
+    {
+        return FALSE;
+    }
+
+    int icon_edge = page->slot_edge - 2 * ATLAS_PADDING;
+    GtkSnapshot *snapshot = gtk_snapshot_new ();
+
+    gdk_paintable_snapshot (icon, GDK_SNAPSHOT (snapshot), icon_edge, icon_edge);
+
+    g_autoptr (GskRenderNode) node = gtk_snapshot_free_to_node (snapshot);
+
+    if (node == NULL)
+    {
+        return FALSE;
+    }
+
+    g_autoptr (GdkTexture) texture = gsk_renderer_render_texture (renderer, node,
+                                                                  &GRAPHENE_RECT_INIT (0, 0,
+                                                                                       icon_edge,
+                                                                                       icon_edge));
+    cairo_rectangle_int_t slot_rect = {
+        (slot % page->columns) * page->slot_edge,
+        (slot / page->columns) * page->slot_edge,
+        page->slot_edge,
+        page->slot_edge
+    };
+    int x = slot_rect.x + ATLAS_PADDING;
+    int y = slot_rect.y + ATLAS_PADDING;
+
+    atlas_page_ensure_rows (page, slot / page->columns + 1);
+    gdk_texture_download (texture, page->pixels + y * page->stride + x * 4, page->stride);
+
+    /* Without a texture yet, the whole page is uploaded anyway. */
+    if (page->texture != NULL && page->dirty == NULL)
+    {
+        page->dirty = cairo_region_create_rectangle (&slot_rect);
+    }
+    else if (page->texture != NULL)
+    {
+        cairo_region_union_rectangle (page->dirty, &slot_rect);
+    }
+
+    return TRUE;
+}
+
+struct _NautilusIconAtlasPaintable
+{
+    GObject parent_instance;
+
+    AtlasPage *page;
+    guint slot;
+    int size;
+    int scale;
+};
+
+static void nautilus_icon_atlas_paintable_paintable_init (GdkPaintableInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (NautilusIconAtlasPaintable, nautilus_icon_atlas_paintable, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE,
+                                                      nautilus_icon_atlas_paintable_paintable_init))
+
+static void
+nautilus_icon_atlas_paintable_finalize (GObject *object)
+{
+    NautilusIconAtlasPaintable *self = NAUTILUS_ICON_ATLAS_PAINTABLE (object);
+
+    atlas_page_release_slot (self->page, self->slot);
+    g_clear_pointer (&self->page, atlas_page_unref);
+
+    G_OBJECT_CLASS (nautilus_icon_atlas_paintable_parent_class)->finalize (object);
+}
+
+static void
+nautilus_icon_atlas_paintable_class_init (NautilusIconAtlasPaintableClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->finalize = nautilus_icon_atlas_paintable_finalize;
+}
+
+static void
+nautilus_icon_atlas_paintable_init (NautilusIconAtlasPaintable *self)
+{
+}
+
+static void
+nautilus_icon_atlas_paintable_snapshot (GdkPaintable *paintable,
+                                        GdkSnapshot  *gdk_snapshot,
+                                        double        width,
+                                        double        height)
+{
+    NautilusIconAtlasPaintable *self = NAUTILUS_ICON_ATLAS_PAINTABLE (paintable);
+    GtkSnapshot *snapshot = GTK_SNAPSHOT (gdk_snapshot);
+    AtlasPage *page = self->page;
+    double slot_edge = (double) page->slot_edge / self->scale;
+    double padding = (double) ATLAS_PADDING / self->scale;
+    double x = (self->slot % page->columns) * slot_edge + padding;
+    double y = (self->slot / page->columns) * slot_edge + padding;
+    GdkTexture *texture = atlas_page_get_texture (page);
+
+    gtk_snapshot_save (snapshot);
+    gtk_snapshot_scale (snapshot, width / self->size, height / self->size);
+    gtk_snapshot_push_clip (snapshot, &GRAPHENE_RECT_INIT (0, 0, self->size, self->size));
+    gtk_snapshot_append_texture (snapshot,
+                                 texture,
+                                 &GRAPHENE_RECT_INIT (-x, -y,
+                                                      page->columns * slot_edge,
+                                                      page->n_rows * slot_edge));
+    gtk_snapshot_pop (snapshot);
+    gtk_snapshot_restore (snapshot);
+}
+
+static GdkPaintableFlags
+nautilus_icon_atlas_paintable_get_flags (GdkPaintable *paintable)
+{
+    /* Other slots of the page may change, but never this one. */
+    return GDK_PAINTABLE_STATIC_SIZE | GDK_PAINTABLE_STATIC_CONTENTS;
+}
+
+static int
+nautilus_icon_atlas_paintable_get_intrinsic_width (GdkPaintable *paintable)
+{
+    return NAUTILUS_ICON_ATLAS_PAINTABLE (paintable)->size;
+}
+
+static int
+nautilus_icon_atlas_paintable_get_intrinsic_height (GdkPaintable *paintable)
+{
+    return NAUTILUS_ICON_ATLAS_PAINTABLE (paintable)->size;
+}
+
+static void
+nautilus_icon_atlas_paintable_paintable_init (GdkPaintableInterface *iface)
+{
+    iface->snapshot = nautilus_icon_atlas_paintable_snapshot;
+    iface->get_flags = nautilus_icon_atlas_paintable_get_flags;
+    iface->get_intrinsic_width = nautilus_icon_atlas_paintable_get_intrinsic_width;
+    iface->get_intrinsic_height = nautilus_icon_atlas_paintable_get_intrinsic_height;
+}
+
+/* Maps a packed (size, scale) key => GPtrArray of AtlasPage */
+static GHashTable *atlas_pages = NULL;
+
+static inline gpointer
+atlas_key (int size,
+           int scale)
+{
+    return GINT_TO_POINTER ((size << 8) | (scale & 0xff));
+}
+
+static AtlasPage *
+get_page_with_free_slot (int size,
+                         int scale)
+{
+    int slot_edge = size * scale + 2 * ATLAS_PADDING;
+    int columns = MIN (ATLAS_MAX_COLUMNS, ATLAS_MAX_EDGE / slot_edge);
+
+    if (columns < ATLAS_MIN_COLUMNS)
+    {
+        return NULL;
+    }
+
+    if (G_UNLIKELY (atlas_pages == NULL))
+    {
+        atlas_pages = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL, (GDestroyNotify) g_ptr_array_unref);
+    }
+
+    GPtrArray *pages = g_hash_table_lookup (atlas_pages, atlas_key (size, scale));
+
+    if (pages == NULL)
+    {
+        pages = g_ptr_array_new_with_free_func ((GDestroyNotify) atlas_page_unref);
+        g_hash_table_insert (atlas_pages, atlas_key (size, scale), pages);
+    }
+
+    for (guint i = 0; i < pages->len; i++)
+    {
+        AtlasPage *page = g_ptr_array_index (pages, i);
+
+        if (!atlas_page_is_full (page))
+        {
+            return page;
+        }
+    }
+
+    AtlasPage *page = atlas_page_new (slot_edge, columns);
+
+    g_ptr_array_add (pages, page);
+
+    return page;
+}
+
+/**
+ * nautilus_icon_atlas_add:
+ * @icon: A themed icon paintable, looked up at @size and @scale
+ * @size: The icon size, in logical pixels
+ * @scale: The scale factor the icon was looked up for
+ *
+ * Rasterizes @icon into the shared atlas for @size and @scale.
+ *
+ * Symbolic icons are not packed, as they need to be recolored at snapshot
+ * time, and neither are icons too large to share a page with many others.
+ *
+ * Returns: (transfer full) (nullable): A paintable drawing @icon out of the
+ *   atlas, or %NULL if @icon can't be packed.
+ */
+GdkPaintable *
+nautilus_icon_atlas_add (GdkPaintable *icon,
+                         int           size,
+                         int           scale)
+{
+    g_return_val_if_fail (GDK_IS_PAINTABLE (icon), NULL);
+
+    if (size <= 0 || scale <= 0 ||
+        (GTK_IS_ICON_PAINTABLE (icon) &&
+         gtk_icon_paintable_is_symbolic (GTK_ICON_PAINTABLE (icon))))
+    {
+        return NULL;
+    }
+
+    AtlasPage *page = get_page_with_free_slot (size, scale);
+
+    if (page == NULL)
+    {
+        return NULL;
+    }
+
+    guint slot = atlas_page_take_slot (page);
+
+    if (!atlas_page_draw_icon (page, slot, icon))
+    {
+        atlas_page_release_slot (page, slot);
+
+        return NULL;
+    }
+
+    NautilusIconAtlasPaintable *self = g_object_new (NAUTILUS_TYPE_ICON_ATLAS_PAINTABLE, NULL);
+
+    self->page = atlas_page_ref (page);
+    self->slot = slot;
+    self->size = size;
+    self->scale = scale;
+
+    return GDK_PAINTABLE (self);
+}
+
+/**
+ * nautilus_icon_atlas_clear:
+ *
+ * Drops all atlas pages, e.g. when the icon theme changes. Paintables that
+ * are still alive keep their own page around until they are finalized.
+ */
+void
+nautilus_icon_atlas_clear (void)
+{
+    g_clear_pointer (&atlas_pages, g_hash_table_unref);
+}
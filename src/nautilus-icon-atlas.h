@@ -0,0 +1,23 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define NAUTILUS_TYPE_ICON_ATLAS_PAINTABLE (nautilus_icon_atlas_paintable_get_type ())
+
+G_DECLARE_FINAL_TYPE (NautilusIconAtlasPaintable, nautilus_icon_atlas_paintable, NAUTILUS, ICON_ATLAS_PAINTABLE, GObject)
+
+GdkPaintable *nautilus_icon_atlas_add   (GdkPaintable *icon,
+                                         int           size,
+                                         int           scale);
+
+void          nautilus_icon_atlas_clear (void);
+
+G_END_DECLS
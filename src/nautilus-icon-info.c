@@ -18,6 +18,7 @@
 #include "nautilus-icon-info.h"
 
 #include "nautilus-enums.h"
+#include "nautilus-icon-atlas.h"
 #include <nautilus-hash-queue.h>
 
 #include <glycin.h>
@@ -105,6 +106,7 @@ nautilus_icon_info_clear_caches (void)
 {
     g_clear_pointer (&loadable_icon_cache, nautilus_hash_queue_destroy);
     g_clear_pointer (&themed_icon_cache, nautilus_hash_queue_destroy);
+    nautilus_icon_atlas_clear ();
 }
 
 static guint
@@ -424,7 +426,13 @@ nautilus_icon_info_lookup (GIcon *icon,
             return g_object_ref (paintable);
         }
 
-        paintable = GDK_PAINTABLE (g_steal_pointer (&icon_paintable));
+        /* Share one texture among all icons of this size, if possible */
+        paintable = nautilus_icon_atlas_add (GDK_PAINTABLE (icon_paintable), size, scale);
+        if (paintable == NULL)
+        {
+            paintable = GDK_PAINTABLE (g_steal_pointer (&icon_paintable));
+        }
+
         key = themed_icon_key_new (icon_name, scale, size);
         themed_icon_cache_add (key, g_object_ref (paintable));
 
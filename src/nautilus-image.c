@@ -27,7 +27,8 @@ struct _NautilusImage
 
     gint size;
     GFile *source;
-    GdkTexture *texture;
+    /* Textures of decreasing size, see create_mipmaps() */
+    GPtrArray *mipmaps;
     guint64 source_mtime;
     gchar *source_content_type;
     GdkPaintable *fallback_paintable;
@@ -52,11 +53,14 @@ G_DEFINE_FINAL_TYPE (NautilusImage, nautilus_image, GTK_TYPE_WIDGET);
 
 #define CACHE_COUNT_LIMIT 1000
 
+/* Smallest size a thumbnail is drawn at, in the list view */
+#define MIPMAP_MIN_SIZE NAUTILUS_LIST_ICON_SIZE_SMALL
+
 static void
-nautilus_image_set_texture (NautilusImage *self,
-                            GdkTexture    *texture);
+nautilus_image_set_mipmaps (NautilusImage *self,
+                            GPtrArray     *mipmaps);
 
-/* Global cache for all images. Maps GFile => GdkTexture */
+/* Global cache for all images. Maps GFile => mipmaps */
 static NautilusHashQueue *thumbnail_cache;
 
 static guint64 cached_thumbnail_size_limit;
@@ -74,7 +78,7 @@ update_thumbnail_limit (void)
 typedef struct
 {
     GFile *file;
-    GdkTexture *texture;
+    GPtrArray *mipmaps;
     guint64 mtime;
 } ThumbnailCacheItem;
 
@@ -82,7 +86,7 @@ static void
 thumbnail_cache_item_free (ThumbnailCacheItem *item)
 {
     g_clear_object (&item->file);
-    g_clear_object (&item->texture);
+    g_clear_pointer (&item->mipmaps, g_ptr_array_unref);
     g_free (item);
 }
 
@@ -105,9 +109,9 @@ thumbnail_cache_get (GFile *file)
 }
 
 static void
-thumbnail_cache_add (GFile      *file,
-                     GdkTexture *texture,
-                     guint64     mtime)
+thumbnail_cache_add (GFile     *file,
+                     GPtrArray *mipmaps,
+                     guint64    mtime)
 {
     if (G_UNLIKELY (thumbnail_cache == NULL))
     {
@@ -119,7 +123,8 @@ thumbnail_cache_add (GFile      *file,
 
     if (old_item != NULL)
     {
-        g_set_object (&old_item->texture, texture);
+        g_clear_pointer (&old_item->mipmaps, g_ptr_array_unref);
+        old_item->mipmaps = g_ptr_array_ref (mipmaps);
         old_item->mtime = mtime;
         nautilus_hash_queue_move_existing_to_tail (thumbnail_cache, file);
 
@@ -134,7 +139,7 @@ thumbnail_cache_add (GFile      *file,
 
     ThumbnailCacheItem *new_item = g_new0 (ThumbnailCacheItem, 1);
     new_item->file = g_object_ref (file);
-    new_item->texture = g_object_ref (texture);
+    new_item->mipmaps = g_ptr_array_ref (mipmaps);
     new_item->mtime = mtime;
 
     nautilus_hash_queue_enqueue (thumbnail_cache, file, new_item);
@@ -193,51 +198,21 @@ get_error_paintable (NautilusImage *self)
 }
 
 static void
-setup_texture_for_image (NautilusImage *self,
-                         GdkPixbuf     *pixbuf)
+setup_mipmaps_for_image (NautilusImage *self,
+                         GPtrArray     *mipmaps)
 {
-    g_autoptr (GdkPixbuf) rotated_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
-    g_autoptr (GdkTexture) texture = gdk_texture_new_for_pixbuf (rotated_pixbuf);
-
-    nautilus_image_set_texture (self, texture);
-    thumbnail_cache_add (self->source, self->texture, self->source_mtime);
+    nautilus_image_set_mipmaps (self, mipmaps);
+    thumbnail_cache_add (self->source, mipmaps, self->source_mtime);
 }
 
 static void
 handle_loading_error (NautilusImage *self)
 {
     /* Transition to error state */
-    nautilus_image_set_texture (self, NULL);
+    nautilus_image_set_mipmaps (self, NULL);
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
-static void
-thumbnailing_done_cb (GObject      *source_object,
-                      GAsyncResult *res,
-                      gpointer      data)
-{
-    NautilusImage *self = data;
-    g_autoptr (GError) error = NULL;
-    g_autoptr (GdkPixbuf) pixbuf = nautilus_create_thumbnail_finish (res, &error);
-
-    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-    {
-        /* The operation was cancelled and the file was disposed, bailout. */
-        return;
-    }
-
-    self->error = g_steal_pointer (&error);
-
-    if (pixbuf != NULL && self->error == NULL)
-    {
-        setup_texture_for_image (self, pixbuf);
-    }
-    else
-    {
-        handle_loading_error (self);
-    }
-}
-
 static void
 scale_down_when_large (GdkPixbuf **pixbuf)
 {
@@ -263,23 +238,69 @@ scale_down_when_large (GdkPixbuf **pixbuf)
     *pixbuf = new_pixbuf;
 }
 
+/* Builds the chain of textures for a thumbnail, each level half the size of
+ * the previous one, down to MIPMAP_MIN_SIZE. Every zoom level can then be
+ * drawn from a texture at most twice as large as needed, without decoding
+ * the thumbnail again or downscaling a large texture on each frame. */
+static GPtrArray *
+create_mipmaps (GdkPixbuf *pixbuf)
+{
+    GPtrArray *mipmaps = g_ptr_array_new_with_free_func (g_object_unref);
+    g_autoptr (GdkPixbuf) level = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+
+    scale_down_when_large (&level);
+
+    while (TRUE)
+    {
+        int width = gdk_pixbuf_get_width (level);
+        int height = gdk_pixbuf_get_height (level);
+
+        g_ptr_array_add (mipmaps, gdk_texture_new_for_pixbuf (level));
+
+        if (MAX (width, height) / 2 < MIPMAP_MIN_SIZE)
+        {
+            break;
+        }
+
+        GdkPixbuf *next_level = gdk_pixbuf_scale_simple (level,
+                                                         MAX (width / 2, 1),
+                                                         MAX (height / 2, 1),
+                                                         GDK_INTERP_BILINEAR);
+
+        g_clear_object (&level);
+        level = next_level;
+    }
+
+    return mipmaps;
+}
+
+static void
+mipmaps_from_pixbuf_thread (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+    GdkPixbuf *pixbuf = task_data;
+
+    g_task_return_pointer (task, create_mipmaps (pixbuf), (GDestroyNotify) g_ptr_array_unref);
+}
+
 /* Currently, GDK Pixbuf will decode the image on the main thread, even when
  * using the async variant of the function. Until that is fixed, use a GTask to
  * perform the decoding in a different thread. */
 static void
-thumbnail_from_stream_thread (GTask        *task,
-                              gpointer      source_object,
-                              gpointer      task_data,
-                              GCancellable *cancellable)
+mipmaps_from_stream_thread (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
 {
     GInputStream *self = source_object;
     GError *error = NULL;
-    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_stream (self, cancellable, &error);
+    g_autoptr (GdkPixbuf) pixbuf = gdk_pixbuf_new_from_stream (self, cancellable, &error);
 
     if (pixbuf != NULL)
     {
-        scale_down_when_large (&pixbuf);
-        g_task_return_pointer (task, pixbuf, g_object_unref);
+        g_task_return_pointer (task, create_mipmaps (pixbuf), (GDestroyNotify) g_ptr_array_unref);
     }
     else
     {
@@ -287,11 +308,13 @@ thumbnail_from_stream_thread (GTask        *task,
     }
 }
 
+/* Pass either a @stream to decode or an already decoded @pixbuf */
 static void
-thumbnail_from_stream_async (GInputStream        *stream,
-                             GCancellable        *cancellable,
-                             GAsyncReadyCallback  callback,
-                             gpointer             user_data)
+thumbnail_mipmaps_async (GInputStream        *stream,
+                         GdkPixbuf           *pixbuf,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
 {
     g_autoptr (GTask) task = g_task_new (stream, cancellable, callback, user_data);
 
@@ -299,24 +322,32 @@ thumbnail_from_stream_async (GInputStream        *stream,
      * so lets reduce the priority. */
     g_task_set_priority (task, G_PRIORITY_LOW);
 
-    g_task_run_in_thread (task, thumbnail_from_stream_thread);
+    if (pixbuf != NULL)
+    {
+        g_task_set_task_data (task, g_object_ref (pixbuf), g_object_unref);
+        g_task_run_in_thread (task, mipmaps_from_pixbuf_thread);
+    }
+    else
+    {
+        g_task_run_in_thread (task, mipmaps_from_stream_thread);
+    }
 }
 
-static GdkPixbuf *
-thumbnail_from_stream_finish (GAsyncResult  *result,
-                              GError       **error)
+static GPtrArray *
+thumbnail_mipmaps_finish (GAsyncResult  *result,
+                          GError       **error)
 {
     return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 static void
-thumbnail_pixbuf_ready_callback (GObject      *source_object,
-                                 GAsyncResult *res,
-                                 gpointer      user_data)
+thumbnail_mipmaps_ready_callback (GObject      *source_object,
+                                  GAsyncResult *res,
+                                  gpointer      user_data)
 {
     g_autoptr (GError) error = NULL;
     NautilusImage *self = user_data;
-    g_autoptr (GdkPixbuf) pixbuf = thumbnail_from_stream_finish (res, &error);
+    g_autoptr (GPtrArray) mipmaps = thumbnail_mipmaps_finish (res, &error);
 
     if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
@@ -326,9 +357,39 @@ thumbnail_pixbuf_ready_callback (GObject      *source_object,
 
     self->error = g_steal_pointer (&error);
 
-    if (pixbuf != NULL)
+    if (mipmaps != NULL)
+    {
+        setup_mipmaps_for_image (self, mipmaps);
+    }
+    else
+    {
+        handle_loading_error (self);
+    }
+}
+
+static void
+thumbnailing_done_cb (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      data)
+{
+    NautilusImage *self = data;
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GdkPixbuf) pixbuf = nautilus_create_thumbnail_finish (res, &error);
+
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        /* The operation was cancelled and the file was disposed, bailout. */
+        return;
+    }
+
+    self->error = g_steal_pointer (&error);
+
+    if (pixbuf != NULL && self->error == NULL)
     {
-        setup_texture_for_image (self, pixbuf);
+        thumbnail_mipmaps_async (NULL, pixbuf,
+                                 self->cancellable,
+                                 thumbnail_mipmaps_ready_callback,
+                                 self);
     }
     else
     {
@@ -355,10 +416,10 @@ thumbnail_file_read_callback (GObject      *source_object,
 
     if (stream != NULL && self->error == NULL)
     {
-        thumbnail_from_stream_async (G_INPUT_STREAM (stream),
-                                     self->cancellable,
-                                     thumbnail_pixbuf_ready_callback,
-                                     self);
+        thumbnail_mipmaps_async (G_INPUT_STREAM (stream), NULL,
+                                 self->cancellable,
+                                 thumbnail_mipmaps_ready_callback,
+                                 self);
     }
     else
     {
@@ -415,7 +476,7 @@ file_info_ready_callback (GObject      *source_object,
     if (cache_item != NULL &&
         cache_item->mtime == self->source_mtime)
     {
-        nautilus_image_set_texture (self, cache_item->texture);
+        nautilus_image_set_mipmaps (self, cache_item->mipmaps);
 
         return;
     }
@@ -497,7 +558,7 @@ file_info_ready_callback (GObject      *source_object,
 NautilusImageStatus
 nautilus_image_get_status (NautilusImage *self)
 {
-    if (self->texture != NULL)
+    if (self->mipmaps != NULL)
     {
         return NAUTILUS_IMAGE_STATUS_THUMBNAIL;
     }
@@ -517,38 +578,74 @@ nautilus_image_get_status (NautilusImage *self)
     return NAUTILUS_IMAGE_STATUS_FALLBACK;
 }
 
+static GdkTexture *
+get_largest_texture (NautilusImage *self)
+{
+    return g_ptr_array_index (self->mipmaps, 0);
+}
+
+/* Returns the smallest texture which is still at least @size large */
+static GdkTexture *
+get_texture_for_size (NautilusImage *self,
+                      int            size)
+{
+    GdkTexture *texture = get_largest_texture (self);
+
+    for (guint i = 1; i < self->mipmaps->len; i++)
+    {
+        GdkTexture *level = g_ptr_array_index (self->mipmaps, i);
+
+        if (MAX (gdk_texture_get_width (level), gdk_texture_get_height (level)) < size)
+        {
+            break;
+        }
+
+        texture = level;
+    }
+
+    return texture;
+}
+
 static void
-nautilus_image_set_texture (NautilusImage *self,
-                            GdkTexture    *texture)
+nautilus_image_set_mipmaps (NautilusImage *self,
+                            GPtrArray     *mipmaps)
 {
-    gboolean resize = (self->texture == NULL && texture != NULL) ||
-                      (self->texture != NULL && texture == NULL);
+    gboolean resize = (self->mipmaps == NULL && mipmaps != NULL) ||
+                      (self->mipmaps != NULL && mipmaps == NULL);
 
-    if (self->texture != NULL && texture != NULL)
+    if (self->mipmaps == mipmaps)
     {
-        resize = (gdk_texture_get_width (self->texture) != gdk_texture_get_width (texture)) ||
-                 (gdk_texture_get_height (self->texture) != gdk_texture_get_height (texture));
+        return;
     }
 
-    if (g_set_object (&self->texture, texture))
+    if (self->mipmaps != NULL && mipmaps != NULL)
     {
-        if (resize)
-        {
-            gtk_widget_queue_resize (GTK_WIDGET (self));
-        }
-        else
-        {
-            gtk_widget_queue_draw (GTK_WIDGET (self));
-        }
+        GdkTexture *old_texture = get_largest_texture (self);
+        GdkTexture *texture = g_ptr_array_index (mipmaps, 0);
 
-        if (texture != NULL)
-        {
-            gtk_widget_add_css_class (GTK_WIDGET (self), "file-thumbnail");
-        }
-        else
-        {
-            gtk_widget_remove_css_class (GTK_WIDGET (self), "file-thumbnail");
-        }
+        resize = (gdk_texture_get_width (old_texture) != gdk_texture_get_width (texture)) ||
+                 (gdk_texture_get_height (old_texture) != gdk_texture_get_height (texture));
+    }
+
+    g_clear_pointer (&self->mipmaps, g_ptr_array_unref);
+    self->mipmaps = mipmaps != NULL ? g_ptr_array_ref (mipmaps) : NULL;
+
+    if (resize)
+    {
+        gtk_widget_queue_resize (GTK_WIDGET (self));
+    }
+    else
+    {
+        gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
+
+    if (mipmaps != NULL)
+    {
+        gtk_widget_add_css_class (GTK_WIDGET (self), "file-thumbnail");
+    }
+    else
+    {
+        gtk_widget_remove_css_class (GTK_WIDGET (self), "file-thumbnail");
     }
 }
 
@@ -639,7 +736,7 @@ nautilus_image_set_source (NautilusImage *self,
     }
 
     g_set_object (&self->source, source);
-    nautilus_image_set_texture (self, NULL);
+    nautilus_image_set_mipmaps (self, NULL);
     g_clear_pointer (&self->source_content_type, g_free);
     self->source_mtime = 0;
     g_clear_error (&self->error);
@@ -782,8 +879,9 @@ real_snapshot (GtkWidget   *widget,
 
     if (status == NAUTILUS_IMAGE_STATUS_THUMBNAIL)
     {
-        double width = gdk_texture_get_width (self->texture);
-        double height = gdk_texture_get_height (self->texture);
+        double width = gdk_texture_get_width (get_largest_texture (self));
+        double height = gdk_texture_get_height (get_largest_texture (self));
+        int scale = gtk_widget_get_scale_factor (widget);
         GskRoundedRect rounded_rect;
         const float border_radius = 2.0;
 
@@ -800,7 +898,7 @@ real_snapshot (GtkWidget   *widget,
                                          border_radius);
         gtk_snapshot_push_rounded_clip (snapshot, &rounded_rect);
 
-        gdk_paintable_snapshot (GDK_PAINTABLE (self->texture),
+        gdk_paintable_snapshot (GDK_PAINTABLE (get_texture_for_size (self, self->size * scale)),
                                 GDK_SNAPSHOT (snapshot),
                                 width, height);
 
@@ -853,8 +951,8 @@ real_measure (GtkWidget      *widget,
 
     if (status == NAUTILUS_IMAGE_STATUS_THUMBNAIL)
     {
-        double width = gdk_texture_get_width (self->texture);
-        double height = gdk_texture_get_height (self->texture);
+        double width = gdk_texture_get_width (get_largest_texture (self));
+        double height = gdk_texture_get_height (get_largest_texture (self));
 
         if (MAX (width, height) != self->size)
         {
@@ -889,7 +987,7 @@ nautilus_image_dispose (GObject *object)
     NautilusImage *self = NAUTILUS_IMAGE (object);
 
     g_clear_object (&self->source);
-    g_clear_object (&self->texture);
+    g_clear_pointer (&self->mipmaps, g_ptr_array_unref);
     g_clear_pointer (&self->source_content_type, g_free);
     g_clear_object (&self->fallback_paintable);
     g_cancellable_cancel (self->cancellable);
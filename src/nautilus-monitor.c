@@ -33,8 +33,6 @@
 struct NautilusMonitor
 {
     GFileMonitor *monitor;
-    GVolumeMonitor *volume_monitor;
-    GFile *location;
 };
 
 static gboolean call_consume_changes_idle_id = 0;
@@ -46,8 +44,10 @@ call_consume_changes_idle_cb (gpointer not_used)
     call_consume_changes_idle_id = 0;
 }
 
-static void
-schedule_call_consume_changes (void)
+/* Consumes the file changes queue at idle, once for all changes queued
+ * until then. */
+void
+nautilus_monitor_schedule_consume_changes (void)
 {
     if (call_consume_changes_idle_id == 0)
     {
@@ -56,25 +56,6 @@ schedule_call_consume_changes (void)
     }
 }
 
-static void
-mount_removed (GVolumeMonitor *volume_monitor,
-               GMount         *mount,
-               gpointer        user_data)
-{
-    NautilusMonitor *monitor = user_data;
-    GFile *mount_location;
-
-    mount_location = g_mount_get_root (mount);
-    if (g_file_equal (monitor->location, mount_location) ||
-        g_file_has_prefix (monitor->location, mount_location))
-    {
-        nautilus_file_changes_queue_file_unmounted (monitor->location);
-        schedule_call_consume_changes ();
-    }
-
-    g_object_unref (mount_location);
-}
-
 static void
 dir_changed (GFileMonitor      *monitor,
              GFile             *child,
@@ -149,7 +130,7 @@ dir_changed (GFileMonitor      *monitor,
         break;
     }
 
-    schedule_call_consume_changes ();
+    nautilus_monitor_schedule_consume_changes ();
 }
 
 NautilusMonitor *
@@ -168,28 +149,12 @@ nautilus_monitor_directory (GFile *location)
         ret->monitor = dir_monitor;
     }
 
-    /* Currently, some GVfs backends which support monitoring never emit
-     * G_FILE_MONITOR_EVENT_UNMOUNTED, nor _DELETED events when the location
-     * is unmounted. Use GVolumeMonitor in addition to GFileMonitor.
-     */
-    if (!g_file_is_native (location))
-    {
-        ret->location = g_object_ref (location);
-        ret->volume_monitor = g_volume_monitor_get ();
-    }
-
     if (ret->monitor != NULL)
     {
         g_signal_connect (ret->monitor, "changed",
                           G_CALLBACK (dir_changed), ret);
     }
 
-    if (ret->volume_monitor != NULL)
-    {
-        g_signal_connect (ret->volume_monitor, "mount-removed",
-                          G_CALLBACK (mount_removed), ret);
-    }
-
     /* We return a monitor even on failure, so we can avoid later trying again */
     return ret;
 }
@@ -204,12 +169,14 @@ nautilus_monitor_cancel (NautilusMonitor *monitor)
         g_object_unref (monitor->monitor);
     }
 
-    if (monitor->volume_monitor != NULL)
-    {
-        g_signal_handlers_disconnect_by_func (monitor->volume_monitor, mount_removed, monitor);
-        g_object_unref (monitor->volume_monitor);
-    }
-
-    g_clear_object (&monitor->location);
     g_slice_free (NautilusMonitor, monitor);
 }
+
+/* Whether change notifications can be expected. Some GVfs backends can't
+ * monitor at all, in which case the location has to be polled.
+ */
+gboolean
+nautilus_monitor_is_active (NautilusMonitor *monitor)
+{
+    return monitor->monitor != NULL;
+}
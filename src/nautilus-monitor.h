@@ -29,5 +29,7 @@
 
 typedef struct NautilusMonitor NautilusMonitor;
 
-NautilusMonitor *nautilus_monitor_directory (GFile *location);
-void             nautilus_monitor_cancel    (NautilusMonitor *monitor);
+NautilusMonitor *nautilus_monitor_directory                 (GFile *location);
+void             nautilus_monitor_cancel                    (NautilusMonitor *monitor);
+gboolean         nautilus_monitor_is_active                 (NautilusMonitor *monitor);
+void             nautilus_monitor_schedule_consume_changes  (void);
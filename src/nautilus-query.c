@@ -31,12 +31,53 @@
 #define MIN_RANK 10.0
 #define MAX_RANK 50.0
 
+/* Each typo costs as much rank as this many letters before the match. */
+#define FUZZY_ERROR_MALUS 10.0
+/* Words must fit a 64-bit mask for the bit-parallel matcher. */
+#define MAX_FUZZY_WORD_LEN 64
+#define MAX_FUZZY_ERRORS 2
+/* Shorter words would match almost anything with a typo or a gap. */
+#define MIN_FUZZY_WORD_LEN 4
+
+/* Character masks of a prepared word, to find it with up to max_errors
+ * insertions, deletions or substitutions (Wu-Manber bitap). All states
+ * of the automaton live in one machine word, so every text byte costs
+ * max_errors + 1 shifts, whatever the word length. */
+typedef struct
+{
+    guint64 masks[256];
+    guint len;
+    guint max_errors;
+} FuzzyPattern;
+
 static void
 prepared_word_free (GString *string)
 {
     g_string_free (string, TRUE);
 }
 
+static FuzzyPattern *
+fuzzy_pattern_new (GString *word)
+{
+    FuzzyPattern *pattern = g_new0 (FuzzyPattern, 1);
+
+    if (word->len == 0 || word->len > MAX_FUZZY_WORD_LEN)
+    {
+        /* Only subsequence matching then. */
+        return pattern;
+    }
+
+    pattern->len = word->len;
+    pattern->max_errors = word->len < MIN_FUZZY_WORD_LEN ? 0 : word->len < 8 ? 1 : MAX_FUZZY_ERRORS;
+
+    for (guint i = 0; i < word->len; i++)
+    {
+        pattern->masks[(guchar) word->str[i]] |= G_GUINT64_CONSTANT (1) << i;
+    }
+
+    return pattern;
+}
+
 struct _NautilusQuery
 {
     GObject parent;
@@ -50,8 +91,11 @@ struct _NautilusQuery
     NautilusSpeedTradeoffValue recursion_tradeoff;
     NautilusSearchTimeType search_type;
     gboolean search_content;
+    gboolean fuzzy;
 
     GPtrArray *prepared_words;
+    /* FuzzyPattern for each of prepared_words */
+    GPtrArray *fuzzy_patterns;
 };
 
 G_DEFINE_FINAL_TYPE (NautilusQuery, nautilus_query, G_TYPE_OBJECT);
@@ -94,6 +138,7 @@ finalize (GObject *object)
 
     g_free (query->text);
     g_clear_pointer (&query->prepared_words, g_ptr_array_unref);
+    g_clear_pointer (&query->fuzzy_patterns, g_ptr_array_unref);
     g_clear_object (&query->location);
     g_clear_pointer (&query->mime_types, g_ptr_array_unref);
     g_clear_pointer (&query->date_range, g_ptr_array_unref);
@@ -116,6 +161,7 @@ nautilus_query_init (NautilusQuery *query)
     query->mime_types = g_ptr_array_new ();
     query->show_hidden = TRUE;
     query->search_type = g_settings_get_enum (nautilus_preferences, "search-filter-time-type");
+    query->fuzzy = g_settings_get_boolean (nautilus_preferences, NAUTILUS_PREFERENCES_FUZZY_SEARCH);
     nautilus_query_update_recursive_setting (query);
     nautilus_query_update_search_content (query);
 }
@@ -132,6 +178,149 @@ prepare_string_for_compare (const gchar *string)
     return res;
 }
 
+/* Finds @pattern in @text with the fewest errors. Returns the end offset of
+ * the earliest such match, or -1 if it needs more than max_errors errors. */
+static gssize
+fuzzy_match_bitap (const FuzzyPattern *pattern,
+                   const gchar        *text,
+                   guint              *errors)
+{
+    guint64 states[MAX_FUZZY_ERRORS + 1];
+    guint64 accept = G_GUINT64_CONSTANT (1) << (pattern->len - 1);
+    guint max_errors = pattern->max_errors;
+    guint best_errors = max_errors + 1;
+    gssize best_end = -1;
+
+    /* The first d pattern characters can be deleted up front. */
+    for (guint d = 0; d <= max_errors; d++)
+    {
+        states[d] = (G_GUINT64_CONSTANT (1) << d) - 1;
+    }
+
+    for (gssize i = 0; text[i] != '\0'; i++)
+    {
+        guint64 mask = pattern->masks[(guchar) text[i]];
+        guint64 previous = states[0];
+
+        states[0] = ((states[0] << 1) | 1) & mask;
+        for (guint d = 1; d <= max_errors; d++)
+        {
+            guint64 current = states[d];
+
+            states[d] = (((current << 1) | 1) & mask) |  /* match */
+                        ((previous << 1) | 1) |          /* substitution */
+                        ((states[d - 1] << 1) | 1) |     /* deletion */
+                        previous;                        /* insertion */
+            previous = current;
+        }
+
+        for (guint d = 0; d < best_errors; d++)
+        {
+            if (states[d] & accept)
+            {
+                best_errors = d;
+                best_end = i;
+                break;
+            }
+        }
+
+        if (best_errors <= 1)
+        {
+            /* Callers only get here without an exact match. */
+            break;
+        }
+    }
+
+    *errors = best_errors;
+    return best_end;
+}
+
+/* Finds the letters of @word in order in @text, fzf-style, spanning less
+ * than twice the length of @word. Returns the offset of the first letter
+ * of the earliest such match, or -1. Every gap costs an error. */
+static gssize
+fuzzy_match_subsequence (GString     *word,
+                         const gchar *text,
+                         guint       *errors)
+{
+    gsize max_span = 2 * word->len - 1;
+
+    for (const gchar *first = strchr (text, word->str[0]);
+         first != NULL;
+         first = strchr (first + 1, word->str[0]))
+    {
+        const gchar *previous = first;
+        guint gaps = 0;
+        gsize i;
+
+        for (i = 1; i < word->len; i++)
+        {
+            const gchar *ptr = strchr (previous + 1, word->str[i]);
+
+            if (ptr == NULL)
+            {
+                /* Later starts can't find the letters either. */
+                return -1;
+            }
+
+            if ((gsize) (ptr - first) >= max_span)
+            {
+                break;
+            }
+
+            if (ptr != previous + 1)
+            {
+                gaps++;
+            }
+
+            previous = ptr;
+        }
+
+        if (i == word->len)
+        {
+            *errors = MAX (gaps, 1);
+            return first - text;
+        }
+    }
+
+    return -1;
+}
+
+static gchar *
+fuzzy_match (NautilusQuery *query,
+             guint          idx,
+             gchar         *prepared_string,
+             guint         *errors)
+{
+    FuzzyPattern *pattern = query->fuzzy_patterns->pdata[idx];
+    GString *word = query->prepared_words->pdata[idx];
+    guint subsequence_errors;
+    gssize offset;
+
+    if (pattern->max_errors > 0)
+    {
+        offset = fuzzy_match_bitap (pattern, prepared_string, errors);
+        if (offset >= 0)
+        {
+            return prepared_string + MAX (0, offset + 1 - (gssize) pattern->len);
+        }
+    }
+
+    if (word->len < MIN_FUZZY_WORD_LEN)
+    {
+        return NULL;
+    }
+
+    offset = fuzzy_match_subsequence (word, prepared_string, &subsequence_errors);
+    if (offset >= 0)
+    {
+        *errors = subsequence_errors;
+        return prepared_string + offset;
+    }
+
+    return NULL;
+}
+
 gdouble
 nautilus_query_matches_string (NautilusQuery *query,
                                const gchar   *string)
@@ -141,6 +330,7 @@ nautilus_query_matches_string (NautilusQuery *query,
     gboolean found = TRUE;
     gdouble retval;
     gint nonexact_malus = 0;
+    guint fuzzy_errors = 0;
 
     if (query->text == NULL)
     {
@@ -155,11 +345,19 @@ nautilus_query_matches_string (NautilusQuery *query,
 
         if ((ptr = strstr (prepared_string, word->str)) == NULL)
         {
-            found = FALSE;
-            break;
+            guint errors = 0;
+
+            if (!query->fuzzy ||
+                (ptr = fuzzy_match (query, idx, prepared_string, &errors)) == NULL)
+            {
+                found = FALSE;
+                break;
+            }
+
+            fuzzy_errors += errors;
         }
 
-        nonexact_malus += strlen (ptr) - word->len;
+        nonexact_malus += MAX (0, (gint) strlen (ptr) - (gint) word->len);
     }
 
     if (!found)
@@ -170,9 +368,9 @@ nautilus_query_matches_string (NautilusQuery *query,
     /* The rank value depends on the numbers of letters before and after the match.
      * To make the prefix matches prefered over sufix ones, the number of letters
      * after the match is divided by a factor, so that it decreases the rank by a
-     * smaller amount.
+     * smaller amount. Fuzzy matches are ranked below exact ones.
      */
-    retval = MAX (MIN_RANK, MAX_RANK - (gdouble) (ptr - prepared_string) - (gdouble) nonexact_malus / RANK_SCALE_FACTOR);
+    retval = MAX (MIN_RANK, MAX_RANK - (gdouble) (ptr - prepared_string) - (gdouble) nonexact_malus / RANK_SCALE_FACTOR - fuzzy_errors * FUZZY_ERROR_MALUS);
 
     return retval;
 }
@@ -196,7 +394,9 @@ nautilus_query_copy (NautilusQuery *query)
     copy->recursion_tradeoff = query->recursion_tradeoff;
     copy->search_type = query->search_type;
     copy->search_content = query->search_content;
+    copy->fuzzy = query->fuzzy;
     g_set_ptr_array (&copy->prepared_words, query->prepared_words);
+    g_set_ptr_array (&copy->fuzzy_patterns, query->fuzzy_patterns);
 
     return copy;
 }
@@ -227,6 +427,7 @@ nautilus_query_set_text (NautilusQuery *query,
     }
 
     g_autoptr (GPtrArray) prepared_words = NULL;
+    g_autoptr (GPtrArray) fuzzy_patterns = NULL;
     if (query->text != NULL)
     {
         g_autofree gchar *prepared_query = prepare_string_for_compare (query->text);
@@ -234,14 +435,17 @@ nautilus_query_set_text (NautilusQuery *query,
         guint split_num = g_strv_length (split_query);
 
         prepared_words = g_ptr_array_new_full (split_num, (GDestroyNotify) prepared_word_free);
+        fuzzy_patterns = g_ptr_array_new_full (split_num, g_free);
         for (guint i = 0; i < split_num; i += 1)
         {
             GString *word = g_string_new (split_query[i]);
             g_ptr_array_add (prepared_words, word);
+            g_ptr_array_add (fuzzy_patterns, fuzzy_pattern_new (word));
         }
     }
 
     g_set_ptr_array (&query->prepared_words, prepared_words);
+    g_set_ptr_array (&query->fuzzy_patterns, fuzzy_patterns);
 
     return TRUE;
 }
@@ -380,23 +584,10 @@ nautilus_query_get_search_content (NautilusQuery *query)
 gboolean
 nautilus_query_can_search_content (NautilusQuery *self)
 {
-    if (self->location == NULL)
-    {
-        return TRUE;
-    }
-    else if (g_file_has_uri_scheme (self->location, SCHEME_NETWORK))
-    {
-        return FALSE;
-    }
-    else if (nautilus_query_recursive_local_only (self))
-    {
-        g_autoptr (NautilusFile) file = nautilus_file_get (self->location);
-        return !nautilus_file_is_remote (file);
-    }
-    else
-    {
-        return TRUE;
-    }
+    /* Files that localsearch doesn't index, like those of remote locations,
+     * are read by the content search engine instead. */
+    return self->location == NULL ||
+           !g_file_has_uri_scheme (self->location, SCHEME_NETWORK);
 }
 
 /**
@@ -414,6 +605,32 @@ nautilus_query_update_search_content (NautilusQuery *self)
     return old_search_content != self->search_content;
 }
 
+gboolean
+nautilus_query_get_fuzzy (NautilusQuery *query)
+{
+    g_return_val_if_fail (NAUTILUS_IS_QUERY (query), FALSE);
+
+    return query->fuzzy;
+}
+
+/**
+ * nautilus_query_set_fuzzy:
+ * @query: A #NautilusQuery
+ * @fuzzy: Whether to tolerate typos
+ *
+ * In fuzzy mode, words also match with a few typos or with letters left
+ * out, e.g. "raport" or "rprt" for "report". Such matches rank below exact
+ * ones.
+ */
+void
+nautilus_query_set_fuzzy (NautilusQuery *query,
+                          gboolean       fuzzy)
+{
+    g_return_if_fail (NAUTILUS_IS_QUERY (query));
+
+    query->fuzzy = fuzzy;
+}
+
 NautilusSearchTimeType
 nautilus_query_get_search_type (NautilusQuery *query)
 {
@@ -520,3 +737,107 @@ nautilus_query_is_global (NautilusQuery *self)
 
     return (self->location == NULL);
 }
+
+static gboolean
+date_ranges_equal (GPtrArray *a,
+                   GPtrArray *b)
+{
+    if (a == NULL || b == NULL)
+    {
+        return a == b;
+    }
+
+    return a->len == b->len &&
+           g_date_time_equal (g_ptr_array_index (a, 0), g_ptr_array_index (b, 0)) &&
+           g_date_time_equal (g_ptr_array_index (a, 1), g_ptr_array_index (b, 1));
+}
+
+static gboolean
+mime_types_equal (GPtrArray *a,
+                  GPtrArray *b)
+{
+    if (a->len != b->len)
+    {
+        return FALSE;
+    }
+
+    for (guint i = 0; i < a->len; i++)
+    {
+        if (!g_str_equal (g_ptr_array_index (a, i), g_ptr_array_index (b, i)))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * nautilus_query_is_refinement_of:
+ * @query: A #NautilusQuery
+ * @previous: The #NautilusQuery searched for before
+ *
+ * Whether every string matched by @query is also matched by @previous, with
+ * all other filters being equal. This is the case when the text was only
+ * extended, e.g. when typing "rep", "repo", "report". Results of @previous
+ * can then be filtered instead of searching again.
+ *
+ * Returns: whether @query narrows down @previous
+ */
+gboolean
+nautilus_query_is_refinement_of (NautilusQuery *query,
+                                 NautilusQuery *previous)
+{
+    g_return_val_if_fail (NAUTILUS_IS_QUERY (query), FALSE);
+    g_return_val_if_fail (NAUTILUS_IS_QUERY (previous), FALSE);
+
+    if ((query->location == NULL) != (previous->location == NULL) ||
+        (query->location != NULL && !g_file_equal (query->location, previous->location)) ||
+        query->show_hidden != previous->show_hidden ||
+        query->recursion_tradeoff != previous->recursion_tradeoff ||
+        query->search_type != previous->search_type ||
+        query->search_content != previous->search_content ||
+        query->fuzzy != previous->fuzzy ||
+        !mime_types_equal (query->mime_types, previous->mime_types) ||
+        !date_ranges_equal (query->date_range, previous->date_range))
+    {
+        return FALSE;
+    }
+
+    if (query->fuzzy)
+    {
+        /* Longer words tolerate more typos, so they may match more. */
+        return FALSE;
+    }
+
+    if (previous->prepared_words == NULL)
+    {
+        /* Everything matched before. */
+        return TRUE;
+    }
+    else if (query->prepared_words == NULL)
+    {
+        return FALSE;
+    }
+
+    /* A string containing all new words must contain all previous words. */
+    for (guint i = 0; i < previous->prepared_words->len; i++)
+    {
+        GString *previous_word = previous->prepared_words->pdata[i];
+        gboolean contained = FALSE;
+
+        for (guint j = 0; j < query->prepared_words->len && !contained; j++)
+        {
+            GString *word = query->prepared_words->pdata[j];
+
+            contained = (strstr (word->str, previous_word->str) != NULL);
+        }
+
+        if (!contained)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
@@ -60,6 +60,10 @@ nautilus_query_get_search_content (NautilusQuery *query);
 gboolean
 nautilus_query_update_search_content (NautilusQuery *self);
 
+gboolean       nautilus_query_get_fuzzy          (NautilusQuery *query);
+void           nautilus_query_set_fuzzy          (NautilusQuery *query,
+                                                  gboolean       fuzzy);
+
 NautilusSearchTimeType nautilus_query_get_search_type (NautilusQuery *query);
 void                   nautilus_query_set_search_type (NautilusQuery           *query,
                                                        NautilusSearchTimeType   type);
@@ -80,3 +84,5 @@ gdouble        nautilus_query_matches_string     (NautilusQuery *query, const gc
 gboolean       nautilus_query_has_active_filter  (NautilusQuery *query);
 gboolean       nautilus_query_is_empty           (NautilusQuery *query);
 gboolean       nautilus_query_is_global          (NautilusQuery *query);
+gboolean       nautilus_query_is_refinement_of   (NautilusQuery *query,
+                                                  NautilusQuery *previous);
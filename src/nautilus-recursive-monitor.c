@@ -0,0 +1,533 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "nautilus-recursive-monitor"
+
+#include "nautilus-recursive-monitor.h"
+
+#include "nautilus-file-changes-queue.h"
+#include "nautilus-monitor.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <glib-unix.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Monitors the directories of a local tree that its owner asks for, feeding
+ * the changes to the file changes queue like the per-directory monitors do.
+ * Used where following each directory with its own monitor is not practical,
+ * e.g. for recursive search results, where only the directories holding hits
+ * are watched rather than the whole tree.
+ *
+ * The root is always watched, so that its removal is noticed. The watches
+ * are taken from a pool shared by all recursive monitors, bounded to a
+ * fraction of the per user limit: past the limit, further directories are
+ * not watched, leaving room for the regular monitors and other programs. */
+
+#ifdef __linux__
+
+#define INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                      IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | \
+                      IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+/* Fraction of fs.inotify.max_user_watches recursive monitors may use */
+#define WATCH_POOL_FRACTION 4
+#define WATCH_POOL_MAX 65536
+#define DEFAULT_MAX_USER_WATCHES 8192
+
+#define EVENT_BUFFER_SIZE 16384
+
+struct NautilusRecursiveMonitor
+{
+    char *root_path;
+    int fd;
+    guint source_id;
+
+    NautilusRecursiveMonitorOverflowFunc overflow_func;
+    gpointer overflow_data;
+    guint overflow_idle_id;
+
+    /* Maps watch descriptors => directory paths */
+    GHashTable *watches;
+    /* Maps directory paths => watch descriptors, sharing the paths above */
+    GHashTable *watched_paths;
+    int root_wd;
+    /* Set once the root is gone, after which nothing is watched anymore */
+    gboolean root_removed;
+
+    /* The last IN_MOVED_FROM, until paired with an IN_MOVED_TO */
+    guint32 move_cookie;
+    char *move_path;
+};
+
+static guint n_pool_watches;
+
+static guint
+get_watch_pool_size (void)
+{
+    static guint pool_size = 0;
+
+    if (G_UNLIKELY (pool_size == 0))
+    {
+        g_autofree char *contents = NULL;
+        guint64 max_user_watches = DEFAULT_MAX_USER_WATCHES;
+
+        if (g_file_get_contents ("/proc/sys/fs/inotify/max_user_watches", &contents, NULL, NULL))
+        {
+            max_user_watches = g_ascii_strtoull (contents, NULL, 10);
+        }
+
+        pool_size = CLAMP (max_user_watches / WATCH_POOL_FRACTION, 1, WATCH_POOL_MAX);
+    }
+
+    return pool_size;
+}
+
+static void
+overflow_idle_cb (gpointer user_data)
+{
+    NautilusRecursiveMonitor *monitor = user_data;
+
+    monitor->overflow_idle_id = 0;
+    monitor->overflow_func (monitor->overflow_data);
+}
+
+/* Events were lost, so the owner has to find out what changed. Reported
+ * from an idle, as the owner may cancel the monitor in response. */
+static void
+report_overflow (NautilusRecursiveMonitor *monitor)
+{
+    g_debug ("Event queue overflow for %s", monitor->root_path);
+
+    if (monitor->overflow_func != NULL && monitor->overflow_idle_id == 0)
+    {
+        monitor->overflow_idle_id = g_idle_add_once (overflow_idle_cb, monitor);
+    }
+}
+
+static gboolean
+is_in_tree (NautilusRecursiveMonitor *monitor,
+            const char               *path)
+{
+    size_t root_length = strlen (monitor->root_path);
+
+    return strncmp (path, monitor->root_path, root_length) == 0 &&
+           (path[root_length] == '/' || path[root_length] == '\0' ||
+            root_length == 1);
+}
+
+static void
+forget_watch (NautilusRecursiveMonitor *monitor,
+              int                       wd)
+{
+    const char *path = g_hash_table_lookup (monitor->watches, GINT_TO_POINTER (wd));
+
+    if (path != NULL)
+    {
+        g_hash_table_remove (monitor->watched_paths, path);
+        g_hash_table_remove (monitor->watches, GINT_TO_POINTER (wd));
+        n_pool_watches -= 1;
+    }
+}
+
+static int
+add_watch (NautilusRecursiveMonitor *monitor,
+           const char               *path)
+{
+    if (n_pool_watches >= get_watch_pool_size ())
+    {
+        g_debug ("Watch pool exhausted, not watching %s", path);
+        return -1;
+    }
+
+    int wd = inotify_add_watch (monitor->fd, path, INOTIFY_MASK);
+
+    if (wd < 0)
+    {
+        g_debug ("Cannot watch %s: %s", path, g_strerror (errno));
+        return -1;
+    }
+
+    /* The same directory under another path, e.g. through a bind mount */
+    forget_watch (monitor, wd);
+
+    char *watch_path = g_strdup (path);
+
+    g_hash_table_insert (monitor->watches, GINT_TO_POINTER (wd), watch_path);
+    g_hash_table_insert (monitor->watched_paths, watch_path, GINT_TO_POINTER (wd));
+    n_pool_watches += 1;
+
+    return wd;
+}
+
+/* Updates the paths of the watches under a renamed directory */
+static void
+move_watches (NautilusRecursiveMonitor *monitor,
+              const char               *from_path,
+              const char               *to_path)
+{
+    size_t from_length = strlen (from_path);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, monitor->watches);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        const char *path = value;
+
+        if (strncmp (path, from_path, from_length) == 0 &&
+            (path[from_length] == '/' || path[from_length] == '\0'))
+        {
+            char *new_path = g_strconcat (to_path, path + from_length, NULL);
+
+            g_hash_table_remove (monitor->watched_paths, path);
+            g_hash_table_iter_replace (&iter, new_path);
+            g_hash_table_insert (monitor->watched_paths, new_path, key);
+        }
+    }
+}
+
+/* Stops watching the directories under @path, which left the tree */
+static void
+remove_watches (NautilusRecursiveMonitor *monitor,
+                const char               *path)
+{
+    size_t length = strlen (path);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, monitor->watches);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        const char *watch_path = value;
+
+        if (strncmp (watch_path, path, length) == 0 &&
+            (watch_path[length] == '/' || watch_path[length] == '\0'))
+        {
+            inotify_rm_watch (monitor->fd, GPOINTER_TO_INT (key));
+            g_hash_table_remove (monitor->watched_paths, watch_path);
+            g_hash_table_iter_remove (&iter);
+            n_pool_watches -= 1;
+        }
+    }
+}
+
+/* The root was deleted or moved away: nothing is left to watch, and the
+ * owner is told to check its files again. */
+static void
+remove_root (NautilusRecursiveMonitor *monitor)
+{
+    GHashTableIter iter;
+    gpointer key;
+
+    g_debug ("%s was removed, stopping", monitor->root_path);
+
+    g_hash_table_iter_init (&iter, monitor->watches);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        inotify_rm_watch (monitor->fd, GPOINTER_TO_INT (key));
+    }
+
+    n_pool_watches -= g_hash_table_size (monitor->watches);
+    g_hash_table_remove_all (monitor->watched_paths);
+    g_hash_table_remove_all (monitor->watches);
+    g_clear_pointer (&monitor->move_path, g_free);
+
+    monitor->root_removed = TRUE;
+    report_overflow (monitor);
+}
+
+static void
+flush_pending_move (NautilusRecursiveMonitor *monitor)
+{
+    if (monitor->move_path != NULL)
+    {
+        /* Moved out of the tree */
+        g_autoptr (GFile) file = g_file_new_for_path (monitor->move_path);
+
+        nautilus_file_changes_queue_file_removed (file);
+        remove_watches (monitor, monitor->move_path);
+        g_clear_pointer (&monitor->move_path, g_free);
+    }
+}
+
+static void
+inotify_handle_event (NautilusRecursiveMonitor *monitor,
+                      struct inotify_event     *event)
+{
+    if (event->mask & IN_Q_OVERFLOW)
+    {
+        report_overflow (monitor);
+        return;
+    }
+
+    const char *directory_path = g_hash_table_lookup (monitor->watches, GINT_TO_POINTER (event->wd));
+
+    if (event->mask & IN_IGNORED)
+    {
+        forget_watch (monitor, event->wd);
+        return;
+    }
+
+    if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+    {
+        struct stat statbuf;
+
+        /* May stop watching the directory, if it left the tree */
+        flush_pending_move (monitor);
+        directory_path = g_hash_table_lookup (monitor->watches, GINT_TO_POINTER (event->wd));
+
+        if (directory_path == NULL)
+        {
+            return;
+        }
+
+        if (event->wd == monitor->root_wd)
+        {
+            remove_root (monitor);
+        }
+        else if (lstat (directory_path, &statbuf) != 0)
+        {
+            /* Moved without the parent being watched, so its files were
+             * not seen leaving. Removals are already reported one by one. */
+            if (event->mask & IN_MOVE_SELF)
+            {
+                g_autofree char *moved_path = g_strdup (directory_path);
+
+                remove_watches (monitor, moved_path);
+                report_overflow (monitor);
+            }
+        }
+
+        return;
+    }
+
+    if (directory_path == NULL || event->len == 0)
+    {
+        return;
+    }
+
+    g_autofree char *path = g_build_filename (directory_path, event->name, NULL);
+    g_autoptr (GFile) file = g_file_new_for_path (path);
+
+    if (!(event->mask & IN_MOVED_TO))
+    {
+        flush_pending_move (monitor);
+    }
+
+    if (event->mask & IN_CREATE)
+    {
+        nautilus_file_changes_queue_file_added (file);
+    }
+    else if (event->mask & IN_DELETE)
+    {
+        nautilus_file_changes_queue_file_removed (file);
+    }
+    else if (event->mask & IN_MOVED_FROM)
+    {
+        monitor->move_cookie = event->cookie;
+        monitor->move_path = g_steal_pointer (&path);
+    }
+    else if (event->mask & IN_MOVED_TO)
+    {
+        if (monitor->move_path != NULL && monitor->move_cookie == event->cookie)
+        {
+            g_autoptr (GFile) from = g_file_new_for_path (monitor->move_path);
+
+            nautilus_file_changes_queue_file_moved (from, file);
+
+            if (event->mask & IN_ISDIR)
+            {
+                move_watches (monitor, monitor->move_path, path);
+            }
+
+            g_clear_pointer (&monitor->move_path, g_free);
+        }
+        else
+        {
+            flush_pending_move (monitor);
+            nautilus_file_changes_queue_file_added (file);
+        }
+    }
+    else if (event->mask & (IN_CLOSE_WRITE | IN_ATTRIB))
+    {
+        nautilus_file_changes_queue_file_changed (file);
+    }
+}
+
+static void
+inotify_read_events (NautilusRecursiveMonitor *monitor)
+{
+    char buffer[EVENT_BUFFER_SIZE] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    ssize_t length;
+
+    while (!monitor->root_removed &&
+           (length = read (monitor->fd, buffer, sizeof (buffer))) > 0)
+    {
+        for (char *p = buffer; p < buffer + length && !monitor->root_removed;)
+        {
+            struct inotify_event *event = (struct inotify_event *) p;
+
+            inotify_handle_event (monitor, event);
+            p += sizeof (struct inotify_event) + event->len;
+        }
+    }
+
+    /* Both halves of a move are read together */
+    flush_pending_move (monitor);
+}
+
+static gboolean
+inotify_setup (NautilusRecursiveMonitor *monitor)
+{
+    int fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd < 0)
+    {
+        g_debug ("Cannot initialize inotify: %s", g_strerror (errno));
+        return FALSE;
+    }
+
+    monitor->fd = fd;
+    monitor->watches = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    monitor->watched_paths = g_hash_table_new (g_str_hash, g_str_equal);
+    monitor->root_wd = add_watch (monitor, monitor->root_path);
+
+    return monitor->root_wd >= 0;
+}
+
+static gboolean
+events_ready_cb (gint         fd,
+                 GIOCondition condition,
+                 gpointer     user_data)
+{
+    NautilusRecursiveMonitor *monitor = user_data;
+
+    inotify_read_events (monitor);
+    nautilus_monitor_schedule_consume_changes ();
+
+    if (monitor->root_removed)
+    {
+        monitor->source_id = 0;
+
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+#else /* __linux__ */
+
+struct NautilusRecursiveMonitor
+{
+    char unused;
+};
+
+#endif /* __linux__ */
+
+/**
+ * nautilus_recursive_monitor_new:
+ * @location: The root of the tree to monitor
+ * @overflow_func: (nullable): Called when changes were lost
+ * @user_data: Data for @overflow_func
+ *
+ * Returns: (transfer full) (nullable): A monitor to cancel with
+ *   nautilus_recursive_monitor_cancel(), or %NULL if @location cannot be
+ *   monitored recursively, e.g. because it is not local.
+ */
+NautilusRecursiveMonitor *
+nautilus_recursive_monitor_new (GFile                                *location,
+                                NautilusRecursiveMonitorOverflowFunc  overflow_func,
+                                gpointer                              user_data)
+{
+#ifdef __linux__
+    g_autofree char *path = g_file_get_path (location);
+
+    if (path == NULL || !g_file_is_native (location))
+    {
+        return NULL;
+    }
+
+    NautilusRecursiveMonitor *monitor = g_new0 (NautilusRecursiveMonitor, 1);
+
+    monitor->root_path = g_steal_pointer (&path);
+    monitor->overflow_func = overflow_func;
+    monitor->overflow_data = user_data;
+    monitor->fd = -1;
+
+    if (!inotify_setup (monitor))
+    {
+        nautilus_recursive_monitor_cancel (monitor);
+
+        return NULL;
+    }
+
+    g_debug ("Monitoring %s", monitor->root_path);
+
+    monitor->source_id = g_unix_fd_add (monitor->fd, G_IO_IN, events_ready_cb, monitor);
+
+    return monitor;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * nautilus_recursive_monitor_add_directory:
+ * @monitor: A recursive monitor
+ * @directory: A directory in the monitored tree
+ *
+ * Starts watching @directory, unless it is already watched, is outside the
+ * tree, or the watch pool is exhausted.
+ */
+void
+nautilus_recursive_monitor_add_directory (NautilusRecursiveMonitor *monitor,
+                                          GFile                    *directory)
+{
+#ifdef __linux__
+    g_autofree char *path = g_file_get_path (directory);
+
+    if (path == NULL ||
+        monitor->root_removed ||
+        !is_in_tree (monitor, path) ||
+        g_hash_table_contains (monitor->watched_paths, path))
+    {
+        return;
+    }
+
+    add_watch (monitor, path);
+#endif
+}
+
+void
+nautilus_recursive_monitor_cancel (NautilusRecursiveMonitor *monitor)
+{
+#ifdef __linux__
+    g_clear_handle_id (&monitor->source_id, g_source_remove);
+    g_clear_handle_id (&monitor->overflow_idle_id, g_source_remove);
+
+    if (monitor->watches != NULL)
+    {
+        n_pool_watches -= g_hash_table_size (monitor->watches);
+        g_clear_pointer (&monitor->watched_paths, g_hash_table_destroy);
+        g_clear_pointer (&monitor->watches, g_hash_table_destroy);
+    }
+
+    if (monitor->fd >= 0)
+    {
+        close (monitor->fd);
+    }
+
+    g_free (monitor->move_path);
+    g_free (monitor->root_path);
+#endif
+
+    g_free (monitor);
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct NautilusRecursiveMonitor NautilusRecursiveMonitor;
+
+typedef void (*NautilusRecursiveMonitorOverflowFunc) (gpointer user_data);
+
+NautilusRecursiveMonitor *nautilus_recursive_monitor_new           (GFile                                *location,
+                                                                    NautilusRecursiveMonitorOverflowFunc  overflow_func,
+                                                                    gpointer                              user_data);
+void                      nautilus_recursive_monitor_add_directory (NautilusRecursiveMonitor             *monitor,
+                                                                    GFile                                *directory);
+void                      nautilus_recursive_monitor_cancel        (NautilusRecursiveMonitor             *monitor);
+
+G_END_DECLS
@@ -0,0 +1,306 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+#define G_LOG_DOMAIN "nautilus-search"
+
+#include <config.h>
+#include "nautilus-search-crawl.h"
+
+#include <gio/gunixmounts.h>
+
+/* State shared by the search engines which crawl folders themselves. */
+
+/* Process-wide cache of directory listings, shared by all concurrent and
+ * back-to-back searches. Listings are keyed by directory file ID and only
+ * used while the directory modification time is unchanged. The whole cache
+ * is dropped once it hasn't been used for CRAWL_CACHE_TIME_SPAN.
+ */
+#define CRAWL_CACHE_TIME_SPAN (30 * G_TIME_SPAN_SECOND)
+#define CRAWL_CACHE_MAX_INFOS 200000
+
+typedef struct
+{
+    guint64 mtime;
+    guint32 mtime_usec;
+    gboolean has_content_type;
+    gint64 timestamp;
+    GPtrArray *infos;        /* GFileInfos, read-only once cached */
+} CrawlCacheEntry;
+
+static GMutex crawl_cache_mutex;
+static GHashTable *crawl_cache = NULL;
+static guint crawl_cache_n_infos = 0;
+static gint64 crawl_cache_last_use = 0;
+static guint crawl_cache_expiry_id = 0;
+
+static void
+crawl_cache_entry_free (CrawlCacheEntry *entry)
+{
+    crawl_cache_n_infos -= entry->infos->len;
+    g_ptr_array_unref (entry->infos);
+    g_free (entry);
+}
+
+static gboolean
+crawl_cache_expire (gpointer user_data)
+{
+    G_MUTEX_AUTO_LOCK (&crawl_cache_mutex, locker);
+
+    if (g_get_monotonic_time () - crawl_cache_last_use < CRAWL_CACHE_TIME_SPAN)
+    {
+        return G_SOURCE_CONTINUE;
+    }
+
+    g_clear_pointer (&crawl_cache, g_hash_table_unref);
+    crawl_cache_expiry_id = 0;
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Must be called with the cache locked. */
+static void
+crawl_cache_touch (gint64 now)
+{
+    crawl_cache_last_use = now;
+
+    if (crawl_cache_expiry_id == 0)
+    {
+        crawl_cache_expiry_id = g_timeout_add_seconds (CRAWL_CACHE_TIME_SPAN / G_TIME_SPAN_SECOND,
+                                                       crawl_cache_expire, NULL);
+    }
+}
+
+/**
+ * nautilus_search_crawl_cache_lookup:
+ * @dir_info: Info with %NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES of a directory
+ * @needs_content_type: Whether the listing must have content types
+ *
+ * Returns: (transfer full) (nullable): the cached listing of the directory
+ *   described by @dir_info
+ */
+GPtrArray *
+nautilus_search_crawl_cache_lookup (GFileInfo *dir_info,
+                                    gboolean   needs_content_type)
+{
+    const char *id = g_file_info_get_attribute_string (dir_info, G_FILE_ATTRIBUTE_ID_FILE);
+    CrawlCacheEntry *entry;
+
+    if (id == NULL)
+    {
+        return NULL;
+    }
+
+    G_MUTEX_AUTO_LOCK (&crawl_cache_mutex, locker);
+
+    if (crawl_cache == NULL)
+    {
+        return NULL;
+    }
+
+    gint64 now = g_get_monotonic_time ();
+
+    crawl_cache_touch (now);
+
+    entry = g_hash_table_lookup (crawl_cache, id);
+    if (entry == NULL ||
+        (needs_content_type && !entry->has_content_type))
+    {
+        return NULL;
+    }
+
+    if (now - entry->timestamp > CRAWL_CACHE_TIME_SPAN ||
+        entry->mtime != g_file_info_get_attribute_uint64 (dir_info, G_FILE_ATTRIBUTE_TIME_MODIFIED) ||
+        entry->mtime_usec != g_file_info_get_attribute_uint32 (dir_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC))
+    {
+        g_hash_table_remove (crawl_cache, id);
+        return NULL;
+    }
+
+    return g_ptr_array_ref (entry->infos);
+}
+
+/**
+ * nautilus_search_crawl_cache_insert:
+ * @dir_info: Info with %NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES of a directory
+ * @infos: The complete listing of the directory, with
+ *   %NAUTILUS_SEARCH_CRAWL_ATTRIBUTES
+ * @has_content_type: Whether @infos have content types as well
+ */
+void
+nautilus_search_crawl_cache_insert (GFileInfo *dir_info,
+                                    GPtrArray *infos,
+                                    gboolean   has_content_type)
+{
+    const char *id = g_file_info_get_attribute_string (dir_info, G_FILE_ATTRIBUTE_ID_FILE);
+    CrawlCacheEntry *entry;
+    gint64 now = g_get_monotonic_time ();
+
+    if (id == NULL || infos->len > CRAWL_CACHE_MAX_INFOS)
+    {
+        return;
+    }
+
+    G_MUTEX_AUTO_LOCK (&crawl_cache_mutex, locker);
+
+    if (crawl_cache == NULL)
+    {
+        crawl_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) crawl_cache_entry_free);
+    }
+
+    crawl_cache_touch (now);
+
+    if (crawl_cache_n_infos + infos->len > CRAWL_CACHE_MAX_INFOS)
+    {
+        GHashTableIter iter;
+
+        g_hash_table_iter_init (&iter, crawl_cache);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+        {
+            if (now - entry->timestamp > CRAWL_CACHE_TIME_SPAN)
+            {
+                g_hash_table_iter_remove (&iter);
+            }
+        }
+
+        if (crawl_cache_n_infos + infos->len > CRAWL_CACHE_MAX_INFOS)
+        {
+            g_hash_table_remove_all (crawl_cache);
+        }
+    }
+
+    entry = g_new0 (CrawlCacheEntry, 1);
+    entry->mtime = g_file_info_get_attribute_uint64 (dir_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    entry->mtime_usec = g_file_info_get_attribute_uint32 (dir_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    entry->has_content_type = has_content_type;
+    entry->timestamp = now;
+    entry->infos = g_ptr_array_ref (infos);
+
+    crawl_cache_n_infos += infos->len;
+    g_hash_table_insert (crawl_cache, g_strdup (id), entry);
+}
+
+static gboolean
+file_is_remote (GFile *file)
+{
+    g_autoptr (GFileInfo) file_system_info = g_file_query_filesystem_info (
+        file, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE, NULL, NULL);
+
+    return file_system_info != NULL &&
+           g_file_info_get_attribute_boolean (file_system_info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
+}
+
+/* Whether devices are remote, so that the file system is only queried once
+ * per device rather than for every directory. Device numbers can be reused
+ * by other mounts, so this is forgotten whenever the mount table changes.
+ */
+static GMutex remote_devices_mutex;
+static GHashTable *remote_devices = NULL;    /* device -> remote + 1 */
+/* Bumped when clearing, so that answers from before are not cached */
+static guint remote_devices_generation = 0;
+
+static void
+remote_devices_clear (void)
+{
+    G_MUTEX_AUTO_LOCK (&remote_devices_mutex, locker);
+
+    g_clear_pointer (&remote_devices, g_hash_table_unref);
+    remote_devices_generation += 1;
+}
+
+static void
+on_mounts_changed (GUnixMountMonitor *monitor,
+                   gpointer           user_data)
+{
+    remote_devices_clear ();
+}
+
+static void
+on_mount_added_or_removed (GVolumeMonitor *monitor,
+                           GMount         *mount,
+                           gpointer        user_data)
+{
+    remote_devices_clear ();
+}
+
+/**
+ * nautilus_search_crawl_directory_is_remote:
+ * @directory: A directory found while crawling
+ * @info: Its info from the listing of its parent
+ *
+ * Returns: Whether @directory is on a remote file system, and thus not
+ *   crawled by searches limited to local folders.
+ */
+gboolean
+nautilus_search_crawl_directory_is_remote (GFile     *directory,
+                                           GFileInfo *info)
+{
+    guint32 device;
+    gpointer known;
+    guint generation;
+    gboolean is_remote;
+
+    if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_DEVICE))
+    {
+        return file_is_remote (directory);
+    }
+
+    device = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+
+    g_mutex_lock (&remote_devices_mutex);
+    known = remote_devices != NULL
+            ? g_hash_table_lookup (remote_devices, GUINT_TO_POINTER (device)) : NULL;
+    generation = remote_devices_generation;
+    g_mutex_unlock (&remote_devices_mutex);
+
+    if (known != NULL)
+    {
+        return GPOINTER_TO_INT (known) - 1;
+    }
+
+    is_remote = file_is_remote (directory);
+
+    G_MUTEX_AUTO_LOCK (&remote_devices_mutex, locker);
+
+    if (generation != remote_devices_generation)
+    {
+        /* The mounts changed meanwhile, the device may be another one now */
+        return is_remote;
+    }
+
+    if (remote_devices == NULL)
+    {
+        remote_devices = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+    g_hash_table_insert (remote_devices, GUINT_TO_POINTER (device), GINT_TO_POINTER (is_remote + 1));
+
+    return is_remote;
+}
+
+/**
+ * nautilus_search_crawl_init:
+ *
+ * Starts watching mounts, to forget which devices are remote. Must be called
+ * from the main thread before crawling, e.g. from class_init of engines.
+ */
+void
+nautilus_search_crawl_init (void)
+{
+    static gsize initialized = 0;
+
+    if (g_once_init_enter (&initialized))
+    {
+        /* Kept for the lifetime of the process. */
+        g_signal_connect (g_unix_mount_monitor_get (), "mounts-changed",
+                          G_CALLBACK (on_mounts_changed), NULL);
+        GVolumeMonitor *volume_monitor = g_volume_monitor_get ();
+        g_signal_connect (volume_monitor, "mount-added",
+                          G_CALLBACK (on_mount_added_or_removed), NULL);
+        g_signal_connect (volume_monitor, "mount-removed",
+                          G_CALLBACK (on_mount_added_or_removed), NULL);
+
+        g_once_init_leave (&initialized, 1);
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* What crawling search engines list directories with */
+#define NAUTILUS_SEARCH_CRAWL_ATTRIBUTES \
+        G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+        G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+        G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
+        G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+        G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+        G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+        G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+        G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+        G_FILE_ATTRIBUTE_TIME_ACCESS "," \
+        G_FILE_ATTRIBUTE_TIME_CREATED "," \
+        G_FILE_ATTRIBUTE_ID_FILE "," \
+        G_FILE_ATTRIBUTE_UNIX_DEVICE
+
+#define NAUTILUS_SEARCH_CRAWL_ATTRIBUTES_WITH_CONTENT_TYPE \
+        NAUTILUS_SEARCH_CRAWL_ATTRIBUTES "," \
+        G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
+        G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE
+
+/* What cached listings are looked up with */
+#define NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES \
+        G_FILE_ATTRIBUTE_ID_FILE "," \
+        G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+        G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+void        nautilus_search_crawl_init                (void);
+
+GPtrArray * nautilus_search_crawl_cache_lookup        (GFileInfo *dir_info,
+                                                       gboolean   needs_content_type);
+void        nautilus_search_crawl_cache_insert        (GFileInfo *dir_info,
+                                                       GPtrArray *infos,
+                                                       gboolean   has_content_type);
+
+gboolean    nautilus_search_crawl_directory_is_remote (GFile     *directory,
+                                                       GFileInfo *info);
+
+G_END_DECLS
@@ -25,10 +25,12 @@
 #include <sys/time.h>
 
 #include "nautilus-directory-private.h"
+#include "nautilus-file-changes-queue.h"
 #include "nautilus-file-private.h"
 #include "nautilus-file-utilities.h"
 #include "nautilus-file.h"
 #include "nautilus-query.h"
+#include "nautilus-recursive-monitor.h"
 #include "nautilus-scheme.h"
 #include "nautilus-search-directory-file.h"
 #include "nautilus-search-engine.h"
@@ -41,6 +43,10 @@ struct _NautilusSearchDirectory
     NautilusQuery *query;
 
     NautilusSearchEngine *engine;
+    /* Keeps hits in subfolders up to date, whose folders are not monitored.
+     * Kept across searches in the same location. */
+    NautilusRecursiveMonitor *recursive_monitor;
+    GFile *recursive_monitor_location;
 
     gboolean search_running;
     /* When the search directory is stopped or cancelled, we might wait
@@ -153,6 +159,62 @@ is_monitoring_hidden_files (NautilusSearchDirectory *self)
     return FALSE;
 }
 
+static void
+clear_recursive_monitor (NautilusSearchDirectory *self)
+{
+    g_clear_pointer (&self->recursive_monitor, nautilus_recursive_monitor_cancel);
+    g_clear_object (&self->recursive_monitor_location);
+}
+
+/* Changes were lost: known hits are checked again, and searching again adds
+ * the ones that were missed. */
+static void
+recursive_monitor_overflow_cb (gpointer user_data)
+{
+    NautilusSearchDirectory *self = user_data;
+    GHashTableIter iter;
+    NautilusFile *file;
+
+    g_hash_table_iter_init (&iter, self->files_hash);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+    {
+        g_autoptr (GFile) location = nautilus_file_get_location (file);
+
+        nautilus_file_changes_queue_file_changed (location);
+    }
+    nautilus_file_changes_consume_changes ();
+
+    if (self->search_running)
+    {
+        nautilus_search_engine_start (self->engine, self->query);
+    }
+}
+
+static void
+update_recursive_monitor (NautilusSearchDirectory *self)
+{
+    g_autoptr (GFile) location = NULL;
+
+    if (nautilus_query_recursive (self->query))
+    {
+        location = nautilus_query_get_location (self->query);
+    }
+
+    if (location == NULL)
+    {
+        clear_recursive_monitor (self);
+    }
+    else if (self->recursive_monitor_location == NULL ||
+             !g_file_equal (location, self->recursive_monitor_location))
+    {
+        clear_recursive_monitor (self);
+        self->recursive_monitor = nautilus_recursive_monitor_new (location,
+                                                                  recursive_monitor_overflow_cb,
+                                                                  self);
+        self->recursive_monitor_location = g_steal_pointer (&location);
+    }
+}
+
 static void
 start_search (NautilusSearchDirectory *self)
 {
@@ -172,6 +234,7 @@ start_search (NautilusSearchDirectory *self)
 
     reset_file_list (self);
     nautilus_search_engine_start (self->engine, self->query);
+    update_recursive_monitor (self);
 }
 
 static void
@@ -286,6 +349,7 @@ search_monitor_remove (NautilusDirectory *directory,
     if (!self->monitor_list)
     {
         stop_search (self);
+        clear_recursive_monitor (self);
     }
 }
 
@@ -558,13 +622,28 @@ search_engine_hits_added (NautilusSearchEngine    *engine,
     GList *monitor_list;
     g_autoptr (GFile) query_location = nautilus_search_directory_get_search_location (self);
 
+    nautilus_search_hits_compute_scores (hits, now, query_location);
+
     for (guint i = 0; i < hits->len; i++)
     {
         NautilusSearchHit *hit = hits->pdata[i];
         const char *uri = nautilus_search_hit_get_uri (hit);
         NautilusFile *hit_file = nautilus_file_get_by_uri (uri);
+        GFileInfo *info = nautilus_search_hit_get_file_info (hit);
+
+        if (info != NULL && !hit_file->details->file_info_is_up_to_date)
+        {
+            /* Spares querying the file again. */
+            nautilus_file_update_info (hit_file, info);
+        }
+
+        if (g_hash_table_contains (self->files_hash, hit_file))
+        {
+            /* Found again when searching again after lost changes */
+            nautilus_file_unref (hit_file);
+            continue;
+        }
 
-        nautilus_search_hit_compute_scores (hit, now, query_location);
         nautilus_file_set_search_relevance (hit_file, nautilus_search_hit_get_relevance (hit));
         nautilus_file_set_search_fts_snippet (hit_file, nautilus_search_hit_get_fts_snippet (hit));
 
@@ -576,6 +655,16 @@ search_engine_hits_added (NautilusSearchEngine    *engine,
             nautilus_file_monitor_add (hit_file, monitor, monitor->monitor_attributes);
         }
 
+        if (self->recursive_monitor != NULL)
+        {
+            g_autoptr (GFile) parent = nautilus_file_get_parent_location (hit_file);
+
+            if (parent != NULL)
+            {
+                nautilus_recursive_monitor_add_directory (self->recursive_monitor, parent);
+            }
+        }
+
         g_signal_connect (hit_file, "changed", G_CALLBACK (file_changed), self),
 
         file_list = g_list_prepend (file_list, hit_file);
@@ -797,6 +886,7 @@ search_dispose (GObject *object)
 
     g_clear_object (&self->query);
     stop_search (self);
+    clear_recursive_monitor (self);
     search_disconnect_engine (self);
 
     g_clear_object (&self->engine);
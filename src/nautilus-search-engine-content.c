@@ -0,0 +1,730 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+#define G_LOG_DOMAIN "nautilus-search"
+
+#include <config.h>
+#include "nautilus-search-engine-content.h"
+
+#include "nautilus-localsearch-utilities.h"
+#include "nautilus-query.h"
+#include "nautilus-search-crawl.h"
+#include "nautilus-search-hit.h"
+#include "nautilus-search-provider.h"
+#include "nautilus-ui-utilities.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+/* Searches the contents of files in folders that localsearch doesn't index.
+ * The search thread crawls the folders and hands regular files to a bounded
+ * pool of workers, which read them and look for all words of the query.
+ * Files are read in chunks rather than mapped, as mappings fault when files
+ * are truncated while being searched.
+ */
+
+#define FLUSH_TIME_SPAN (250 * G_TIME_SPAN_MILLISECOND)
+
+#define MAX_WORKERS 4
+/* Files handed to the workers but not searched yet */
+#define MAX_PENDING_FILES 256
+#define MAX_FILE_SIZE (16 * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+/* Like grep, files with a NUL byte this close to the start are binary. */
+#define SNIFF_SIZE 1024
+/* Bytes shown around the match in snippets */
+#define SNIPPET_CONTEXT 40
+
+typedef struct
+{
+    GFile *file;
+    char *display_name;
+    gint64 mtime;
+    gint64 atime;
+    gint64 ctime;
+    guint depth;
+} ContentJob;
+
+typedef struct
+{
+    GFile *location;
+    GFileInfo *info;        /* From the listing of the parent, if fresh */
+    guint depth;
+} ContentDirectory;
+
+struct _NautilusSearchEngineContent
+{
+    NautilusSearchProvider parent_instance;
+
+    /* Only valid while searching */
+    GPtrArray *words;       /* lowercase GStrings */
+
+    /* Workers add hits one at a time. */
+    GMutex hits_mutex;
+    gint64 last_flush_time;
+
+    GMutex pending_mutex;
+    GCond pending_cond;
+    guint pending;
+};
+
+G_DEFINE_FINAL_TYPE (NautilusSearchEngineContent,
+                     nautilus_search_engine_content,
+                     NAUTILUS_TYPE_SEARCH_PROVIDER)
+
+static void
+content_job_free (ContentJob *job)
+{
+    g_object_unref (job->file);
+    g_free (job->display_name);
+    g_free (job);
+}
+
+static ContentDirectory *
+content_directory_new (GFile     *location,
+                       GFileInfo *info,
+                       guint      depth)
+{
+    ContentDirectory *directory = g_new0 (ContentDirectory, 1);
+
+    directory->location = location;
+    directory->info = info != NULL ? g_object_ref (info) : NULL;
+    directory->depth = depth;
+
+    return directory;
+}
+
+static void
+content_directory_free (ContentDirectory *directory)
+{
+    g_object_unref (directory->location);
+    g_clear_object (&directory->info);
+    g_free (directory);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ContentDirectory, content_directory_free)
+
+static void
+word_free (GString *word)
+{
+    g_string_free (word, TRUE);
+}
+
+static void
+finalize (GObject *object)
+{
+    NautilusSearchEngineContent *self = NAUTILUS_SEARCH_ENGINE_CONTENT (object);
+
+    g_clear_pointer (&self->words, g_ptr_array_unref);
+    g_mutex_clear (&self->hits_mutex);
+    g_mutex_clear (&self->pending_mutex);
+    g_cond_clear (&self->pending_cond);
+
+    G_OBJECT_CLASS (nautilus_search_engine_content_parent_class)->finalize (object);
+}
+
+static const char *
+find_next (const char *from,
+           const char *none,
+           char        c)
+{
+    const char *found = memchr (from, c, none - from);
+
+    return found != NULL ? found : none;
+}
+
+/* Finds @word, which is lowercase, ignoring ASCII case. Candidates for its
+ * first letter are found with memchr(), which libc vectorizes, and only
+ * those are compared.
+ */
+static const char *
+find_word (const char *contents,
+           gsize       length,
+           GString    *word)
+{
+    if (length < word->len)
+    {
+        return NULL;
+    }
+
+    /* Past the last possible start of a match */
+    const char *none = contents + length - word->len + 1;
+    char lower_c = word->str[0];
+    char upper_c = g_ascii_toupper (lower_c);
+    const char *lower = find_next (contents, none, lower_c);
+    const char *upper = (upper_c != lower_c) ? find_next (contents, none, upper_c) : none;
+
+    while (TRUE)
+    {
+        const char *candidate = MIN (lower, upper);
+
+        if (candidate == none)
+        {
+            return NULL;
+        }
+        else if (g_ascii_strncasecmp (candidate + 1, word->str + 1, word->len - 1) == 0)
+        {
+            return candidate;
+        }
+        else if (candidate == lower)
+        {
+            lower = find_next (lower + 1, none, lower_c);
+        }
+        else
+        {
+            upper = find_next (upper + 1, none, upper_c);
+        }
+    }
+}
+
+static char *
+escape_valid (const char *text,
+              gsize       length)
+{
+    g_autofree char *valid = g_utf8_make_valid (text, length);
+
+    return g_markup_escape_text (valid, -1);
+}
+
+/* Markup like the snippets of localsearch: the line around the match, cut
+ * to SNIPPET_CONTEXT bytes on both sides, with the match in bold.
+ */
+static char *
+create_snippet (const char *contents,
+                gsize       length,
+                const char *match,
+                gsize       match_length)
+{
+    const char *contents_end = contents + length;
+    const char *match_end = match + match_length;
+    const char *start = match;
+    const char *end = match_end;
+
+    while (start > contents && match - start < SNIPPET_CONTEXT && start[-1] != '\n')
+    {
+        start--;
+    }
+    while (end < contents_end && end - match_end < SNIPPET_CONTEXT && *end != '\n')
+    {
+        end++;
+    }
+
+    /* Don't cut characters in half. */
+    while (start < match && ((guchar) *start & 0xC0) == 0x80)
+    {
+        start++;
+    }
+    while (end > match_end && end < contents_end && ((guchar) *end & 0xC0) == 0x80)
+    {
+        end--;
+    }
+
+    g_autofree char *before = escape_valid (start, match - start);
+    g_autofree char *matched = escape_valid (match, match_length);
+    g_autofree char *after = escape_valid (match_end, end - match_end);
+    gboolean cut_start = (start > contents && start[-1] != '\n');
+    gboolean cut_end = (end < contents_end && *end != '\n');
+
+    return g_strconcat (cut_start ? "…" : "", before,
+                        "<b>", matched, "</b>",
+                        after, cut_end ? "…" : "",
+                        NULL);
+}
+
+static void
+add_hit (NautilusSearchEngineContent *self,
+         ContentJob                  *job,
+         char                        *snippet)
+{
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+    g_autofree char *uri = g_file_get_uri (job->file);
+    NautilusSearchHit *hit = nautilus_search_hit_new (uri);
+    gdouble match = nautilus_query_matches_string (query, job->display_name);
+    gint64 current_time;
+
+    /* Content matches count like the full-text matches of localsearch. */
+    nautilus_search_hit_set_fts_rank (hit, 1.0 + MAX (0, match));
+    nautilus_search_hit_set_fts_snippet (hit, snippet);
+    nautilus_search_hit_set_times (hit, job->mtime, job->atime, job->ctime);
+    nautilus_search_hit_set_depth (hit, job->depth);
+
+    g_mutex_lock (&self->hits_mutex);
+
+    nautilus_search_provider_add_hit (self, hit);
+
+    current_time = g_get_monotonic_time ();
+    if (current_time - self->last_flush_time >= FLUSH_TIME_SPAN)
+    {
+        self->last_flush_time = current_time;
+        nautilus_search_provider_flush_hits (self);
+    }
+
+    g_mutex_unlock (&self->hits_mutex);
+}
+
+/* Reads @stream chunk by chunk, keeping the end of the previous chunk for
+ * matches across chunks and for the context of snippets, until all words
+ * are found.
+ */
+static void
+search_stream (NautilusSearchEngineContent *self,
+               ContentJob                  *job,
+               GInputStream                *stream)
+{
+    GCancellable *cancellable = nautilus_search_provider_get_cancellable (self);
+    guint n_words = self->words->len;
+    g_autofree gboolean *found = g_new0 (gboolean, n_words);
+    guint n_found = 0;
+    g_autofree char *snippet = NULL;
+    gsize kept_size = SNIPPET_CONTEXT;
+    g_autofree char *buffer = NULL;
+    gsize length = 0;
+    gsize total = 0;
+
+    for (guint i = 0; i < n_words; i++)
+    {
+        GString *word = self->words->pdata[i];
+
+        kept_size = MAX (kept_size, word->len - 1);
+    }
+
+    buffer = g_malloc (kept_size + CHUNK_SIZE);
+
+    while (n_found < n_words && total < MAX_FILE_SIZE)
+    {
+        gsize n_read;
+
+        if (!g_input_stream_read_all (stream, buffer + length, CHUNK_SIZE,
+                                      &n_read, cancellable, NULL) ||
+            n_read == 0)
+        {
+            break;
+        }
+
+        if (total == 0 && memchr (buffer, '\0', MIN (n_read, SNIFF_SIZE)) != NULL)
+        {
+            return;
+        }
+
+        total += n_read;
+        length += n_read;
+
+        for (guint i = 0; i < n_words; i++)
+        {
+            GString *word = self->words->pdata[i];
+            const char *match;
+
+            if (found[i])
+            {
+                continue;
+            }
+
+            match = find_word (buffer, length, word);
+            if (match != NULL)
+            {
+                found[i] = TRUE;
+                n_found++;
+
+                if (i == 0)
+                {
+                    snippet = create_snippet (buffer, length, match, word->len);
+                }
+            }
+        }
+
+        if (n_read < CHUNK_SIZE)
+        {
+            /* End of file */
+            break;
+        }
+
+        gsize kept = MIN (length, kept_size);
+
+        memmove (buffer, buffer + length - kept, kept);
+        length = kept;
+    }
+
+    if (n_found == n_words)
+    {
+        add_hit (self, job, snippet);
+    }
+}
+
+static void
+search_file (ContentJob                  *job,
+             NautilusSearchEngineContent *self)
+{
+    GCancellable *cancellable = nautilus_search_provider_get_cancellable (self);
+    g_autoptr (GFileInputStream) stream = NULL;
+
+    if (self->words->len > 0 && !nautilus_search_provider_should_stop (self))
+    {
+        stream = g_file_read (job->file, cancellable, NULL);
+    }
+
+    if (stream != NULL)
+    {
+        search_stream (self, job, G_INPUT_STREAM (stream));
+    }
+
+    content_job_free (job);
+
+    g_mutex_lock (&self->pending_mutex);
+    self->pending--;
+    g_cond_signal (&self->pending_cond);
+    g_mutex_unlock (&self->pending_mutex);
+}
+
+static gboolean
+matches_filters (NautilusQuery *query,
+                 GFileInfo     *info,
+                 GPtrArray     *date_range)
+{
+    if (nautilus_query_has_mime_types (query))
+    {
+        const char *mime_type = g_file_info_get_attribute_string (
+            info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
+
+        if (mime_type == NULL)
+        {
+            mime_type = g_file_info_get_attribute_string (
+                info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE);
+        }
+
+        if (!nautilus_query_matches_mime_type (query, mime_type))
+        {
+            return FALSE;
+        }
+    }
+
+    if (date_range != NULL)
+    {
+        g_autoptr (GDateTime) target_date = NULL;
+        const char *attribute;
+        guint64 target_time;
+
+        switch (nautilus_query_get_search_type (query))
+        {
+            case NAUTILUS_SEARCH_TIME_TYPE_LAST_ACCESS:
+            {
+                attribute = G_FILE_ATTRIBUTE_TIME_ACCESS;
+            }
+            break;
+
+            case NAUTILUS_SEARCH_TIME_TYPE_CREATED:
+            {
+                attribute = G_FILE_ATTRIBUTE_TIME_CREATED;
+            }
+            break;
+
+            case NAUTILUS_SEARCH_TIME_TYPE_LAST_MODIFIED:
+            default:
+            {
+                attribute = G_FILE_ATTRIBUTE_TIME_MODIFIED;
+            }
+        }
+
+        target_time = g_file_info_get_attribute_uint64 (info, attribute);
+        if (target_time != 0)
+        {
+            target_date = g_date_time_new_from_unix_utc (target_time);
+        }
+
+        return nautilus_date_time_is_between_dates (target_date,
+                                                    g_ptr_array_index (date_range, 0),
+                                                    g_ptr_array_index (date_range, 1));
+    }
+
+    return TRUE;
+}
+
+static void
+visit_directory (NautilusSearchEngineContent *self,
+                 ContentDirectory            *directory,
+                 GQueue                      *directories,
+                 GHashTable                  *visited,
+                 GThreadPool                 *pool)
+{
+    GFile *dir = directory->location;
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+    GCancellable *cancellable = nautilus_search_provider_get_cancellable (self);
+    gboolean needs_content_type = nautilus_query_has_mime_types (query);
+    const char *attributes = needs_content_type
+                             ? NAUTILUS_SEARCH_CRAWL_ATTRIBUTES_WITH_CONTENT_TYPE : NAUTILUS_SEARCH_CRAWL_ATTRIBUTES;
+    g_autoptr (GPtrArray) date_range = nautilus_query_get_date_range (query);
+    gboolean show_hidden = nautilus_query_get_show_hidden_files (query);
+    gboolean recursion_enabled = nautilus_query_recursive (query);
+    gboolean local_only = nautilus_query_recursive_local_only (query);
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    g_autoptr (GPtrArray) infos = NULL;
+    g_autoptr (GFileInfo) dir_info = NULL;
+    gboolean complete = TRUE;
+
+    if (directory->info != NULL)
+    {
+        dir_info = g_object_ref (directory->info);
+    }
+    else
+    {
+        dir_info = g_file_query_info (dir, NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES,
+                                      G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+    }
+
+    if (dir_info != NULL)
+    {
+        infos = nautilus_search_crawl_cache_lookup (dir_info, needs_content_type);
+    }
+
+    if (infos == NULL)
+    {
+        enumerator = g_file_enumerate_children (dir, attributes,
+                                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                cancellable, NULL);
+        if (enumerator == NULL)
+        {
+            return;
+        }
+
+        /* Collected for the cache */
+        infos = g_ptr_array_new_with_free_func (g_object_unref);
+    }
+
+    for (guint i = 0; ; i++)
+    {
+        GFileInfo *info;
+
+        if (enumerator != NULL)
+        {
+            if (!g_file_enumerator_iterate (enumerator, &info, NULL, cancellable, NULL))
+            {
+                complete = FALSE;
+                break;
+            }
+            if (info == NULL)
+            {
+                break;
+            }
+
+            g_ptr_array_add (infos, g_object_ref (info));
+        }
+        else
+        {
+            if (i >= infos->len || g_cancellable_is_cancelled (cancellable))
+            {
+                break;
+            }
+
+            info = infos->pdata[i];
+        }
+
+        GFileType type = g_file_info_get_file_type (info);
+
+        if (!show_hidden &&
+            (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN) ||
+             g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP)))
+        {
+            continue;
+        }
+
+        if (type == G_FILE_TYPE_REGULAR &&
+            g_file_info_get_size (info) <= MAX_FILE_SIZE &&
+            matches_filters (query, info, date_range))
+        {
+            ContentJob *job = g_new0 (ContentJob, 1);
+
+            job->file = g_file_get_child (dir, g_file_info_get_name (info));
+            job->display_name = g_strdup (g_file_info_get_display_name (info));
+            job->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+            job->atime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_ACCESS);
+            job->ctime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CREATED);
+            job->depth = directory->depth;
+
+            /* Keep the crawler from running too far ahead of the workers. */
+            g_mutex_lock (&self->pending_mutex);
+            while (self->pending >= MAX_PENDING_FILES)
+            {
+                g_cond_wait (&self->pending_cond, &self->pending_mutex);
+            }
+            self->pending++;
+            g_mutex_unlock (&self->pending_mutex);
+
+            g_thread_pool_push (pool, job, NULL);
+        }
+        else if (type == G_FILE_TYPE_DIRECTORY && recursion_enabled)
+        {
+            const char *id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+            g_autoptr (GFile) child = g_file_get_child (dir, g_file_info_get_name (info));
+            /* Infos from the cache may be outdated, so the subdirectory is
+             * queried again to check its own cache entry in that case. */
+            GFileInfo *child_info = enumerator != NULL ? info : NULL;
+
+            /* Reading every file is expensive, so unless asked to search
+             * everywhere, stay on local file systems. */
+            if (local_only && nautilus_search_crawl_directory_is_remote (child, info))
+            {
+                continue;
+            }
+
+            if (id != NULL)
+            {
+                if (g_hash_table_contains (visited, id))
+                {
+                    continue;
+                }
+                g_hash_table_add (visited, g_strdup (id));
+            }
+
+            g_queue_push_tail (directories,
+                               content_directory_new (g_steal_pointer (&child), child_info,
+                                                      directory->depth + 1));
+        }
+    }
+
+    if (enumerator != NULL && complete && dir_info != NULL &&
+        !g_cancellable_is_cancelled (cancellable))
+    {
+        nautilus_search_crawl_cache_insert (dir_info, infos, needs_content_type);
+    }
+}
+
+static gpointer
+search_thread_func (NautilusSearchEngineContent *self)
+{
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+    GCancellable *cancellable = nautilus_search_provider_get_cancellable (self);
+    g_autoptr (GFile) toplevel = nautilus_query_get_location (query);
+    g_autoptr (GHashTable) visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_autoptr (GFileInfo) toplevel_info = NULL;
+    GQueue directories = G_QUEUE_INIT;
+    GThreadPool *pool;
+
+    pool = g_thread_pool_new ((GFunc) search_file, self,
+                              MIN (g_get_num_processors (), MAX_WORKERS),
+                              FALSE, NULL);
+
+    toplevel_info = g_file_query_info (toplevel, NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES,
+                                       G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+    if (toplevel_info != NULL)
+    {
+        const char *id = g_file_info_get_attribute_string (toplevel_info, G_FILE_ATTRIBUTE_ID_FILE);
+
+        if (id != NULL)
+        {
+            g_hash_table_add (visited, g_strdup (id));
+        }
+    }
+
+    g_queue_push_tail (&directories,
+                       content_directory_new (g_steal_pointer (&toplevel), toplevel_info, 0));
+
+    while (!nautilus_search_provider_should_stop (self) &&
+           !g_queue_is_empty (&directories))
+    {
+        g_autoptr (ContentDirectory) directory = g_queue_pop_head (&directories);
+
+        visit_directory (self, directory, &directories, visited, pool);
+    }
+
+    /* Waits for the workers, which skip the remaining files once stopped. */
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+    g_queue_clear_full (&directories, (GDestroyNotify) content_directory_free);
+
+    g_idle_add_once ((GSourceOnceFunc) nautilus_search_provider_finished, self);
+
+    return NULL;
+}
+
+static const char *
+get_name (NautilusSearchProvider *provider)
+{
+    return "content";
+}
+
+static gboolean
+run_in_thread (NautilusSearchProvider *provider)
+{
+    return TRUE;
+}
+
+static guint
+search_delay (NautilusSearchProvider *provider)
+{
+    return 500;
+}
+
+static gboolean
+should_search (NautilusSearchProvider *provider,
+               NautilusQuery          *query)
+{
+    g_autoptr (GFile) location = nautilus_query_get_location (query);
+    g_autofree char *text = nautilus_query_get_text (query);
+
+    if (location == NULL || text == NULL || !nautilus_query_get_search_content (query))
+    {
+        return FALSE;
+    }
+
+    /* Indexed folders are left to localsearch, unless it isn't running. */
+    return nautilus_localsearch_get_miner_fs_connection (NULL) == NULL ||
+           !nautilus_localsearch_directory_is_tracked (location);
+}
+
+static void
+start_search (NautilusSearchProvider *provider)
+{
+    NautilusSearchEngineContent *self = NAUTILUS_SEARCH_ENGINE_CONTENT (provider);
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+    g_autofree char *text = nautilus_query_get_text (query);
+    g_autofree char *lowercase_text = g_utf8_strdown (text, -1);
+    g_auto (GStrv) split_text = g_strsplit (lowercase_text, " ", -1);
+    g_autoptr (GThread) thread = NULL;
+
+    g_clear_pointer (&self->words, g_ptr_array_unref);
+    self->words = g_ptr_array_new_with_free_func ((GDestroyNotify) word_free);
+    for (guint i = 0; split_text[i] != NULL; i++)
+    {
+        if (split_text[i][0] != '\0')
+        {
+            g_ptr_array_add (self->words, g_string_new (split_text[i]));
+        }
+    }
+
+    self->last_flush_time = g_get_monotonic_time ();
+    self->pending = 0;
+
+    thread = g_thread_new ("nautilus-search-content", (GThreadFunc) search_thread_func, self);
+}
+
+static void
+nautilus_search_engine_content_class_init (NautilusSearchEngineContentClass *class)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (class);
+    NautilusSearchProviderClass *search_provider_class = NAUTILUS_SEARCH_PROVIDER_CLASS (class);
+
+    gobject_class->finalize = finalize;
+    search_provider_class->get_name = get_name;
+    search_provider_class->run_in_thread = run_in_thread;
+    search_provider_class->search_delay = search_delay;
+    search_provider_class->should_search = should_search;
+    search_provider_class->start_search = start_search;
+
+    nautilus_search_crawl_init ();
+}
+
+static void
+nautilus_search_engine_content_init (NautilusSearchEngineContent *self)
+{
+    g_mutex_init (&self->hits_mutex);
+    g_mutex_init (&self->pending_mutex);
+    g_cond_init (&self->pending_cond);
+}
+
+NautilusSearchEngineContent *
+nautilus_search_engine_content_new (void)
+{
+    return g_object_new (NAUTILUS_TYPE_SEARCH_ENGINE_CONTENT, NULL);
+}
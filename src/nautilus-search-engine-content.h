@@ -0,0 +1,22 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "nautilus-search-provider.h"
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define NAUTILUS_TYPE_SEARCH_ENGINE_CONTENT (nautilus_search_engine_content_get_type ())
+
+G_DECLARE_FINAL_TYPE (NautilusSearchEngineContent, nautilus_search_engine_content,
+                      NAUTILUS, SEARCH_ENGINE_CONTENT, NautilusSearchProvider);
+
+NautilusSearchEngineContent *nautilus_search_engine_content_new (void);
+
+G_END_DECLS
@@ -44,17 +44,28 @@ typedef enum
     SEARCH_FEATURE_MTIME = 1 << 5,
     SEARCH_FEATURE_CTIME = 1 << 6,
     SEARCH_FEATURE_LOCATION = 1 << 7,
+    SEARCH_FEATURE_LIMIT = 1 << 8,
 } G_GNUC_FLAG_ENUM SearchFeatures;
 
+/* Rows are read off the cursor in a thread, this many per main loop turn. */
+#define CURSOR_BATCH_SIZE 50
+/* After this many rows, the cursor is only read further when the main loop
+ * is idle, so that huge full-text result sets don't hold up the view. */
+#define PAGE_SIZE 500
+
 struct _NautilusSearchEngineLocalsearch
 {
     NautilusSearchProvider parent_instance;
 
     TrackerSparqlConnection *connection;
-    GHashTable *statements;
 
     GTimeZone *tz;
     gboolean fts_enabled;
+
+    SearchFeatures features;
+    guint page_rows;
+    guint next_page_id;
+    TrackerSparqlCursor *paused_cursor;
 };
 
 G_DEFINE_FINAL_TYPE (NautilusSearchEngineLocalsearch,
@@ -66,7 +77,8 @@ finalize (GObject *object)
 {
     NautilusSearchEngineLocalsearch *self = NAUTILUS_SEARCH_ENGINE_LOCALSEARCH (object);
 
-    g_clear_pointer (&self->statements, g_hash_table_unref);
+    g_clear_handle_id (&self->next_page_id, g_source_remove);
+    g_clear_object (&self->paused_cursor);
     /* This is a singleton, no need to unref. */
     self->connection = NULL;
 
@@ -87,28 +99,10 @@ search_finished (NautilusSearchEngineLocalsearch *self,
     nautilus_search_provider_finished (NAUTILUS_SEARCH_PROVIDER (self));
 }
 
-static void cursor_callback (GObject      *object,
-                             GAsyncResult *result,
-                             gpointer      user_data);
-
-static void
-cursor_next (NautilusSearchEngineLocalsearch *self,
-             TrackerSparqlCursor             *cursor)
+static NautilusSearchHit *
+hit_from_cursor (NautilusSearchEngineLocalsearch *self,
+                 TrackerSparqlCursor             *cursor)
 {
-    tracker_sparql_cursor_next_async (cursor,
-                                      nautilus_search_provider_get_cancellable (self),
-                                      cursor_callback,
-                                      self);
-}
-
-static void
-cursor_callback (GObject      *object,
-                 GAsyncResult *result,
-                 gpointer      user_data)
-{
-    NautilusSearchEngineLocalsearch *self = NAUTILUS_SEARCH_ENGINE_LOCALSEARCH (user_data);
-    GError *error = NULL;
-    TrackerSparqlCursor *cursor;
     NautilusSearchHit *hit;
     const char *uri;
     const char *mtime_str;
@@ -116,24 +110,8 @@ cursor_callback (GObject      *object,
     const char *ctime_str;
     const gchar *snippet;
     gdouble rank, match;
-    gboolean success;
     gchar *basename;
 
-    cursor = TRACKER_SPARQL_CURSOR (object);
-    success = tracker_sparql_cursor_next_finish (cursor, result, &error);
-
-    if (!success)
-    {
-        search_finished (self, error);
-
-        g_clear_error (&error);
-        tracker_sparql_cursor_close (cursor);
-        g_clear_object (&cursor);
-
-        return;
-    }
-
-    /* We iterate result by result, not n at a time. */
     uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
     rank = tracker_sparql_cursor_get_double (cursor, 1);
     mtime_str = tracker_sparql_cursor_get_string (cursor, 2, NULL);
@@ -196,10 +174,120 @@ cursor_callback (GObject      *object,
         nautilus_search_hit_set_creation_time (hit, date);
     }
 
-    nautilus_search_provider_add_hit (self, hit);
+    return hit;
+}
+
+static void
+cursor_batch_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+    NautilusSearchEngineLocalsearch *self = source_object;
+    TrackerSparqlCursor *cursor = task_data;
+    g_autoptr (GPtrArray) hits = g_ptr_array_new_full (CURSOR_BATCH_SIZE, g_object_unref);
+    GError *error = NULL;
+
+    while (hits->len < CURSOR_BATCH_SIZE &&
+           tracker_sparql_cursor_next (cursor, cancellable, &error))
+    {
+        g_ptr_array_add (hits, hit_from_cursor (self, cursor));
+    }
 
-    /* Get next */
-    cursor_next (self, cursor);
+    if (error != NULL)
+    {
+        g_task_return_error (task, error);
+    }
+    else
+    {
+        g_task_return_pointer (task, g_steal_pointer (&hits), (GDestroyNotify) g_ptr_array_unref);
+    }
+}
+
+static void cursor_batch_callback (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data);
+
+static void
+cursor_next_batch (NautilusSearchEngineLocalsearch *self,
+                   TrackerSparqlCursor             *cursor)
+{
+    g_autoptr (GTask) task = g_task_new (self,
+                                         nautilus_search_provider_get_cancellable (self),
+                                         cursor_batch_callback,
+                                         cursor);
+
+    g_task_set_task_data (task, cursor, NULL);
+    g_task_run_in_thread (task, cursor_batch_thread);
+}
+
+static gboolean
+next_page_cb (gpointer user_data)
+{
+    NautilusSearchEngineLocalsearch *self = user_data;
+    TrackerSparqlCursor *cursor = g_steal_pointer (&self->paused_cursor);
+
+    self->next_page_id = 0;
+
+    if (nautilus_search_provider_should_stop (self))
+    {
+        tracker_sparql_cursor_close (cursor);
+        g_object_unref (cursor);
+        search_finished (self, NULL);
+    }
+    else
+    {
+        self->page_rows = 0;
+        cursor_next_batch (self, cursor);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+cursor_batch_callback (GObject      *object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+    NautilusSearchEngineLocalsearch *self = NAUTILUS_SEARCH_ENGINE_LOCALSEARCH (object);
+    TrackerSparqlCursor *cursor = user_data;
+    g_autoptr (GPtrArray) hits = NULL;
+    g_autoptr (GError) error = NULL;
+
+    hits = g_task_propagate_pointer (G_TASK (result), &error);
+
+    if (hits == NULL)
+    {
+        tracker_sparql_cursor_close (cursor);
+        g_object_unref (cursor);
+        search_finished (self, error);
+
+        return;
+    }
+
+    for (guint i = 0; i < hits->len; i++)
+    {
+        nautilus_search_provider_add_hit (self, g_object_ref (hits->pdata[i]));
+    }
+    nautilus_search_provider_flush_hits (self);
+    self->page_rows += hits->len;
+
+    if (hits->len < CURSOR_BATCH_SIZE ||
+        nautilus_search_provider_should_stop (self))
+    {
+        tracker_sparql_cursor_close (cursor);
+        g_object_unref (cursor);
+        search_finished (self, NULL);
+    }
+    else if (self->page_rows < PAGE_SIZE)
+    {
+        cursor_next_batch (self, cursor);
+    }
+    else
+    {
+        self->paused_cursor = cursor;
+        self->next_page_id = g_idle_add_full (G_PRIORITY_LOW, next_page_cb, self, NULL);
+    }
 }
 
 static void
@@ -224,15 +312,15 @@ query_callback (GObject      *object,
     }
     else
     {
-        cursor_next (self, cursor);
+        self->page_rows = 0;
+        cursor_next_batch (self, cursor);
     }
 }
 
 static TrackerSparqlStatement *
-create_statement (NautilusSearchProvider *provider,
-                  SearchFeatures          features)
+create_statement (TrackerSparqlConnection *connection,
+                  SearchFeatures           features)
 {
-    NautilusSearchEngineLocalsearch *self = NAUTILUS_SEARCH_ENGINE_LOCALSEARCH (provider);
     GString *sparql;
     TrackerSparqlStatement *stmt;
 
@@ -362,7 +450,15 @@ create_statement (NautilusSearchProvider *provider,
 
     g_string_append (sparql, ")}");
 
-    stmt = tracker_sparql_connection_query_statement (self->connection,
+    if (features & SEARCH_FEATURE_LIMIT)
+    {
+        /* Only the best hits are shown, so they must come first. Otherwise
+         * rows are streamed in index order, as sorting them all would delay
+         * the first hit until the whole result set is known. */
+        g_string_append (sparql, " ORDER BY DESC (?rank) ?url LIMIT ~limit");
+    }
+
+    stmt = tracker_sparql_connection_query_statement (connection,
                                                       sparql->str,
                                                       NULL,
                                                       NULL);
@@ -371,6 +467,97 @@ create_statement (NautilusSearchProvider *provider,
     return stmt;
 }
 
+/* Statements are kept on the connection, so that all engines share them. */
+static TrackerSparqlStatement *
+get_statement (NautilusSearchEngineLocalsearch *self,
+               SearchFeatures                   features)
+{
+    GHashTable *statements = g_object_get_data (G_OBJECT (self->connection),
+                                                "nautilus-search-statements");
+    TrackerSparqlStatement *stmt;
+
+    if (statements == NULL)
+    {
+        statements = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
+        g_object_set_data_full (G_OBJECT (self->connection),
+                                "nautilus-search-statements",
+                                statements,
+                                (GDestroyNotify) g_hash_table_unref);
+    }
+
+    stmt = g_hash_table_lookup (statements, GUINT_TO_POINTER (features));
+    if (stmt == NULL)
+    {
+        stmt = create_statement (self->connection, features);
+        g_hash_table_insert (statements, GUINT_TO_POINTER (features), stmt);
+    }
+
+    return stmt;
+}
+
+static void
+execute_query (NautilusSearchEngineLocalsearch *self)
+{
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+    g_autoptr (GFile) location = nautilus_query_get_location (query);
+    g_autofree gchar *query_text = nautilus_query_get_text (query);
+    g_autoptr (GPtrArray) date_range = nautilus_query_get_date_range (query);
+    TrackerSparqlStatement *stmt = get_statement (self, self->features);
+
+    /* Statements are shared, so bindings are set again for every search. */
+    if (location != NULL)
+    {
+        g_autofree gchar *location_uri = g_file_get_uri (location);
+        tracker_sparql_statement_bind_string (stmt, "location", location_uri);
+    }
+
+    if (query_text != NULL)
+    {
+        tracker_sparql_statement_bind_string (stmt, "match", query_text);
+    }
+
+    if (nautilus_query_has_mime_types (query))
+    {
+        g_autofree char *mimetype_str = nautilus_query_get_mime_type_str (query);
+
+        tracker_sparql_statement_bind_string (stmt, "mimeTypes", mimetype_str);
+    }
+
+    if (date_range)
+    {
+        g_autofree gchar *initial_date_format = NULL;
+        g_autofree gchar *end_date_format = NULL;
+        GDateTime *initial_date;
+        GDateTime *end_date;
+        g_autoptr (GDateTime) shifted_end_date = NULL;
+
+        initial_date = g_ptr_array_index (date_range, 0);
+        end_date = g_ptr_array_index (date_range, 1);
+        /* As we do for other searches, we want to make the end date inclusive.
+         * For that, add a day to it */
+        shifted_end_date = g_date_time_add_days (end_date, 1);
+
+        initial_date_format = g_date_time_format_iso8601 (initial_date);
+        end_date_format = g_date_time_format_iso8601 (shifted_end_date);
+
+        tracker_sparql_statement_bind_string (stmt, "startTime",
+                                              initial_date_format);
+        tracker_sparql_statement_bind_string (stmt, "endTime",
+                                              end_date_format);
+    }
+
+    if (self->features & SEARCH_FEATURE_LIMIT)
+    {
+        tracker_sparql_statement_bind_int (stmt, "limit",
+                                           nautilus_search_provider_get_result_limit (self));
+    }
+
+    tracker_sparql_statement_execute_async (stmt,
+                                            nautilus_search_provider_get_cancellable (self),
+                                            query_callback,
+                                            self);
+}
+
 static const char *
 get_name (NautilusSearchProvider *provider)
 {
@@ -393,7 +580,6 @@ start_search (NautilusSearchProvider *provider)
     g_autofree gchar *query_text = NULL;
     g_autoptr (GPtrArray) date_range = NULL;
     NautilusSearchTimeType type;
-    TrackerSparqlStatement *stmt;
     SearchFeatures features = 0;
     NautilusQuery *query = nautilus_search_provider_get_query (self);
     g_autoptr (GFile) location = nautilus_query_get_location (query);
@@ -442,60 +628,13 @@ start_search (NautilusSearchProvider *provider)
         features |= SEARCH_FEATURE_LOCATION;
     }
 
-    stmt = g_hash_table_lookup (self->statements, GUINT_TO_POINTER (features));
-
-    if (!stmt)
+    if (nautilus_search_provider_get_result_limit (self) > 0)
     {
-        stmt = create_statement (provider, features);
-        g_hash_table_insert (self->statements,
-                             GUINT_TO_POINTER (features), stmt);
+        features |= SEARCH_FEATURE_LIMIT;
     }
 
-    if (location != NULL)
-    {
-        g_autofree gchar *location_uri = g_file_get_uri (location);
-        tracker_sparql_statement_bind_string (stmt, "location", location_uri);
-    }
-
-    if (query_text != NULL)
-    {
-        tracker_sparql_statement_bind_string (stmt, "match", query_text);
-    }
-
-    if (nautilus_query_has_mime_types (query))
-    {
-        g_autofree char *mimetype_str = nautilus_query_get_mime_type_str (query);
-
-        tracker_sparql_statement_bind_string (stmt, "mimeTypes", mimetype_str);
-    }
-
-    if (date_range)
-    {
-        g_autofree gchar *initial_date_format = NULL;
-        g_autofree gchar *end_date_format = NULL;
-        GDateTime *initial_date;
-        GDateTime *end_date;
-        g_autoptr (GDateTime) shifted_end_date = NULL;
-
-        initial_date = g_ptr_array_index (date_range, 0);
-        end_date = g_ptr_array_index (date_range, 1);
-        /* As we do for other searches, we want to make the end date inclusive.
-         * For that, add a day to it */
-        shifted_end_date = g_date_time_add_days (end_date, 1);
-
-        initial_date_format = g_date_time_format_iso8601 (initial_date);
-        end_date_format = g_date_time_format_iso8601 (shifted_end_date);
-
-        tracker_sparql_statement_bind_string (stmt, "startTime",
-                                              initial_date_format);
-        tracker_sparql_statement_bind_string (stmt, "endTime",
-                                              end_date_format);
-    }
-
-    tracker_sparql_statement_execute_async (stmt,
-                                            nautilus_search_provider_get_cancellable (self),
-                                            query_callback,
-                                            self);
+    self->features = features;
+    execute_query (self);
 }
 
 static void
@@ -515,8 +654,6 @@ nautilus_search_engine_localsearch_init (NautilusSearchEngineLocalsearch *engine
 {
     g_autoptr (GError) error = NULL;
 
-    engine->statements = g_hash_table_new_full (NULL, NULL, NULL,
-                                                g_object_unref);
     engine->connection = nautilus_localsearch_get_miner_fs_connection (&error);
     if (error != NULL)
     {
@@ -23,7 +23,9 @@
 #include <config.h>
 #include "nautilus-search-engine-simple.h"
 
+#include "nautilus-file-private.h"
 #include "nautilus-query.h"
+#include "nautilus-search-crawl.h"
 #include "nautilus-search-hit.h"
 #include "nautilus-search-provider.h"
 #include "nautilus-ui-utilities.h"
@@ -34,15 +36,42 @@
 
 #define FLUSH_TIME_SPAN (250 * G_TIME_SPAN_MILLISECOND)
 
+/* How long the state of a search is kept around for refining it */
+#define REFINE_TIME_SPAN (5 * G_TIME_SPAN_SECOND)
+#define MAX_REFINE_MATCHES 10000
+
+typedef struct
+{
+    char *display_name;
+    gint64 mtime;
+    gint64 atime;
+    gint64 ctime;
+    guint depth;
+} SimpleMatch;
+
+typedef struct
+{
+    GFile *location;
+    /* Cache key attributes, if just read while enumerating the parent */
+    GFileInfo *info;
+} CrawlDirectory;
+
 struct _NautilusSearchEngineSimple
 {
     NautilusSearchProvider parent_instance;
 
-    GQueue *directories;     /* GFiles */
+    GQueue *directories;     /* CrawlDirectories */
 
     GHashTable *visited;
 
     gint64 last_saved_time;
+
+    /* State of the last search, kept to refine it. Only accessed by the
+     * search thread while it runs. */
+    NautilusQuery *crawl_query;
+    GHashTable *matches;     /* URI -> SimpleMatch */
+    gboolean can_refine;
+    gint64 crawl_end_time;
 };
 
 G_DEFINE_FINAL_TYPE (NautilusSearchEngineSimple,
@@ -50,72 +79,169 @@ G_DEFINE_FINAL_TYPE (NautilusSearchEngineSimple,
                      NAUTILUS_TYPE_SEARCH_PROVIDER)
 
 static void
-finalize (GObject *object)
+simple_match_free (SimpleMatch *match)
 {
-    NautilusSearchEngineSimple *self = NAUTILUS_SEARCH_ENGINE_SIMPLE (object);
+    g_free (match->display_name);
+    g_free (match);
+}
 
-    g_queue_free_full (self->directories, (GDestroyNotify) g_object_unref);
-    g_hash_table_destroy (self->visited);
+static CrawlDirectory *
+crawl_directory_new (GFile     *location,
+                     GFileInfo *info)
+{
+    CrawlDirectory *directory = g_new0 (CrawlDirectory, 1);
 
-    G_OBJECT_CLASS (nautilus_search_engine_simple_parent_class)->finalize (object);
+    directory->location = location;
+    directory->info = info != NULL ? g_object_ref (info) : NULL;
+
+    return directory;
 }
 
-#define STD_ATTRIBUTES \
-        G_FILE_ATTRIBUTE_STANDARD_NAME "," \
-        G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
-        G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
-        G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
-        G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
-        G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
-        G_FILE_ATTRIBUTE_TIME_ACCESS "," \
-        G_FILE_ATTRIBUTE_TIME_CREATED "," \
-        G_FILE_ATTRIBUTE_ID_FILE
-
-#define STD_ATTRIBUTES_WITH_CONTENT_TYPE \
-        STD_ATTRIBUTES "," \
-        G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
-        G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE
+static void
+crawl_directory_free (CrawlDirectory *directory)
+{
+    g_object_unref (directory->location);
+    g_clear_object (&directory->info);
+    g_free (directory);
+}
 
-static gboolean
-file_is_remote (GFile *file)
+static void
+add_hit_for_match (NautilusSearchEngineSimple *self,
+                   const char                 *uri,
+                   SimpleMatch                *match,
+                   gdouble                     rank,
+                   GFileInfo                  *file_info)
 {
-    g_autoptr (GFileInfo) file_system_info = g_file_query_filesystem_info (
-        file, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE, NULL, NULL);
+    NautilusSearchHit *hit = nautilus_search_hit_new (uri);
+
+    nautilus_search_hit_set_fts_rank (hit, rank);
+    nautilus_search_hit_set_file_info (hit, file_info);
+    nautilus_search_hit_set_times (hit, match->mtime, match->atime, match->ctime);
+    nautilus_search_hit_set_depth (hit, match->depth);
+
+    nautilus_search_provider_add_hit (self, hit);
+}
 
-    return file_system_info != NULL &&
-           g_file_info_get_attribute_boolean (file_system_info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
+static void
+reset_crawl (NautilusSearchEngineSimple *self)
+{
+    g_queue_clear_full (self->directories, (GDestroyNotify) crawl_directory_free);
+    g_hash_table_remove_all (self->visited);
+    g_hash_table_remove_all (self->matches);
+    g_clear_object (&self->crawl_query);
+    self->can_refine = TRUE;
 }
 
 static void
+finalize (GObject *object)
+{
+    NautilusSearchEngineSimple *self = NAUTILUS_SEARCH_ENGINE_SIMPLE (object);
+
+    g_queue_free_full (self->directories, (GDestroyNotify) crawl_directory_free);
+    g_hash_table_destroy (self->visited);
+    g_hash_table_destroy (self->matches);
+    g_clear_object (&self->crawl_query);
+
+    G_OBJECT_CLASS (nautilus_search_engine_simple_parent_class)->finalize (object);
+}
+
+/* Returns: %FALSE if the search was stopped before the whole directory was
+ * visited */
+static gboolean
 visit_directory (NautilusSearchEngineSimple *self,
-                 GFile                      *dir)
+                 CrawlDirectory             *directory)
 {
+    GFile *dir = directory->location;
     NautilusQuery *query = nautilus_search_provider_get_query (self);
-    const char *attributes = nautilus_query_has_mime_types (query)
-                             ? STD_ATTRIBUTES_WITH_CONTENT_TYPE : STD_ATTRIBUTES;
+    g_autoptr (GFile) toplevel = nautilus_query_get_location (query);
+    /* Shallow parts of the crawl are listed with everything a NautilusFile
+     * needs, so that their hits don't need to be queried again when shown.
+     * Doing so deeper would add content type sniffing for the whole tree. */
+    gboolean full_info = !nautilus_query_recursive (query) || g_file_equal (dir, toplevel);
+    gboolean needs_content_type = full_info || nautilus_query_has_mime_types (query);
+    const char *attributes = full_info
+                             ? NAUTILUS_FILE_DEFAULT_ATTRIBUTES "," G_FILE_ATTRIBUTE_ID_FILE
+                             : needs_content_type
+                             ? NAUTILUS_SEARCH_CRAWL_ATTRIBUTES_WITH_CONTENT_TYPE : NAUTILUS_SEARCH_CRAWL_ATTRIBUTES;
     GCancellable *cancellable = nautilus_search_provider_get_cancellable (self);
+    g_autoptr (GFileEnumerator) enumerator = NULL;
+    g_autoptr (GPtrArray) infos = NULL;
+    gboolean complete = TRUE;
+    g_autoptr (GFileInfo) dir_info = NULL;
+
+    if (directory->info != NULL)
+    {
+        dir_info = g_object_ref (directory->info);
+    }
+    else
+    {
+        dir_info = g_file_query_info (dir, NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES,
+                                      G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+    }
 
-    g_autoptr (GFileEnumerator) enumerator = g_file_enumerate_children (
-        dir,
-        attributes,
-        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-        cancellable, NULL);
+    if (dir_info != NULL)
+    {
+        infos = nautilus_search_crawl_cache_lookup (dir_info, needs_content_type);
+    }
 
-    if (enumerator == NULL)
+    if (infos == NULL)
     {
-        return;
+        enumerator = g_file_enumerate_children (dir,
+                                                attributes,
+                                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                cancellable, NULL);
+
+        if (enumerator == NULL)
+        {
+            return !g_cancellable_is_cancelled (cancellable);
+        }
+
+        /* Collected for the cache */
+        infos = g_ptr_array_new_with_free_func (g_object_unref);
     }
 
     NautilusSearchTimeType type = nautilus_query_get_search_type (query);
     g_autoptr (GPtrArray) date_range = nautilus_query_get_date_range (query);
+    g_autofree char *relative_path = g_file_get_relative_path (toplevel, dir);
+    guint depth = 0;
     gboolean show_hidden = nautilus_query_get_show_hidden_files (query);
     gboolean recursion_enabled = nautilus_query_recursive (query);
     gboolean per_location_recursive_check = nautilus_query_recursive_local_only (query);
 
-    GFileInfo *info;
-    while (g_file_enumerator_iterate (enumerator, &info, NULL, cancellable, NULL) &&
-           info != NULL)
+    /* Counted once here for all children, for scoring. */
+    for (const char *c = relative_path; c != NULL && *c != '\0'; c++)
+    {
+        depth += (c == relative_path || *c == G_DIR_SEPARATOR);
+    }
+
+    for (guint i = 0; ; i++)
     {
+        GFileInfo *info;
+
+        if (enumerator != NULL)
+        {
+            if (!g_file_enumerator_iterate (enumerator, &info, NULL, cancellable, NULL))
+            {
+                complete = FALSE;
+                break;
+            }
+            if (info == NULL)
+            {
+                break;
+            }
+
+            g_ptr_array_add (infos, g_object_ref (info));
+        }
+        else
+        {
+            if (i >= infos->len || g_cancellable_is_cancelled (cancellable))
+            {
+                break;
+            }
+
+            info = infos->pdata[i];
+        }
+
         const char *display_name = g_file_info_get_display_name (info);
 
         if (display_name == NULL)
@@ -148,42 +274,49 @@ visit_directory (NautilusSearchEngineSimple *self,
             found = nautilus_query_matches_mime_type (query, mime_type);
         }
 
-        g_autoptr (GDateTime) mtime = g_file_info_get_modification_date_time (info);
-        g_autoptr (GDateTime) atime = g_file_info_get_access_date_time (info);
-        g_autoptr (GDateTime) ctime = g_file_info_get_creation_date_time (info);
+        /* Raw times, as dates are only needed for filtering by them */
+        gint64 mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+        gint64 atime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_ACCESS);
+        gint64 ctime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CREATED);
 
         if (found && date_range != NULL)
         {
-            GDateTime *target_date;
+            g_autoptr (GDateTime) target_date = NULL;
             GDateTime *initial_date = g_ptr_array_index (date_range, 0);
             GDateTime *end_date = g_ptr_array_index (date_range, 1);
+            gint64 target_time;
 
             switch (type)
             {
                 case NAUTILUS_SEARCH_TIME_TYPE_LAST_ACCESS:
                 {
-                    target_date = atime;
+                    target_time = atime;
                 }
                 break;
 
                 case NAUTILUS_SEARCH_TIME_TYPE_LAST_MODIFIED:
                 {
-                    target_date = mtime;
+                    target_time = mtime;
                 }
                 break;
 
                 case NAUTILUS_SEARCH_TIME_TYPE_CREATED:
                 {
-                    target_date = ctime;
+                    target_time = ctime;
                 }
                 break;
 
                 default:
                 {
-                    target_date = NULL;
+                    target_time = 0;
                 }
             }
 
+            if (target_time != 0)
+            {
+                target_date = g_date_time_new_from_unix_utc (target_time);
+            }
+
             found = nautilus_date_time_is_between_dates (target_date,
                                                          initial_date,
                                                          end_date);
@@ -192,14 +325,42 @@ visit_directory (NautilusSearchEngineSimple *self,
         if (found)
         {
             g_autofree gchar *uri = g_file_get_uri (child);
-            NautilusSearchHit *hit = nautilus_search_hit_new (uri);
 
-            nautilus_search_hit_set_fts_rank (hit, match);
-            nautilus_search_hit_set_modification_time (hit, mtime);
-            nautilus_search_hit_set_access_time (hit, atime);
-            nautilus_search_hit_set_creation_time (hit, ctime);
+            /* Directories interrupted by a previous search are visited
+             * again, so some of their children may be known already. */
+            if (!g_hash_table_contains (self->matches, uri))
+            {
+                SimpleMatch *simple_match = g_new0 (SimpleMatch, 1);
+
+                simple_match->display_name = g_strdup (display_name);
+                simple_match->mtime = mtime;
+                simple_match->atime = atime;
+                simple_match->ctime = ctime;
+                simple_match->depth = depth;
 
-            nautilus_search_provider_add_hit (self, hit);
+                /* Cached infos may be outdated, and symlinks are listed
+                 * without following them, unlike for a NautilusFile. */
+                GFileInfo *file_info = (full_info && enumerator != NULL &&
+                                        !g_file_info_get_is_symlink (info)) ? info : NULL;
+
+                add_hit_for_match (self, uri, simple_match, match, file_info);
+
+                if (self->can_refine)
+                {
+                    g_hash_table_insert (self->matches, g_steal_pointer (&uri), simple_match);
+                }
+                else
+                {
+                    simple_match_free (simple_match);
+                }
+
+                if (g_hash_table_size (self->matches) > MAX_REFINE_MATCHES)
+                {
+                    /* Too broad to be worth keeping */
+                    self->can_refine = FALSE;
+                    g_hash_table_remove_all (self->matches);
+                }
+            }
         }
 
         current_time = g_get_monotonic_time ();
@@ -211,21 +372,67 @@ visit_directory (NautilusSearchEngineSimple *self,
 
         if (recursion_enabled &&
             g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY &&
-            (!per_location_recursive_check || !file_is_remote (child)))
+            (!per_location_recursive_check || !nautilus_search_crawl_directory_is_remote (child, info)))
         {
             const char *id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+            /* Infos from the cache may be outdated, so the subdirectory is
+             * queried again to check its own cache entry in that case. */
+            GFileInfo *child_info = enumerator != NULL ? info : NULL;
 
             if (id == NULL)
             {
-                g_queue_push_tail (self->directories, g_steal_pointer (&child));
+                g_queue_push_tail (self->directories,
+                                   crawl_directory_new (g_steal_pointer (&child), child_info));
             }
             else if (!g_hash_table_contains (self->visited, id))
             {
                 g_hash_table_add (self->visited, g_strdup (id));
-                g_queue_push_tail (self->directories, g_steal_pointer (&child));
+                g_queue_push_tail (self->directories,
+                                   crawl_directory_new (g_steal_pointer (&child), child_info));
             }
         }
     }
+
+    if (g_cancellable_is_cancelled (cancellable))
+    {
+        return FALSE;
+    }
+
+    if (enumerator != NULL && complete && dir_info != NULL)
+    {
+        nautilus_search_crawl_cache_insert (dir_info, infos, needs_content_type);
+    }
+
+    return TRUE;
+}
+
+/* Filters the matches of the refined search, as none of the others can match
+ * anymore, and reports the remaining ones again.
+ */
+static void
+refine_matches (NautilusSearchEngineSimple *self)
+{
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+    GHashTableIter iter;
+    const char *uri;
+    SimpleMatch *match;
+
+    g_hash_table_iter_init (&iter, self->matches);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &uri, (gpointer *) &match))
+    {
+        gdouble rank = nautilus_query_matches_string (query, match->display_name);
+
+        if (rank > -1)
+        {
+            add_hit_for_match (self, uri, match, rank, NULL);
+        }
+        else
+        {
+            g_hash_table_iter_remove (&iter);
+        }
+    }
+
+    nautilus_search_provider_flush_hits (self);
 }
 
 
@@ -235,37 +442,54 @@ search_thread_func (NautilusSearchEngineSimple *self)
     GCancellable *cancellable = nautilus_search_provider_get_cancellable (self);
     NautilusQuery *query = nautilus_search_provider_get_query (self);
 
-    /* Insert id for toplevel directory into visited */
-    g_autoptr (GFile) toplevel = nautilus_query_get_location (query);
-    g_autoptr (GFileInfo) info = g_file_query_info (
-        toplevel, G_FILE_ATTRIBUTE_ID_FILE, G_FILE_QUERY_INFO_NONE, cancellable, NULL);
-
-    if (info != NULL)
+    if (self->crawl_query != NULL)
+    {
+        /* Continue from where the search being refined left off. */
+        refine_matches (self);
+    }
+    else
     {
-        const char *id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+        /* Insert id for toplevel directory into visited */
+        g_autoptr (GFile) toplevel = nautilus_query_get_location (query);
+        g_autoptr (GFileInfo) info = g_file_query_info (
+            toplevel, NAUTILUS_SEARCH_CRAWL_KEY_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, cancellable, NULL);
 
-        if (id != NULL)
+        if (info != NULL)
         {
-            g_hash_table_insert (self->visited, g_strdup (id), NULL);
+            const char *id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+
+            if (id != NULL)
+            {
+                g_hash_table_insert (self->visited, g_strdup (id), NULL);
+            }
         }
-    }
 
-    visit_directory (self, toplevel);
+        g_queue_push_tail (self->directories, crawl_directory_new (g_steal_pointer (&toplevel), info));
+    }
 
     while (!nautilus_search_provider_should_stop (self))
     {
-        g_autoptr (GFile) dir = g_queue_pop_head (self->directories);
+        CrawlDirectory *directory = g_queue_pop_head (self->directories);
+
+        if (directory == NULL)
+        {
+            break;
+        }
 
-        if (dir == NULL)
+        if (!visit_directory (self, directory))
         {
+            /* Keep it in the frontier for refining this search. Its info
+             * may be outdated by then. */
+            g_clear_object (&directory->info);
+            g_queue_push_head (self->directories, directory);
             break;
         }
 
-        visit_directory (self, dir);
+        crawl_directory_free (directory);
     }
 
-    g_queue_clear_full (self->directories, (GDestroyNotify) g_object_unref);
-    g_hash_table_remove_all (self->visited);
+    g_set_object (&self->crawl_query, query);
+    self->crawl_end_time = g_get_monotonic_time ();
 
     g_idle_add_once ((GSourceOnceFunc) nautilus_search_provider_finished, self);
 
@@ -313,8 +537,19 @@ start_search (NautilusSearchProvider *provider)
 {
     NautilusSearchEngineSimple *self = NAUTILUS_SEARCH_ENGINE_SIMPLE (provider);
 
-    g_return_if_fail (g_queue_is_empty (self->directories));
-    g_return_if_fail (g_hash_table_size (self->visited) == 0);
+    NautilusQuery *query = nautilus_search_provider_get_query (self);
+
+    if (self->crawl_query != NULL &&
+        self->can_refine &&
+        g_get_monotonic_time () - self->crawl_end_time < REFINE_TIME_SPAN &&
+        nautilus_query_is_refinement_of (query, self->crawl_query))
+    {
+        g_debug ("Refining previous search of simple engine");
+    }
+    else
+    {
+        reset_crawl (self);
+    }
 
     create_thread (self);
 }
@@ -331,6 +566,8 @@ nautilus_search_engine_simple_class_init (NautilusSearchEngineSimpleClass *class
     search_provider_class->search_delay = search_delay;
     search_provider_class->should_search = should_search;
     search_provider_class->start_search = start_search;
+
+    nautilus_search_crawl_init ();
 }
 
 static void
@@ -338,6 +575,9 @@ nautilus_search_engine_simple_init (NautilusSearchEngineSimple *self)
 {
     self->directories = g_queue_new ();
     self->visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    self->matches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) simple_match_free);
+    self->can_refine = TRUE;
     self->last_saved_time = g_get_monotonic_time ();
 }
 
@@ -14,6 +14,7 @@
 
 #include "nautilus-file-utilities.h"
 #include "nautilus-query.h"
+#include "nautilus-search-engine-content.h"
 #include "nautilus-search-engine-model.h"
 #include "nautilus-search-engine-localsearch.h"
 #include "nautilus-search-engine-recent.h"
@@ -22,6 +23,21 @@
 #include "nautilus-search-provider.h"
 
 #include <glib/gi18n.h>
+#include <string.h>
+
+/* Providers are started in tiers, cheapest first, so that their results
+ * can be shown before the expensive providers compete for resources. A tier
+ * that takes longer than the grace period doesn't hold back the next one.
+ */
+typedef enum
+{
+    TIER_INSTANT,   /* model, recent */
+    TIER_INDEXED,   /* localsearch */
+    TIER_CRAWL,     /* simple, content */
+    N_TIERS
+} SearchTier;
+
+#define TIER_GRACE_MS 200
 
 struct _NautilusSearchEngine
 {
@@ -29,6 +45,7 @@ struct _NautilusSearchEngine
 
     NautilusSearchType search_type;
 
+    NautilusSearchProvider *content;
     NautilusSearchProvider *localsearch;
     NautilusSearchProvider *model;
     NautilusSearchProvider *recent;
@@ -38,6 +55,15 @@ struct _NautilusSearchEngine
     guint providers_started;
     guint providers_finished;
 
+    SearchTier next_tier;
+    guint tier_pending[N_TIERS];
+    guint tier_timeout_id;
+
+    guint deadline_ms;
+    guint deadline_timeout_id;
+
+    guint result_limit;
+
     NautilusQuery *query;
     gboolean running;
     gboolean starting;
@@ -56,6 +82,7 @@ static GParamSpec *properties[N_PROPERTIES];
 enum
 {
     HITS_ADDED,
+    TIER_FINISHED,
     SEARCH_FINISHED,
     LAST_SIGNAL
 };
@@ -66,6 +93,24 @@ G_DEFINE_FINAL_TYPE (NautilusSearchEngine, nautilus_search_engine, G_TYPE_OBJECT
 static void
 check_providers_status (NautilusSearchEngine *self);
 
+static SearchTier
+provider_tier (NautilusSearchEngine   *self,
+               NautilusSearchProvider *provider)
+{
+    if (provider == self->model || provider == self->recent)
+    {
+        return TIER_INSTANT;
+    }
+    else if (provider == self->localsearch)
+    {
+        return TIER_INDEXED;
+    }
+    else
+    {
+        return TIER_CRAWL;
+    }
+}
+
 static void
 search_engine_start_provider (NautilusSearchProvider *provider,
                               NautilusSearchEngine   *self)
@@ -74,12 +119,78 @@ search_engine_start_provider (NautilusSearchProvider *provider,
     {
         return;
     }
-    else if (nautilus_search_provider_start (provider, self->query))
+
+    nautilus_search_provider_set_result_limit (provider, self->result_limit);
+    if (nautilus_search_provider_start (provider, self->query))
     {
         self->providers_started++;
+        self->tier_pending[provider_tier (self, provider)]++;
+    }
+}
+
+/* Starts tiers until one has providers still running. */
+static void
+search_engine_start_next_tiers (NautilusSearchEngine *self)
+{
+    g_clear_handle_id (&self->tier_timeout_id, g_source_remove);
+
+    while (self->next_tier < N_TIERS)
+    {
+        SearchTier tier = self->next_tier++;
+
+        g_debug ("Search engine starting tier %d", tier);
+
+        self->starting = TRUE;
+        switch (tier)
+        {
+            case TIER_INSTANT:
+            {
+                search_engine_start_provider (self->model, self);
+                search_engine_start_provider (self->recent, self);
+            }
+            break;
+
+            case TIER_INDEXED:
+            {
+                search_engine_start_provider (self->localsearch, self);
+            }
+            break;
+
+            case TIER_CRAWL:
+            {
+                search_engine_start_provider (self->simple, self);
+                search_engine_start_provider (self->content, self);
+            }
+            break;
+
+            default:
+            {
+                g_assert_not_reached ();
+            }
+        }
+        self->starting = FALSE;
+
+        if (self->tier_pending[tier] > 0)
+        {
+            self->tier_timeout_id = g_timeout_add_once (TIER_GRACE_MS,
+                                                        (GSourceOnceFunc) search_engine_start_next_tiers,
+                                                        self);
+            return;
+        }
     }
 }
 
+static void
+search_engine_deadline_cb (gpointer user_data)
+{
+    g_autoptr (NautilusSearchEngine) self = g_object_ref (user_data);
+
+    self->deadline_timeout_id = 0;
+
+    g_debug ("Search engine deadline passed");
+    nautilus_search_engine_stop (self);
+}
+
 static void
 search_engine_start_real (NautilusSearchEngine *self)
 {
@@ -87,13 +198,17 @@ search_engine_start_real (NautilusSearchEngine *self)
 
     self->providers_started = 0;
     self->providers_finished = 0;
+    self->next_tier = TIER_INSTANT;
+    memset (self->tier_pending, 0, sizeof (self->tier_pending));
 
-    self->starting = TRUE;
-    search_engine_start_provider (self->localsearch, self);
-    search_engine_start_provider (self->model, self);
-    search_engine_start_provider (self->recent, self);
-    search_engine_start_provider (self->simple, self);
-    self->starting = FALSE;
+    if (self->deadline_ms > 0)
+    {
+        self->deadline_timeout_id = g_timeout_add_once (self->deadline_ms,
+                                                        search_engine_deadline_cb,
+                                                        self);
+    }
+
+    search_engine_start_next_tiers (self);
 
     /* Providers could already be finished */
     check_providers_status (self);
@@ -112,6 +227,10 @@ nautilus_search_engine_start (NautilusSearchEngine *self,
 
     if (self->running)
     {
+        /* Tiers not started yet would use the new query. */
+        self->next_tier = N_TIERS;
+        g_clear_handle_id (&self->tier_timeout_id, g_source_remove);
+
         self->restart = TRUE;
         return;
     }
@@ -130,6 +249,10 @@ nautilus_search_engine_stop (NautilusSearchEngine *self)
 {
     g_debug ("Search engine stop");
 
+    /* Don't start the remaining tiers. */
+    self->next_tier = N_TIERS;
+    g_clear_handle_id (&self->tier_timeout_id, g_source_remove);
+
     if (self->localsearch != NULL)
     {
         nautilus_search_provider_stop (self->localsearch);
@@ -146,10 +269,65 @@ nautilus_search_engine_stop (NautilusSearchEngine *self)
     {
         nautilus_search_provider_stop (self->simple);
     }
+    if (self->content != NULL)
+    {
+        nautilus_search_provider_stop (self->content);
+    }
 
     self->restart = FALSE;
 }
 
+/**
+ * nautilus_search_engine_set_deadline:
+ * @self: a #NautilusSearchEngine
+ * @deadline_ms: latency budget in milliseconds, or 0 for none
+ *
+ * Sets how long a search may take. When the deadline passes, the search is
+ * stopped and finishes with the hits found so far.
+ */
+void
+nautilus_search_engine_set_deadline (NautilusSearchEngine *self,
+                                     guint                 deadline_ms)
+{
+    g_return_if_fail (NAUTILUS_IS_SEARCH_ENGINE (self));
+
+    self->deadline_ms = deadline_ms;
+}
+
+/**
+ * nautilus_search_engine_set_result_limit:
+ * @self: a #NautilusSearchEngine
+ * @result_limit: how many hits are shown, or 0 for all
+ *
+ * Lets providers that find the best hits first, like localsearch, stop
+ * fetching after @result_limit hits.
+ */
+void
+nautilus_search_engine_set_result_limit (NautilusSearchEngine *self,
+                                         guint                 result_limit)
+{
+    g_return_if_fail (NAUTILUS_IS_SEARCH_ENGINE (self));
+
+    self->result_limit = result_limit;
+}
+
+/**
+ * nautilus_search_engine_indexed_tier_finished:
+ * @self: a #NautilusSearchEngine
+ *
+ * Returns: Whether the providers of the instant and indexed tiers are done,
+ *   so that the remaining hits can only come from crawling.
+ */
+gboolean
+nautilus_search_engine_indexed_tier_finished (NautilusSearchEngine *self)
+{
+    g_return_val_if_fail (NAUTILUS_IS_SEARCH_ENGINE (self), FALSE);
+
+    return self->next_tier > TIER_INDEXED &&
+           self->tier_pending[TIER_INSTANT] == 0 &&
+           self->tier_pending[TIER_INDEXED] == 0;
+}
+
 static void
 search_provider_hits_added (NautilusSearchProvider *provider,
                             GPtrArray              *transferred_hits,
@@ -188,11 +366,15 @@ check_providers_status (NautilusSearchEngine *self)
 {
     g_assert (self->running);
 
-    if (self->starting || self->providers_finished < self->providers_started)
+    if (self->starting ||
+        self->next_tier < N_TIERS ||
+        self->providers_finished < self->providers_started)
     {
         return;
     }
 
+    g_clear_handle_id (&self->deadline_timeout_id, g_source_remove);
+
     if (self->restart)
     {
         g_debug ("Search engine finished and restarting");
@@ -222,11 +404,33 @@ check_providers_status (NautilusSearchEngine *self)
 }
 
 static void
-search_provider_finished (NautilusSearchEngine *self)
+search_provider_finished (NautilusSearchProvider *provider,
+                          NautilusSearchEngine   *self)
 {
+    SearchTier tier = provider_tier (self, provider);
+
     g_debug ("Search provider finished");
 
     self->providers_finished++;
+    self->tier_pending[tier]--;
+
+    /* Tiers finishing right away while starting are reported together
+     * with the tier that started them. */
+    if (self->tier_pending[tier] == 0 && !self->starting)
+    {
+        if (tier + 1 == self->next_tier)
+        {
+            search_engine_start_next_tiers (self);
+        }
+
+        if (self->running && !self->restart)
+        {
+            gboolean more_coming = self->next_tier < N_TIERS ||
+                                   self->providers_finished < self->providers_started;
+
+            g_signal_emit (self, signals[TIER_FINISHED], 0, more_coming);
+        }
+    }
 
     check_providers_status (self);
 }
@@ -248,9 +452,9 @@ setup_provider (NautilusSearchEngine    *self,
             g_signal_connect (*provider_pointer, "hits-added",
                               G_CALLBACK (search_provider_hits_added),
                               self);
-            g_signal_connect_swapped (*provider_pointer, "provider-finished",
-                                      G_CALLBACK (search_provider_finished),
-                                      self);
+            g_signal_connect (*provider_pointer, "provider-finished",
+                              G_CALLBACK (search_provider_finished),
+                              self);
         }
     }
     else
@@ -278,6 +482,8 @@ nautilus_search_engine_set_search_type (NautilusSearchEngine *self,
                     (CreateFunc) nautilus_search_engine_recent_new);
     setup_provider (self, &self->simple, NAUTILUS_SEARCH_TYPE_SIMPLE,
                     (CreateFunc) nautilus_search_engine_simple_new);
+    setup_provider (self, &self->content, NAUTILUS_SEARCH_TYPE_CONTENT,
+                    (CreateFunc) nautilus_search_engine_content_new);
 }
 
 static void
@@ -286,11 +492,14 @@ nautilus_search_engine_finalize (GObject *object)
     NautilusSearchEngine *self = NAUTILUS_SEARCH_ENGINE (object);
 
     g_hash_table_destroy (self->uris);
+    g_clear_handle_id (&self->tier_timeout_id, g_source_remove);
+    g_clear_handle_id (&self->deadline_timeout_id, g_source_remove);
 
     g_clear_object (&self->localsearch);
     g_clear_object (&self->recent);
     g_clear_object (&self->model);
     g_clear_object (&self->simple);
+    g_clear_object (&self->content);
     g_clear_object (&self->query);
 
     G_OBJECT_CLASS (nautilus_search_engine_parent_class)->finalize (object);
@@ -388,6 +597,21 @@ nautilus_search_engine_class_init (NautilusSearchEngineClass *class)
         g_cclosure_marshal_VOID__POINTER,
         G_TYPE_NONE, 1, G_TYPE_POINTER);
 
+    /**
+     * NautilusSearchEngine::tier-finished:
+     *
+     * @engine: The engine which emitted the signal.
+     * @more_coming: Whether more hits may still be added
+     *
+     * Emitted when all providers of a tier finished, cheapest tiers first.
+     * Callers may show what they have so far, or stop the search.
+     */
+    signals[TIER_FINISHED] = g_signal_new (
+        "tier-finished", G_TYPE_FROM_CLASS (object_class),
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+        g_cclosure_marshal_VOID__BOOLEAN,
+        G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+
     /**
      * NautilusSearchEngine::search-finished:
      *
@@ -21,10 +21,12 @@ typedef enum {
     NAUTILUS_SEARCH_TYPE_MODEL       = 1 << 1,
     NAUTILUS_SEARCH_TYPE_RECENT      = 1 << 2,
     NAUTILUS_SEARCH_TYPE_SIMPLE      = 1 << 3,
+    NAUTILUS_SEARCH_TYPE_CONTENT     = 1 << 4,
 
     NAUTILUS_SEARCH_TYPE_FOLDER = NAUTILUS_SEARCH_TYPE_LOCALSEARCH |
                                   NAUTILUS_SEARCH_TYPE_MODEL |
-                                  NAUTILUS_SEARCH_TYPE_SIMPLE,
+                                  NAUTILUS_SEARCH_TYPE_SIMPLE |
+                                  NAUTILUS_SEARCH_TYPE_CONTENT,
     /* This is used for both "Search Everywhere" and shell search provider. */
     NAUTILUS_SEARCH_TYPE_GLOBAL = NAUTILUS_SEARCH_TYPE_LOCALSEARCH |
                                   NAUTILUS_SEARCH_TYPE_RECENT,
@@ -48,5 +50,13 @@ nautilus_search_engine_start (NautilusSearchEngine *self,
                               NautilusQuery        *query);
 void
 nautilus_search_engine_stop (NautilusSearchEngine *self);
+void
+nautilus_search_engine_set_deadline (NautilusSearchEngine *self,
+                                     guint                 deadline_ms);
+void
+nautilus_search_engine_set_result_limit (NautilusSearchEngine *self,
+                                         guint                 result_limit);
+gboolean
+nautilus_search_engine_indexed_tier_finished (NautilusSearchEngine *self);
 
 G_END_DECLS
\ No newline at end of file
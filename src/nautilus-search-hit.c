@@ -31,11 +31,15 @@ struct _NautilusSearchHit
 
     char *uri;
 
-    GDateTime *modification_time;
-    GDateTime *access_time;
-    GDateTime *creation_time;
+    /* Unix times, 0 if unknown */
+    gint64 modification_time;
+    gint64 access_time;
+    gint64 creation_time;
+    /* Number of folders below the query location, -1 if unknown */
+    gint depth;
     gdouble fts_rank;
     gchar *fts_snippet;
+    GFileInfo *file_info;
 
     gdouble relevance;
 };
@@ -56,31 +60,62 @@ static GParamSpec *properties[NUM_PROPERTIES];
 
 G_DEFINE_FINAL_TYPE (NautilusSearchHit, nautilus_search_hit, G_TYPE_OBJECT)
 
-void
-nautilus_search_hit_compute_scores (NautilusSearchHit *hit,
-                                    GDateTime         *now,
-                                    GFile             *query_location)
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+/* Recency bonus for hits used at most the given number of days ago */
+static const gint64 recent_days[] = { 1, 7, 14, 30, 90 };
+static const gdouble recent_bonuses[G_N_ELEMENTS (recent_days) + 1] = { 100.0, 70.0, 50.0, 30.0, 10.0, 0.0 };
+
+static guint
+get_depth_below (const char *uri,
+                 GFile      *query_location,
+                 const char *location_uri,
+                 gsize       location_uri_len)
+{
+    const char *relative_path;
+    g_autofree gchar *relative_path_from_files = NULL;
+    guint dir_count = 0;
+
+    if (strncmp (uri, location_uri, location_uri_len) == 0 &&
+        uri[location_uri_len] == '/')
+    {
+        relative_path = uri + location_uri_len + 1;
+    }
+    else
+    {
+        /* Differently escaped URIs, or not below the query location */
+        g_autoptr (GFile) hit_location = g_file_new_for_uri (uri);
+
+        relative_path_from_files = g_file_get_relative_path (query_location, hit_location);
+        relative_path = relative_path_from_files;
+    }
+
+    for (const gchar *c = relative_path; c != NULL && *c != '\0'; c++)
+    {
+        dir_count += (*c == G_DIR_SEPARATOR);
+    }
+
+    return dir_count;
+}
+
+static void
+compute_scores (NautilusSearchHit *hit,
+                gint64             now,
+                GFile             *query_location,
+                const char        *location_uri,
+                gsize              location_uri_len,
+                gboolean           debug)
 {
     guint dir_count = 0;
-    GTimeSpan m_diff = G_MAXINT64;
-    GTimeSpan a_diff = G_MAXINT64;
-    GTimeSpan t_diff = G_MAXINT64;
     gdouble recent_bonus = 0.0;
     gdouble proximity_bonus = 0.0;
     gdouble match_bonus = 0.0;
 
     if (query_location != NULL)
     {
-        g_autoptr (GFile) hit_location = g_file_new_for_uri (hit->uri);
-        g_autofree gchar *relative_path = g_file_get_relative_path (query_location, hit_location);
-
-        for (gchar *c = relative_path; c != NULL && *c != '\0'; c++)
-        {
-            if (*c == G_DIR_SEPARATOR)
-            {
-                dir_count++;
-            }
-        }
+        dir_count = hit->depth >= 0
+                    ? (guint) hit->depth
+                    : get_depth_below (hit->uri, query_location, location_uri, location_uri_len);
 
         if (dir_count < 10)
         {
@@ -93,40 +128,19 @@ nautilus_search_hit_compute_scores (NautilusSearchHit *hit,
      * which makes prefix matches sort first. */
     if (dir_count != 0 || query_location == NULL)
     {
-        if (hit->modification_time != NULL)
-        {
-            m_diff = g_date_time_difference (now, hit->modification_time);
-        }
-        if (hit->access_time != NULL)
-        {
-            a_diff = g_date_time_difference (now, hit->access_time);
-        }
-        m_diff /= G_TIME_SPAN_DAY;
-        a_diff /= G_TIME_SPAN_DAY;
-        t_diff = MIN (m_diff, a_diff);
-        if (t_diff > 90)
-        {
-            recent_bonus = 0.0;
-        }
-        else if (t_diff > 30)
-        {
-            recent_bonus = 10.0;
-        }
-        else if (t_diff > 14)
-        {
-            recent_bonus = 30.0;
-        }
-        else if (t_diff > 7)
-        {
-            recent_bonus = 50.0;
-        }
-        else if (t_diff > 1)
-        {
-            recent_bonus = 70.0;
-        }
-        else
+        gint64 last_used = MAX (hit->modification_time, hit->access_time);
+
+        if (last_used != 0)
         {
-            recent_bonus = 100.0;
+            gint64 days = (now - last_used) / SECONDS_PER_DAY;
+            guint i = 0;
+
+            while (i < G_N_ELEMENTS (recent_days) && days > recent_days[i])
+            {
+                i++;
+            }
+
+            recent_bonus = recent_bonuses[i];
         }
     }
 
@@ -134,20 +148,65 @@ nautilus_search_hit_compute_scores (NautilusSearchHit *hit,
     {
         match_bonus = MIN (500, 10.0 * hit->fts_rank);
     }
-    else
-    {
-        match_bonus = 0.0;
-    }
 
     hit->relevance = recent_bonus + proximity_bonus + match_bonus;
 
-    if (g_getenv ("G_MESSAGES_DEBUG") != NULL)
+    if (G_UNLIKELY (debug))
     {
         g_debug ("Hit %s computed relevance %.2f (%.2f + %.2f + %.2f)",
                  hit->uri, hit->relevance, proximity_bonus, recent_bonus, match_bonus);
     }
 }
 
+/**
+ * nautilus_search_hits_compute_scores:
+ * @hits: (element-type NautilusSearchHit): hits to compute the relevance of
+ * @now: the current time
+ * @query_location: (nullable): the location searched in
+ *
+ * Computes the relevance of a batch of hits, sharing the work which doesn't
+ * depend on the individual hit.
+ */
+void
+nautilus_search_hits_compute_scores (GPtrArray *hits,
+                                     GDateTime *now,
+                                     GFile     *query_location)
+{
+    g_autofree char *location_uri = NULL;
+    gsize location_uri_len = 0;
+    gint64 now_unix = g_date_time_to_unix (now);
+    gboolean debug = (g_getenv ("G_MESSAGES_DEBUG") != NULL);
+
+    if (query_location != NULL)
+    {
+        location_uri = g_file_get_uri (query_location);
+        location_uri_len = strlen (location_uri);
+
+        /* Like "file:///", so that separators can be matched after it */
+        if (location_uri_len > 0 && location_uri[location_uri_len - 1] == '/')
+        {
+            location_uri_len--;
+        }
+    }
+
+    for (guint i = 0; i < hits->len; i++)
+    {
+        compute_scores (hits->pdata[i], now_unix,
+                        query_location, location_uri, location_uri_len, debug);
+    }
+}
+
+void
+nautilus_search_hit_compute_scores (NautilusSearchHit *hit,
+                                    GDateTime         *now,
+                                    GFile             *query_location)
+{
+    g_autoptr (GPtrArray) hits = g_ptr_array_new ();
+
+    g_ptr_array_add (hits, hit);
+    nautilus_search_hits_compute_scores (hits, now, query_location);
+}
+
 const char *
 nautilus_search_hit_get_uri (NautilusSearchHit *hit)
 {
@@ -166,6 +225,19 @@ nautilus_search_hit_get_fts_snippet (NautilusSearchHit *hit)
     return hit->fts_snippet;
 }
 
+/**
+ * nautilus_search_hit_get_file_info:
+ * @hit: a #NautilusSearchHit
+ *
+ * Returns: (transfer none) (nullable): the full info of the file, if the
+ *          provider queried it
+ */
+GFileInfo *
+nautilus_search_hit_get_file_info (NautilusSearchHit *hit)
+{
+    return hit->file_info;
+}
+
 static void
 nautilus_search_hit_set_uri (NautilusSearchHit *hit,
                              const char        *uri)
@@ -184,54 +256,56 @@ void
 nautilus_search_hit_set_modification_time (NautilusSearchHit *hit,
                                            GDateTime         *date)
 {
-    if (hit->modification_time != NULL)
-    {
-        g_date_time_unref (hit->modification_time);
-    }
-    if (date != NULL)
-    {
-        hit->modification_time = g_date_time_ref (date);
-    }
-    else
-    {
-        hit->modification_time = NULL;
-    }
+    hit->modification_time = (date != NULL) ? g_date_time_to_unix (date) : 0;
 }
 
 void
 nautilus_search_hit_set_access_time (NautilusSearchHit *hit,
                                      GDateTime         *date)
 {
-    if (hit->access_time != NULL)
-    {
-        g_date_time_unref (hit->access_time);
-    }
-    if (date != NULL)
-    {
-        hit->access_time = g_date_time_ref (date);
-    }
-    else
-    {
-        hit->access_time = NULL;
-    }
+    hit->access_time = (date != NULL) ? g_date_time_to_unix (date) : 0;
 }
 
 void
 nautilus_search_hit_set_creation_time (NautilusSearchHit *hit,
                                        GDateTime         *date)
 {
-    if (hit->creation_time != NULL)
-    {
-        g_date_time_unref (hit->creation_time);
-    }
-    if (date != NULL)
-    {
-        hit->creation_time = g_date_time_ref (date);
-    }
-    else
-    {
-        hit->creation_time = NULL;
-    }
+    hit->creation_time = (date != NULL) ? g_date_time_to_unix (date) : 0;
+}
+
+/**
+ * nautilus_search_hit_set_times:
+ * @hit: a #NautilusSearchHit
+ * @modification_time: Unix time, or 0 if unknown
+ * @access_time: Unix time, or 0 if unknown
+ * @creation_time: Unix time, or 0 if unknown
+ *
+ * Sets the times of @hit without creating #GDateTime objects.
+ */
+void
+nautilus_search_hit_set_times (NautilusSearchHit *hit,
+                               gint64             modification_time,
+                               gint64             access_time,
+                               gint64             creation_time)
+{
+    hit->modification_time = modification_time;
+    hit->access_time = access_time;
+    hit->creation_time = creation_time;
+}
+
+/**
+ * nautilus_search_hit_set_depth:
+ * @hit: a #NautilusSearchHit
+ * @depth: the number of folders between the query location and @hit
+ *
+ * Providers which know the depth, like crawlers, can set it to spare
+ * computing it from the URI.
+ */
+void
+nautilus_search_hit_set_depth (NautilusSearchHit *hit,
+                               guint              depth)
+{
+    hit->depth = depth;
 }
 
 void
@@ -241,6 +315,21 @@ nautilus_search_hit_set_fts_snippet (NautilusSearchHit *hit,
     g_set_str (&hit->fts_snippet, snippet);
 }
 
+/**
+ * nautilus_search_hit_set_file_info:
+ * @hit: a #NautilusSearchHit
+ * @info: (nullable): info with the attributes a #NautilusFile needs
+ *
+ * Providers which already queried the file can pass the info along, so
+ * that it doesn't need to be queried again when the hit is shown.
+ */
+void
+nautilus_search_hit_set_file_info (NautilusSearchHit *hit,
+                                   GFileInfo         *info)
+{
+    g_set_object (&hit->file_info, info);
+}
+
 static void
 nautilus_search_hit_set_property (GObject      *object,
                                   guint         arg_id,
@@ -303,6 +392,12 @@ nautilus_search_hit_set_property (GObject      *object,
     }
 }
 
+static GDateTime *
+unix_to_date_time (gint64 unix_time)
+{
+    return unix_time != 0 ? g_date_time_new_from_unix_local (unix_time) : NULL;
+}
+
 static void
 nautilus_search_hit_get_property (GObject    *object,
                                   guint       arg_id,
@@ -335,19 +430,19 @@ nautilus_search_hit_get_property (GObject    *object,
 
         case PROP_MODIFICATION_TIME:
         {
-            g_value_set_boxed (value, hit->modification_time);
+            g_value_take_boxed (value, unix_to_date_time (hit->modification_time));
         }
         break;
 
         case PROP_ACCESS_TIME:
         {
-            g_value_set_boxed (value, hit->access_time);
+            g_value_take_boxed (value, unix_to_date_time (hit->access_time));
         }
         break;
 
         case PROP_CREATION_TIME:
         {
-            g_value_set_boxed (value, hit->creation_time);
+            g_value_take_boxed (value, unix_to_date_time (hit->creation_time));
         }
         break;
 
@@ -371,20 +466,7 @@ nautilus_search_hit_finalize (GObject *object)
     NautilusSearchHit *hit = NAUTILUS_SEARCH_HIT (object);
 
     g_free (hit->uri);
-
-    if (hit->access_time != NULL)
-    {
-        g_date_time_unref (hit->access_time);
-    }
-    if (hit->modification_time != NULL)
-    {
-        g_date_time_unref (hit->modification_time);
-    }
-    if (hit->creation_time != NULL)
-    {
-        g_date_time_unref (hit->creation_time);
-    }
-
+    g_clear_object (&hit->file_info);
     g_free (hit->fts_snippet);
 
     G_OBJECT_CLASS (nautilus_search_hit_parent_class)->finalize (object);
@@ -412,19 +494,19 @@ nautilus_search_hit_class_init (NautilusSearchHitClass *class)
                             "Modification time",
                             "Modification time",
                             G_TYPE_DATE_TIME,
-                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+                            G_PARAM_READWRITE);
     properties[PROP_ACCESS_TIME] =
         g_param_spec_boxed ("access-time",
                             "access time",
                             "access time",
                             G_TYPE_DATE_TIME,
-                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+                            G_PARAM_READWRITE);
     properties[PROP_CREATION_TIME] =
         g_param_spec_boxed ("creation-time",
                             "creation time",
                             "creation time",
                             G_TYPE_DATE_TIME,
-                            G_PARAM_READWRITE | G_PARAM_CONSTRUCT);
+                            G_PARAM_READWRITE);
     properties[PROP_RELEVANCE] =
         g_param_spec_double ("relevance",
                              NULL,
@@ -452,6 +534,7 @@ nautilus_search_hit_class_init (NautilusSearchHitClass *class)
 static void
 nautilus_search_hit_init (NautilusSearchHit *hit)
 {
+    hit->depth = -1;
 }
 
 NautilusSearchHit *
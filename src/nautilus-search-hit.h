@@ -40,14 +40,26 @@ void                nautilus_search_hit_set_access_time       (NautilusSearchHit
 							       GDateTime         *date);
 void                nautilus_search_hit_set_creation_time     (NautilusSearchHit *hit,
 							       GDateTime         *date);
+void                nautilus_search_hit_set_times             (NautilusSearchHit *hit,
+                                                               gint64             modification_time,
+                                                               gint64             access_time,
+                                                               gint64             creation_time);
+void                nautilus_search_hit_set_depth             (NautilusSearchHit *hit,
+                                                               guint              depth);
 void                nautilus_search_hit_set_fts_snippet       (NautilusSearchHit *hit,
                                                                const gchar       *snippet);
+void                nautilus_search_hit_set_file_info         (NautilusSearchHit *hit,
+                                                               GFileInfo         *info);
 void                nautilus_search_hit_compute_scores        (NautilusSearchHit *hit,
                                                                GDateTime         *now,
                                                                GFile             *query_location);
+void                nautilus_search_hits_compute_scores       (GPtrArray         *hits,
+                                                               GDateTime         *now,
+                                                               GFile             *query_location);
 
 const char *        nautilus_search_hit_get_uri               (NautilusSearchHit *hit);
 gdouble             nautilus_search_hit_get_relevance         (NautilusSearchHit *hit);
 const gchar *       nautilus_search_hit_get_fts_snippet       (NautilusSearchHit *hit);
+GFileInfo *         nautilus_search_hit_get_file_info         (NautilusSearchHit *hit);
 
 G_END_DECLS
@@ -28,6 +28,8 @@ typedef struct
     guint submit_on_idle_id;
     GPtrArray *hits_to_submit;
 
+    guint result_limit;
+
     /* Thread-safe variables */
     GCancellable *cancellable;
     NautilusQuery *query;
@@ -227,6 +229,24 @@ nautilus_search_provider_finished (NautilusSearchProvider *self)
     g_signal_emit (self, signals[FINISHED], 0);
 }
 
+/**
+ * nautilus_search_provider_set_result_limit:
+ * @self: a #NautilusSearchProvider
+ * @result_limit: how many hits the consumer shows, or 0 for all
+ *
+ * Providers that find hits best first may stop after @result_limit hits.
+ */
+void
+nautilus_search_provider_set_result_limit (NautilusSearchProvider *self,
+                                           guint                   result_limit)
+{
+    g_return_if_fail (NAUTILUS_IS_SEARCH_PROVIDER (self));
+
+    NautilusSearchProviderPrivate *priv = nautilus_search_provider_get_instance_private (self);
+
+    priv->result_limit = result_limit;
+}
+
 /**
  * Protected methods, generic type for convenience.
  * These functions may be called outside the main context.
@@ -256,6 +276,14 @@ nautilus_search_provider_get_query (gpointer self)
     return priv->query;
 }
 
+guint
+nautilus_search_provider_get_result_limit (gpointer self)
+{
+    NautilusSearchProviderPrivate *priv = nautilus_search_provider_get_instance_private (self);
+
+    return priv->result_limit;
+}
+
 void
 nautilus_search_provider_add_hit (gpointer           self,
                                   NautilusSearchHit *hit)
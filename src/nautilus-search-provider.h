@@ -44,6 +44,8 @@ struct _NautilusSearchProviderClass
 gboolean       nautilus_search_provider_start           (NautilusSearchProvider *provider,
                                                          NautilusQuery *query);
 void           nautilus_search_provider_stop            (NautilusSearchProvider *provider);
+void           nautilus_search_provider_set_result_limit (NautilusSearchProvider *provider,
+                                                          guint                   result_limit);
 
 /*
  * Protected methods, generic type for convenience.
@@ -55,6 +57,8 @@ GCancellable *
 nautilus_search_provider_get_cancellable (gpointer self);
 NautilusQuery *
 nautilus_search_provider_get_query (gpointer self);
+guint
+nautilus_search_provider_get_result_limit (gpointer self);
 void
 nautilus_search_provider_add_hit (gpointer           self,
                                   NautilusSearchHit *hit);
@@ -43,6 +43,14 @@
 #include "nautilus-shell-search-provider-generated.h"
 #include "nautilus-shell-search-provider.h"
 
+/* The shell only shows a handful of results, so only the best ones are
+ * kept. Once the indexed results are in and the best ones stop changing, the
+ * search returns early with them. The engine deadline bounds the wait.
+ */
+#define MAX_RESULTS 20
+#define RESULTS_STABLE_MS 300
+#define SEARCH_DEADLINE_MS 2000
+
 typedef struct
 {
     NautilusShellSearchProvider *self;
@@ -50,10 +58,13 @@ typedef struct
     NautilusSearchEngine *engine;
     NautilusQuery *query;
 
-    GHashTable *hits;
+    GPtrArray *top_hits;     /* Sorted by descending relevance */
     GDBusMethodInvocation *invocation;
 
     gint64 start_time;
+    guint stable_timeout_id;
+    /* Whether only crawling providers may still add hits */
+    gboolean indexed_finished;
 } PendingSearch;
 
 struct _NautilusShellSearchProvider
@@ -73,7 +84,8 @@ G_DEFINE_FINAL_TYPE (NautilusShellSearchProvider, nautilus_shell_search_provider
 static void
 pending_search_free (PendingSearch *search)
 {
-    g_hash_table_destroy (search->hits);
+    g_ptr_array_unref (search->top_hits);
+    g_clear_handle_id (&search->stable_timeout_id, g_source_remove);
     g_clear_object (&search->query);
     g_signal_handlers_disconnect_by_data (G_OBJECT (search->engine), search);
     g_clear_object (&search->engine);
@@ -128,6 +140,84 @@ cancel_current_search_ignoring_partial_results (NautilusShellSearchProvider *sel
     }
 }
 
+/**
+ * pending_search_add_hit:
+ * @search: the #PendingSearch
+ * @hit: (transfer none): a #NautilusSearchHit with computed scores
+ *
+ * Returns: whether @hit made it into the best results
+ */
+static gboolean
+pending_search_add_hit (PendingSearch     *search,
+                        NautilusSearchHit *hit)
+{
+    GPtrArray *top_hits = search->top_hits;
+    const char *uri = nautilus_search_hit_get_uri (hit);
+    gdouble relevance = nautilus_search_hit_get_relevance (hit);
+    guint position;
+
+    if (top_hits->len == MAX_RESULTS &&
+        relevance <= nautilus_search_hit_get_relevance (top_hits->pdata[top_hits->len - 1]))
+    {
+        return FALSE;
+    }
+
+    for (guint i = 0; i < top_hits->len; i++)
+    {
+        NautilusSearchHit *top_hit = top_hits->pdata[i];
+
+        if (g_str_equal (uri, nautilus_search_hit_get_uri (top_hit)))
+        {
+            if (relevance <= nautilus_search_hit_get_relevance (top_hit))
+            {
+                return FALSE;
+            }
+
+            g_ptr_array_remove_index (top_hits, i);
+            break;
+        }
+    }
+
+    for (position = 0; position < top_hits->len; position++)
+    {
+        if (relevance > nautilus_search_hit_get_relevance (top_hits->pdata[position]))
+        {
+            break;
+        }
+    }
+
+    g_ptr_array_insert (top_hits, position, g_object_ref (hit));
+    if (top_hits->len > MAX_RESULTS)
+    {
+        g_ptr_array_remove_index (top_hits, top_hits->len - 1);
+    }
+
+    return TRUE;
+}
+
+static void
+results_stable_cb (gpointer user_data)
+{
+    PendingSearch *search = user_data;
+
+    search->stable_timeout_id = 0;
+
+    g_debug ("*** Best results stable, finishing early");
+
+    /* Makes the engine finish, which returns the results found so far. */
+    g_autoptr (NautilusSearchEngine) engine = g_object_ref (search->engine);
+    nautilus_search_engine_stop (engine);
+}
+
+static void
+schedule_results_stable (PendingSearch *search)
+{
+    g_clear_handle_id (&search->stable_timeout_id, g_source_remove);
+    search->stable_timeout_id = g_timeout_add_once (RESULTS_STABLE_MS,
+                                                    results_stable_cb,
+                                                    search);
+}
+
 static void
 search_hits_added_cb (NautilusSearchEngine *engine,
                       GPtrArray            *hits,
@@ -135,53 +225,55 @@ search_hits_added_cb (NautilusSearchEngine *engine,
 {
     PendingSearch *search = user_data;
     const gchar *hit_uri;
+    gboolean changed = FALSE;
     g_autoptr (GDateTime) now = g_date_time_new_now_local ();
 
     g_debug ("*** Search engine hits added");
 
+    nautilus_search_hits_compute_scores (hits, now, NULL);
+
     for (guint i = 0; i < hits->len; i += 1)
     {
         NautilusSearchHit *hit = hits->pdata[i];
 
-        nautilus_search_hit_compute_scores (hit, now, NULL);
         hit_uri = nautilus_search_hit_get_uri (hit);
         g_debug ("    %s", hit_uri);
 
-        g_hash_table_replace (search->hits,
-                              g_strdup (hit_uri),
-                              g_object_ref (g_ptr_array_index (hits, i)));
+        changed |= pending_search_add_hit (search, hit);
+    }
+
+    if (changed && search->indexed_finished && search->top_hits->len == MAX_RESULTS)
+    {
+        schedule_results_stable (search);
     }
 }
 
-static gint
-search_hit_compare_relevance (gconstpointer a,
-                              gconstpointer b)
+/* Before the index answered, the best results are likely still missing, no
+ * matter how long the cheaper providers kept them unchanged. */
+static void
+search_tier_finished_cb (NautilusSearchEngine *engine,
+                         gboolean              more_coming,
+                         gpointer              user_data)
 {
-    NautilusSearchHit *hit_a, *hit_b;
-    gdouble relevance_a, relevance_b;
-
-    hit_a = NAUTILUS_SEARCH_HIT ((gpointer) a);
-    hit_b = NAUTILUS_SEARCH_HIT ((gpointer) b);
-
-    relevance_a = nautilus_search_hit_get_relevance (hit_a);
-    relevance_b = nautilus_search_hit_get_relevance (hit_b);
+    PendingSearch *search = user_data;
 
-    if (relevance_a > relevance_b)
+    if (search->indexed_finished ||
+        (more_coming && !nautilus_search_engine_indexed_tier_finished (engine)))
     {
-        return -1;
+        return;
     }
-    else if (relevance_a == relevance_b)
+
+    search->indexed_finished = TRUE;
+
+    if (search->top_hits->len == MAX_RESULTS)
     {
-        return 0;
+        schedule_results_stable (search);
     }
-
-    return 1;
 }
 
 static void
 search_finished_cb (PendingSearch *search)
 {
-    g_autoptr (GPtrArray) hits = NULL;
     NautilusSearchHit *hit;
     GVariantBuilder builder;
     gint64 current_time;
@@ -190,14 +282,11 @@ search_finished_cb (PendingSearch *search)
     g_debug ("*** Search engine search finished - time elapsed %dms",
              (gint) ((current_time - search->start_time) / 1000));
 
-    hits = g_hash_table_get_values_as_ptr_array (search->hits);
-    g_ptr_array_sort_values (hits, search_hit_compare_relevance);
-
     g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
 
-    for (uint i = 0; i < hits->len; i++)
+    for (uint i = 0; i < search->top_hits->len; i++)
     {
-        hit = hits->pdata[i];
+        hit = search->top_hits->pdata[i];
         g_variant_builder_add (&builder, "s", nautilus_search_hit_get_uri (hit));
     }
 
@@ -382,7 +471,8 @@ search_add_volumes_and_bookmarks (PendingSearch *search)
             hit = nautilus_search_hit_new (candidate->uri);
             nautilus_search_hit_set_fts_rank (hit, match);
             nautilus_search_hit_compute_scores (hit, now, NULL);
-            g_hash_table_replace (search->hits, g_strdup (candidate->uri), hit);
+            pending_search_add_hit (search, hit);
+            g_object_unref (hit);
         }
     }
     g_list_free_full (candidates, (GDestroyNotify) search_hit_candidate_free);
@@ -428,14 +518,18 @@ execute_search (NautilusShellSearchProvider  *self,
 
     pending_search = g_slice_new0 (PendingSearch);
     pending_search->invocation = g_object_ref (invocation);
-    pending_search->hits = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+    pending_search->top_hits = g_ptr_array_new_full (MAX_RESULTS + 1, g_object_unref);
     pending_search->query = query;
     pending_search->engine = nautilus_search_engine_new (NAUTILUS_SEARCH_TYPE_GLOBAL);
+    nautilus_search_engine_set_deadline (pending_search->engine, SEARCH_DEADLINE_MS);
+    nautilus_search_engine_set_result_limit (pending_search->engine, MAX_RESULTS);
     pending_search->start_time = g_get_monotonic_time ();
     pending_search->self = self;
 
     g_signal_connect (pending_search->engine, "hits-added",
                       G_CALLBACK (search_hits_added_cb), pending_search);
+    g_signal_connect (pending_search->engine, "tier-finished",
+                      G_CALLBACK (search_tier_finished_cb), pending_search);
     g_signal_connect_swapped (pending_search->engine, "search-finished",
                               G_CALLBACK (search_finished_cb), pending_search);
 
@@ -0,0 +1,591 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "nautilus-thumbnail-warmup"
+
+#include "nautilus-thumbnail-warmup.h"
+
+#include "nautilus-global-preferences.h"
+#include "nautilus-metadata.h"
+#include "nautilus-thumbnails.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* Pre-generation of thumbnails for a whole directory tree, e.g. to fill the
+ * thumbnail cache of shared media folders ahead of time.
+ *
+ * Files go through the same thumbnailing queue as the ones requested by the
+ * views, so the factory, the failed thumbnail records and the file size
+ * limit apply exactly as they would when browsing.
+ *
+ * The tree is enumerated in worker threads put in the idle I/O scheduling
+ * class, so that the crawl only gets disk time nobody else asks for. The
+ * thumbnailers themselves run like for the views. */
+
+/* Thumbnails requested at once. The thumbnailing queue limits how many are
+ * actually generated in parallel, this only bounds the callbacks in flight. */
+#define MAX_REQUESTED_THUMBNAILS 8
+
+/* Enumeration is paused while this many files wait for being requested. */
+#define MAX_QUEUED_FILES 512
+
+#define ENUMERATION_BATCH_SIZE 100
+
+#define WARMUP_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+    G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
+    G_FILE_ATTRIBUTE_ACCESS_CAN_READ "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+    G_FILE_ATTRIBUTE_THUMBNAIL_IS_VALID "," \
+    G_FILE_ATTRIBUTE_PREVIEW_ICON "," \
+    "metadata::" NAUTILUS_METADATA_KEY_CUSTOM_ICON "," \
+    "metadata::" NAUTILUS_METADATA_KEY_CUSTOM_ICON_NAME
+
+#define FILESYSTEM_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_FILESYSTEM_USE_PREVIEW "," \
+    G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE
+
+#ifdef __linux__
+/* From linux/ioprio.h, which is not always installed */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_NONE 0
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+#endif
+
+typedef struct
+{
+    GFile *file;
+    char *mime_type;
+    time_t mtime;
+} WarmupItem;
+
+typedef struct
+{
+    /* Directories left to enumerate */
+    GQueue directories;
+    /* WarmupItems left to request a thumbnail for */
+    GQueue items;
+
+    GFileEnumerator *enumerator;
+    gboolean is_enumerating;
+    gboolean root_enumerated;
+    /* Whether the file system of the enumerated directory gets thumbnails */
+    gboolean filesystem_allowed;
+
+    guint n_requested;
+    guint n_found;
+    guint n_done;
+    guint n_generated;
+    guint64 size_limit;
+    NautilusSpeedTradeoffValue show_thumbnails;
+
+    NautilusThumbnailWarmupProgressFunc progress_callback;
+    gpointer progress_data;
+} WarmupState;
+
+typedef struct
+{
+    GTask *task;
+    WarmupItem *item;
+} ThumbnailRequest;
+
+/* One batch of files, read in a worker thread */
+typedef struct
+{
+    /* The directory to start enumerating, or NULL to go on with @enumerator */
+    GFile *directory;
+    GFileEnumerator *enumerator;
+    NautilusSpeedTradeoffValue show_thumbnails;
+
+    /* Set when starting a directory */
+    gboolean filesystem_allowed;
+    GList *infos;
+    /* Whether the directory has been enumerated completely */
+    gboolean finished;
+} EnumerationStep;
+
+static void warmup_continue (GTask *task);
+
+static void
+warmup_item_free (WarmupItem *item)
+{
+    g_object_unref (item->file);
+    g_free (item->mime_type);
+    g_free (item);
+}
+
+static void
+warmup_state_free (WarmupState *state)
+{
+    g_queue_clear_full (&state->directories, g_object_unref);
+    g_queue_clear_full (&state->items, (GDestroyNotify) warmup_item_free);
+    g_clear_object (&state->enumerator);
+    g_free (state);
+}
+
+static void
+enumeration_step_free (EnumerationStep *step)
+{
+    g_clear_object (&step->directory);
+    g_clear_object (&step->enumerator);
+    g_list_free_full (step->infos, g_object_unref);
+    g_free (step);
+}
+
+/* Puts the calling thread in the idle I/O scheduling class. Returns the
+ * previous priority, to restore before the thread goes back to the pool
+ * shared with the rest of GIO, or -1 if unchanged. */
+static int
+enter_idle_io_class (void)
+{
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    int previous = syscall (SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+
+    if (previous >= 0 &&
+        syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0)
+    {
+        /* The kernel rejects a level without a class */
+        return (previous >> IOPRIO_CLASS_SHIFT) == IOPRIO_CLASS_NONE ? 0 : previous;
+    }
+
+    g_debug ("Cannot use the idle I/O class: %s", g_strerror (errno));
+#endif
+
+    return -1;
+}
+
+static void
+leave_idle_io_class (int previous)
+{
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    if (previous >= 0)
+    {
+        syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, previous);
+    }
+#endif
+}
+
+static gboolean
+needs_thumbnail (WarmupState *state,
+                 GFile       *file,
+                 GFileInfo   *info)
+{
+    if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR ||
+        g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_THUMBNAIL_IS_VALID))
+    {
+        return FALSE;
+    }
+
+    /* Same rules as nautilus_file_should_show_thumbnail() */
+    if (g_file_info_has_attribute (info, "metadata::" NAUTILUS_METADATA_KEY_CUSTOM_ICON) ||
+        g_file_info_has_attribute (info, "metadata::" NAUTILUS_METADATA_KEY_CUSTOM_ICON_NAME))
+    {
+        return FALSE;
+    }
+
+    if (!state->filesystem_allowed &&
+        !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_PREVIEW_ICON))
+    {
+        return FALSE;
+    }
+
+    if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ) &&
+        !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ))
+    {
+        return FALSE;
+    }
+
+    const char *mime_type = g_file_info_get_content_type (info);
+
+    if (mime_type == NULL ||
+        ((guint64) g_file_info_get_size (info) > state->size_limit &&
+         nautilus_thumbnail_is_mimetype_limited_by_size (mime_type)))
+    {
+        return FALSE;
+    }
+
+    g_autofree char *uri = g_file_get_uri (file);
+    time_t mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+    /* This also skips files for which thumbnailing failed before */
+    return nautilus_can_thumbnail (uri, mime_type, mtime);
+}
+
+static void
+thumbnail_done_cb (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+    g_autofree ThumbnailRequest *request = user_data;
+    g_autoptr (GTask) task = request->task;
+    WarmupState *state = g_task_get_task_data (task);
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GdkPixbuf) pixbuf = nautilus_create_thumbnail_finish (result, &error);
+
+    state->n_requested -= 1;
+    state->n_done += 1;
+
+    if (pixbuf != NULL)
+    {
+        state->n_generated += 1;
+    }
+    else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        g_autofree char *name = g_file_get_parse_name (request->item->file);
+
+        g_debug ("Failed to generate thumbnail for %s: %s",
+                 name, error != NULL ? error->message : "unknown error");
+    }
+
+    if (state->progress_callback != NULL)
+    {
+        state->progress_callback (request->item->file,
+                                  state->n_done,
+                                  state->n_found,
+                                  state->progress_data);
+    }
+
+    warmup_item_free (request->item);
+    warmup_continue (task);
+}
+
+static void
+request_thumbnail (GTask      *task,
+                   WarmupItem *item)
+{
+    WarmupState *state = g_task_get_task_data (task);
+    ThumbnailRequest *request = g_new0 (ThumbnailRequest, 1);
+    g_autofree char *uri = g_file_get_uri (item->file);
+
+    request->task = g_object_ref (task);
+    request->item = item;
+    state->n_requested += 1;
+
+    nautilus_create_thumbnail_async (uri,
+                                     item->mime_type,
+                                     item->mtime,
+                                     g_task_get_cancellable (task),
+                                     thumbnail_done_cb,
+                                     request);
+}
+
+static void
+enumeration_step_thread (GTask        *step_task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+    EnumerationStep *step = task_data;
+    g_autoptr (GError) error = NULL;
+    int previous_ioprio = enter_idle_io_class ();
+
+    if (step->directory != NULL)
+    {
+        g_autoptr (GFileInfo) info = g_file_query_filesystem_info (step->directory,
+                                                                   FILESYSTEM_ATTRIBUTES,
+                                                                   cancellable,
+                                                                   NULL);
+        GFilesystemPreviewType use_preview = G_FILESYSTEM_PREVIEW_TYPE_IF_ALWAYS;
+        gboolean is_remote = FALSE;
+
+        if (info != NULL)
+        {
+            use_preview = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_FILESYSTEM_USE_PREVIEW);
+            is_remote = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
+        }
+
+        step->filesystem_allowed = nautilus_speed_tradeoff_applies (step->show_thumbnails,
+                                                                    use_preview,
+                                                                    is_remote);
+        step->enumerator = g_file_enumerate_children (step->directory,
+                                                      WARMUP_ATTRIBUTES,
+                                                      G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                      cancellable,
+                                                      &error);
+    }
+
+    for (guint i = 0; step->enumerator != NULL && i < ENUMERATION_BATCH_SIZE; i++)
+    {
+        g_autoptr (GError) next_error = NULL;
+        GFileInfo *info = g_file_enumerator_next_file (step->enumerator, cancellable, &next_error);
+
+        if (info == NULL)
+        {
+            if (next_error != NULL && !g_error_matches (next_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            {
+                g_autofree char *name = g_file_get_parse_name (g_file_enumerator_get_container (step->enumerator));
+
+                g_debug ("Failed to enumerate %s: %s", name, next_error->message);
+            }
+
+            step->finished = TRUE;
+            break;
+        }
+
+        step->infos = g_list_prepend (step->infos, info);
+    }
+
+    step->infos = g_list_reverse (step->infos);
+    leave_idle_io_class (previous_ioprio);
+
+    if (error != NULL)
+    {
+        g_task_return_error (step_task, g_steal_pointer (&error));
+    }
+    else
+    {
+        g_task_return_boolean (step_task, TRUE);
+    }
+}
+
+static void
+enumeration_step_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+    g_autoptr (GTask) task = user_data;
+    WarmupState *state = g_task_get_task_data (task);
+    EnumerationStep *step = g_task_get_task_data (G_TASK (result));
+    g_autoptr (GError) error = NULL;
+
+    state->is_enumerating = FALSE;
+
+    if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            if (!state->root_enumerated)
+            {
+                g_task_return_error (task, g_steal_pointer (&error));
+
+                return;
+            }
+
+            g_autofree char *name = g_file_get_parse_name (step->directory);
+
+            g_debug ("Failed to enumerate %s: %s", name, error->message);
+        }
+
+        state->root_enumerated = TRUE;
+        warmup_continue (task);
+
+        return;
+    }
+
+    if (step->directory != NULL)
+    {
+        state->filesystem_allowed = step->filesystem_allowed;
+        state->root_enumerated = TRUE;
+    }
+
+    if (step->finished)
+    {
+        /* Done with this directory */
+        g_clear_object (&state->enumerator);
+    }
+    else
+    {
+        g_set_object (&state->enumerator, step->enumerator);
+    }
+
+    for (GList *l = step->infos; l != NULL; l = l->next)
+    {
+        GFileInfo *info = l->data;
+        g_autoptr (GFile) child = g_file_enumerator_get_child (step->enumerator, info);
+
+        if (g_file_info_get_is_hidden (info))
+        {
+            continue;
+        }
+
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+            g_queue_push_tail (&state->directories, g_steal_pointer (&child));
+        }
+        else if (needs_thumbnail (state, child, info))
+        {
+            WarmupItem *item = g_new0 (WarmupItem, 1);
+
+            item->file = g_steal_pointer (&child);
+            item->mime_type = g_strdup (g_file_info_get_content_type (info));
+            item->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+            g_queue_push_tail (&state->items, item);
+            state->n_found += 1;
+        }
+    }
+
+    warmup_continue (task);
+}
+
+/* Reads the next batch of files, from @directory if not %NULL, otherwise
+ * from the directory being enumerated. */
+static void
+start_enumeration_step (GTask *task,
+                        GFile *directory)
+{
+    WarmupState *state = g_task_get_task_data (task);
+    EnumerationStep *step = g_new0 (EnumerationStep, 1);
+    g_autoptr (GTask) step_task = g_task_new (NULL,
+                                              g_task_get_cancellable (task),
+                                              enumeration_step_cb,
+                                              g_object_ref (task));
+
+    if (directory != NULL)
+    {
+        step->directory = g_object_ref (directory);
+    }
+    else
+    {
+        step->enumerator = g_object_ref (state->enumerator);
+    }
+    step->show_thumbnails = state->show_thumbnails;
+
+    state->is_enumerating = TRUE;
+    g_task_set_source_tag (step_task, start_enumeration_step);
+    g_task_set_task_data (step_task, step, (GDestroyNotify) enumeration_step_free);
+    g_task_run_in_thread (step_task, enumeration_step_thread);
+}
+
+/* Drives the whole warm up: called initially, and whenever an enumeration
+ * batch or a thumbnail request completes. */
+static void
+warmup_continue (GTask *task)
+{
+    WarmupState *state = g_task_get_task_data (task);
+    GCancellable *cancellable = g_task_get_cancellable (task);
+
+    if (g_cancellable_is_cancelled (cancellable))
+    {
+        /* Wait for the requests in flight, which hold a reference to us */
+        if (state->n_requested == 0 && !state->is_enumerating)
+        {
+            g_task_return_error_if_cancelled (task);
+        }
+
+        return;
+    }
+
+    while (state->n_requested < MAX_REQUESTED_THUMBNAILS &&
+           !g_queue_is_empty (&state->items))
+    {
+        request_thumbnail (task, g_queue_pop_head (&state->items));
+    }
+
+    if (!state->is_enumerating &&
+        g_queue_get_length (&state->items) < MAX_QUEUED_FILES)
+    {
+        if (state->enumerator != NULL)
+        {
+            start_enumeration_step (task, NULL);
+        }
+        else if (!g_queue_is_empty (&state->directories))
+        {
+            g_autoptr (GFile) directory = g_queue_pop_head (&state->directories);
+
+            start_enumeration_step (task, directory);
+        }
+    }
+
+    if (state->n_requested == 0 &&
+        !state->is_enumerating &&
+        state->enumerator == NULL &&
+        g_queue_is_empty (&state->items) &&
+        g_queue_is_empty (&state->directories))
+    {
+        g_task_return_boolean (task, TRUE);
+    }
+}
+
+/**
+ * nautilus_thumbnail_warmup_async:
+ * @root: The directory to generate thumbnails in
+ * @cancellable: (nullable): A #GCancellable
+ * @progress_callback: (nullable): Called after each file has been processed
+ * @progress_data: Data for @progress_callback
+ * @callback: Called when all files under @root have been processed
+ * @user_data: Data for @callback
+ *
+ * Generates the missing thumbnails for all files under @root, recursively.
+ *
+ * Hidden files and directories are skipped, as well as files which already
+ * have a valid thumbnail, files for which thumbnailing failed before, and
+ * files over the thumbnail file size limit. Like in the views, the setting
+ * for showing thumbnails and the preview type of the file system are
+ * respected, and thumbnails are generated at the size given by
+ * nautilus_thumbnail_get_max_size().
+ *
+ * Fails if @root can't be enumerated.
+ */
+void
+nautilus_thumbnail_warmup_async (GFile                               *root,
+                                 GCancellable                        *cancellable,
+                                 NautilusThumbnailWarmupProgressFunc  progress_callback,
+                                 gpointer                             progress_data,
+                                 GAsyncReadyCallback                  callback,
+                                 gpointer                             user_data)
+{
+    g_return_if_fail (G_IS_FILE (root));
+
+    g_autoptr (GTask) task = g_task_new (NULL, cancellable, callback, user_data);
+    WarmupState *state = g_new0 (WarmupState, 1);
+
+    g_task_set_source_tag (task, nautilus_thumbnail_warmup_async);
+
+    /* The limit is set in MB */
+    state->size_limit = g_settings_get_uint64 (nautilus_preferences,
+                                               NAUTILUS_PREFERENCES_FILE_THUMBNAIL_LIMIT) * 1000000;
+    state->show_thumbnails = g_settings_get_enum (nautilus_preferences,
+                                                  NAUTILUS_PREFERENCES_SHOW_FILE_THUMBNAILS);
+    state->progress_callback = progress_callback;
+    state->progress_data = progress_data;
+    g_queue_push_tail (&state->directories, g_object_ref (root));
+
+    g_task_set_task_data (task, state, (GDestroyNotify) warmup_state_free);
+
+    if (state->show_thumbnails == NAUTILUS_SPEED_TRADEOFF_NEVER)
+    {
+        g_task_return_boolean (task, TRUE);
+
+        return;
+    }
+
+    warmup_continue (task);
+}
+
+/**
+ * nautilus_thumbnail_warmup_finish:
+ * @result: The #GAsyncResult passed to the callback
+ * @n_generated: (out) (optional): Return location for the number of
+ *   thumbnails which were generated
+ * @error: Return location for a #GError
+ *
+ * Returns: %TRUE if the whole tree was processed, %FALSE if cancelled or
+ *   @root could not be enumerated.
+ */
+gboolean
+nautilus_thumbnail_warmup_finish (GAsyncResult  *result,
+                                  guint         *n_generated,
+                                  GError       **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+    WarmupState *state = g_task_get_task_data (G_TASK (result));
+
+    if (n_generated != NULL)
+    {
+        *n_generated = state->n_generated;
+    }
+
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
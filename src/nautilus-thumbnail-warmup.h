@@ -0,0 +1,35 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * NautilusThumbnailWarmupProgressFunc:
+ * @file: The file which was just processed
+ * @n_done: Number of files processed so far
+ * @n_found: Number of files found to need a thumbnail so far
+ * @user_data: The data passed to nautilus_thumbnail_warmup_async()
+ */
+typedef void (* NautilusThumbnailWarmupProgressFunc) (GFile    *file,
+                                                      guint     n_done,
+                                                      guint     n_found,
+                                                      gpointer  user_data);
+
+void     nautilus_thumbnail_warmup_async  (GFile                                *root,
+                                           GCancellable                         *cancellable,
+                                           NautilusThumbnailWarmupProgressFunc   progress_callback,
+                                           gpointer                              progress_data,
+                                           GAsyncReadyCallback                   callback,
+                                           gpointer                              user_data);
+gboolean nautilus_thumbnail_warmup_finish (GAsyncResult                         *result,
+                                           guint                                *n_generated,
+                                           GError                              **error);
+
+G_END_DECLS
@@ -27,9 +27,11 @@
 #define GNOME_DESKTOP_USE_UNSTABLE_API
 
 #include "nautilus-directory-notify.h"
+#include "nautilus-embedded-preview.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-file-utilities.h"
 #include "nautilus-hash-queue.h"
+#include <glycin.h>
 #include <math.h>
 #include <gtk/gtk.h>
 #include <errno.h>
@@ -46,6 +48,14 @@
 /* Cool-off period between last file modification time and thumbnail creation */
 #define THUMBNAIL_CREATION_DELAY_SECS 3
 
+/* Upper bound of the cool-off period for files which keep being modified */
+#define THUMBNAIL_CREATION_MAX_DELAY_SECS 60
+
+/* Number of one second slots of the timer wheel holding files in their
+ * cool-off period. It must be larger than the maximum delay, so that all
+ * files in a slot are due when the wheel reaches it. */
+#define THUMBNAIL_WHEEL_SLOTS 64
+
 /* This specific number of processors seems to work ok even on relatively slow
  * computers. However, this might not be the effective number of processors
  * used simultaneously because of main thread load and I/O bounds. */
@@ -68,6 +78,10 @@ typedef struct
     char *mime_type;
     time_t original_file_mtime;
     time_t updated_file_mtime;
+    /* The mtime the cool-off period was last computed for */
+    time_t scheduled_file_mtime;
+    /* How often the file was modified again during its cool-off period */
+    guint n_deferrals;
     GdkPixbuf *pixbuf;
     GPtrArray *callbacks;
 
@@ -95,6 +109,17 @@ static NautilusHashQueue *thumbnails_to_make = NULL;
 /* The icons being currently thumbnailed. */
 static GHashTable *currently_thumbnailing_hash = NULL;
 
+/* Recently modified files waiting for their cool-off period to end, each
+ *  in the slot of the second it ends at, and indexed by URI. */
+static GQueue thumbnail_wheel[THUMBNAIL_WHEEL_SLOTS];
+static GHashTable *waiting_thumbnails_hash = NULL;
+
+/* The second up to which the wheel slots have been processed. */
+static time_t thumbnail_wheel_time = 0;
+
+/* The id of the timeout advancing the wheel, or 0 if no file is waiting. */
+static guint thumbnail_wheel_tick_id = 0;
+
 /* The number of currently running threads. */
 static guint running_threads = 0;
 
@@ -433,6 +458,133 @@ nautilus_create_thumbnail_async (const gchar         *uri,
     thumbnail_enqueue (g_steal_pointer (&info), g_steal_pointer (&cb_data));
 }
 
+static guint
+get_creation_delay (NautilusThumbnailInfo *info)
+{
+    /* Back off exponentially for files which keep changing, like downloads
+     *  or render output, so they don't get thumbnailed over and over. */
+    guint delay = THUMBNAIL_CREATION_DELAY_SECS << MIN (info->n_deferrals, 5);
+
+    return MIN (delay, THUMBNAIL_CREATION_MAX_DELAY_SECS);
+}
+
+static gboolean thumbnail_wheel_tick_cb (gpointer data);
+
+static void
+thumbnail_wheel_insert (NautilusThumbnailInfo *info,
+                        time_t                 ready_time)
+{
+    if (g_hash_table_size (waiting_thumbnails_hash) == 0)
+    {
+        /* The wheel was idle, so there are no slots to catch up with */
+        thumbnail_wheel_time = time (NULL);
+    }
+
+    ready_time = CLAMP (ready_time,
+                        thumbnail_wheel_time + 1,
+                        thumbnail_wheel_time + THUMBNAIL_WHEEL_SLOTS - 1);
+
+    g_queue_push_tail (&thumbnail_wheel[ready_time % THUMBNAIL_WHEEL_SLOTS], info);
+    g_hash_table_insert (waiting_thumbnails_hash, info->image_uri, info);
+
+    if (thumbnail_wheel_tick_id == 0)
+    {
+        thumbnail_wheel_tick_id = g_timeout_add_seconds (1, thumbnail_wheel_tick_cb, NULL);
+    }
+}
+
+/* Either queues the thumbnail to be made right away, or, if the file was
+ *  modified recently, puts it in the wheel until its cool-off period is
+ *  over. This prevents constant re-thumbnailing of changing files. */
+static void
+thumbnail_schedule (NautilusThumbnailInfo *info)
+{
+    time_t current_time = time (NULL);
+    time_t mtime = info->updated_file_mtime;
+
+    handle_cancelled_callbacks (info);
+
+    if (info->callbacks->len == 0)
+    {
+        free_thumbnail_info (info);
+
+        return;
+    }
+
+    if (info->scheduled_file_mtime != INVALID_MTIME &&
+        info->scheduled_file_mtime != mtime)
+    {
+        info->n_deferrals += 1;
+    }
+    info->scheduled_file_mtime = mtime;
+
+    time_t ready_time = mtime + get_creation_delay (info);
+
+    if (current_time < ready_time && current_time >= mtime)
+    {
+        g_debug ("(Main Thread) Delaying thumbnail by %" G_GINT64_FORMAT "s: %s",
+                 (gint64) (ready_time - current_time), info->image_uri);
+
+        thumbnail_wheel_insert (info, ready_time);
+
+        return;
+    }
+
+    nautilus_hash_queue_enqueue (thumbnails_to_make, info->image_uri, info);
+
+    /* If we didn't schedule the thumbnail function to start on idle, do
+     *  that now. We don't want to start it until all the other work is
+     *  done, so the GUI will be updated as quickly as possible. */
+    if (thumbnail_thread_starter_id == 0)
+    {
+        thumbnail_thread_starter_id = g_idle_add_full (G_PRIORITY_LOW, thumbnail_starter_cb, NULL, NULL);
+    }
+}
+
+static gboolean
+thumbnail_wheel_tick_cb (gpointer data)
+{
+    time_t current_time = time (NULL);
+    g_autoptr (GPtrArray) due_thumbnails = g_ptr_array_new ();
+
+    /* Only the slots between the last tick and now are examined. Collect
+     *  first, as rescheduling might insert into the slots being swept. */
+    for (guint i = 0;
+         i < THUMBNAIL_WHEEL_SLOTS && thumbnail_wheel_time < current_time;
+         i++)
+    {
+        GQueue *slot;
+
+        thumbnail_wheel_time += 1;
+        slot = &thumbnail_wheel[thumbnail_wheel_time % THUMBNAIL_WHEEL_SLOTS];
+
+        while (!g_queue_is_empty (slot))
+        {
+            NautilusThumbnailInfo *info = g_queue_pop_head (slot);
+
+            g_hash_table_remove (waiting_thumbnails_hash, info->image_uri);
+            g_ptr_array_add (due_thumbnails, info);
+        }
+    }
+
+    /* After a full turn all slots have been swept anyway */
+    thumbnail_wheel_time = MAX (thumbnail_wheel_time, current_time);
+
+    for (guint i = 0; i < due_thumbnails->len; i++)
+    {
+        thumbnail_schedule (g_ptr_array_index (due_thumbnails, i));
+    }
+
+    if (g_hash_table_size (waiting_thumbnails_hash) == 0)
+    {
+        thumbnail_wheel_tick_id = 0;
+
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
 static void
 thumbnail_enqueue (NautilusThumbnailInfo     *info,
                    ThumbnailCreationCallback *cb_data)
@@ -442,10 +594,12 @@ thumbnail_enqueue (NautilusThumbnailInfo     *info,
         thumbnails_to_make = nautilus_hash_queue_new (g_str_hash, g_str_equal, NULL, NULL);
         currently_thumbnailing_hash = g_hash_table_new (g_str_hash,
                                                         g_str_equal);
+        waiting_thumbnails_hash = g_hash_table_new (g_str_hash,
+                                                    g_str_equal);
     }
 
-    /* Check if it is already in the list of thumbnails to make or
-     *  currently being made. */
+    /* Check if it is already in the list of thumbnails to make, waiting
+     *  for its cool-off period, or currently being made. */
     NautilusThumbnailInfo *existing_info = g_hash_table_lookup (currently_thumbnailing_hash, info->image_uri);
 
     if (existing_info == NULL)
@@ -453,6 +607,11 @@ thumbnail_enqueue (NautilusThumbnailInfo     *info,
         existing_info = nautilus_hash_queue_find_item (thumbnails_to_make, info->image_uri);
     }
 
+    if (existing_info == NULL)
+    {
+        existing_info = g_hash_table_lookup (waiting_thumbnails_hash, info->image_uri);
+    }
+
     if (existing_info == NULL)
     {
         /* Add the thumbnail to the list. */
@@ -460,15 +619,7 @@ thumbnail_enqueue (NautilusThumbnailInfo     *info,
                  info->image_uri);
 
         g_ptr_array_add (info->callbacks, cb_data);
-        nautilus_hash_queue_enqueue (thumbnails_to_make, info->image_uri, info);
-
-        /* If we didn't schedule the thumbnail function to start on idle, do
-         *  that now. We don't want to start it until all the other work is
-         *  done, so the GUI will be updated as quickly as possible. */
-        if (thumbnail_thread_starter_id == 0)
-        {
-            thumbnail_thread_starter_id = g_idle_add_full (G_PRIORITY_LOW, thumbnail_starter_cb, NULL, NULL);
-        }
+        thumbnail_schedule (info);
     }
     else
     {
@@ -533,7 +684,7 @@ thumbnail_finalize (NautilusThumbnailInfo *info)
     {
         info->original_file_mtime = info->updated_file_mtime;
 
-        nautilus_hash_queue_enqueue (thumbnails_to_make, info->image_uri, info);
+        thumbnail_schedule (info);
     }
 
     if (nautilus_hash_queue_is_empty (thumbnails_to_make))
@@ -588,6 +739,33 @@ thumbnail_saved_cb (GObject      *source_object,
     thumbnail_finalize (info);
 }
 
+static void
+thumbnail_save (NautilusThumbnailInfo *info,
+                GdkPixbuf             *pixbuf)
+{
+    GnomeDesktopThumbnailFactory *thumbnail_factory = get_thumbnail_factory ();
+    g_autofree gchar *mtime = g_strdup_printf ("%" G_GINT64_FORMAT,
+                                               (gint64) info->updated_file_mtime);
+
+    g_debug ("(Thumbnail Async Thread) Saving thumbnail: %s",
+             info->image_uri);
+
+    /* This is needed since the attribute is not set on the pixbuf,
+     *  only the written thumbnail file.
+     */
+    gdk_pixbuf_set_option (pixbuf, "tEXt::Thumb::MTime", mtime);
+    g_clear_object (&info->pixbuf);
+    info->pixbuf = pixbuf;
+
+    gnome_desktop_thumbnail_factory_save_thumbnail_async (thumbnail_factory,
+                                                          pixbuf,
+                                                          info->image_uri,
+                                                          info->updated_file_mtime,
+                                                          NULL,
+                                                          thumbnail_saved_cb,
+                                                          info);
+}
+
 static void
 thumbnail_generated_cb (GObject      *source_object,
                         GAsyncResult *result,
@@ -604,26 +782,7 @@ thumbnail_generated_cb (GObject      *source_object,
 
     if (pixbuf != NULL)
     {
-        g_autofree gchar *mtime = g_strdup_printf ("%" G_GINT64_FORMAT,
-                                                   (gint64) info->updated_file_mtime);
-
-        g_debug ("(Thumbnail Async Thread) Saving thumbnail: %s",
-                 info->image_uri);
-
-        /* This is needed since the attribute is not set on the pixbuf,
-         *  only the written thumbnail file.
-         */
-        gdk_pixbuf_set_option (pixbuf, "tEXt::Thumb::MTime", mtime);
-        g_clear_object (&info->pixbuf);
-        info->pixbuf = pixbuf;
-
-        gnome_desktop_thumbnail_factory_save_thumbnail_async (thumbnail_factory,
-                                                              pixbuf,
-                                                              info->image_uri,
-                                                              info->updated_file_mtime,
-                                                              NULL,
-                                                              thumbnail_saved_cb,
-                                                              info);
+        thumbnail_save (info, pixbuf);
     }
     else
     {
@@ -640,6 +799,191 @@ thumbnail_generated_cb (GObject      *source_object,
     }
 }
 
+static void
+thumbnail_generate_with_factory (NautilusThumbnailInfo *info)
+{
+    gnome_desktop_thumbnail_factory_generate_thumbnail_async (get_thumbnail_factory (),
+                                                              info->image_uri,
+                                                              info->mime_type,
+                                                              NULL,
+                                                              thumbnail_generated_cb,
+                                                              info);
+}
+
+typedef struct
+{
+    char *mime_type;
+    guint size;
+} EmbeddedPreviewRequest;
+
+static void
+embedded_preview_request_free (EmbeddedPreviewRequest *request)
+{
+    g_free (request->mime_type);
+    g_free (request);
+}
+
+static void
+embedded_preview_thread (GTask        *task,
+                         gpointer      source_object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+    GFile *file = source_object;
+    EmbeddedPreviewRequest *request = task_data;
+    GError *error = NULL;
+    int orientation = 1;
+    g_autoptr (GBytes) bytes = nautilus_embedded_preview_extract (file, request->mime_type,
+                                                                  &orientation, cancellable,
+                                                                  &error);
+
+    if (bytes == NULL)
+    {
+        g_task_return_error (task, error);
+
+        return;
+    }
+
+    guint width;
+    guint height;
+
+    if (!nautilus_embedded_preview_get_size (bytes, &width, &height))
+    {
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                                 "Unknown embedded preview size");
+
+        return;
+    }
+
+    /* A preview smaller than the thumbnail would look blurry at the zoom
+     * levels the thumbnail is meant for, so let the thumbnailers do it. This
+     * is checked before decoding, as e.g. EXIF thumbnails of JPEGs are
+     * usually only 160 pixels wide. */
+    if (MAX (width, height) < request->size)
+    {
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                 "Embedded preview is too small: %ux%u", width, height);
+
+        return;
+    }
+
+    /* Decoded in the glycin sandbox, like the thumbnailers would. */
+    g_autoptr (GlyLoader) loader = gly_loader_new_for_bytes (bytes);
+
+    gly_loader_set_accepted_memory_formats (loader,
+                                            GLY_MEMORY_SELECTION_R8G8B8 |
+                                            GLY_MEMORY_SELECTION_R8G8B8A8);
+
+    g_autoptr (GlyImage) image = gly_loader_load (loader, &error);
+
+    if (image == NULL)
+    {
+        g_task_return_error (task, error);
+
+        return;
+    }
+
+    g_autoptr (GlyFrameRequest) frame_request = gly_frame_request_new ();
+
+    gly_frame_request_set_scale (frame_request, request->size, request->size);
+
+    g_autoptr (GlyFrame) frame = gly_image_get_specific_frame (image, frame_request, &error);
+
+    if (frame == NULL)
+    {
+        g_task_return_error (task, error);
+
+        return;
+    }
+
+    gboolean has_alpha = gly_memory_format_has_alpha (gly_frame_get_memory_format (frame));
+    g_autoptr (GdkPixbuf) pixbuf = gdk_pixbuf_new_from_bytes (gly_frame_get_buf_bytes (frame),
+                                                              GDK_COLORSPACE_RGB,
+                                                              has_alpha,
+                                                              8,
+                                                              gly_frame_get_width (frame),
+                                                              gly_frame_get_height (frame),
+                                                              gly_frame_get_stride (frame));
+
+    /* EXIF previews don't carry their own orientation, it's in the main IFD */
+    if (orientation > 1)
+    {
+        g_autofree char *orientation_str = g_strdup_printf ("%d", orientation);
+
+        gdk_pixbuf_set_option (pixbuf, "orientation", orientation_str);
+    }
+
+    g_autoptr (GdkPixbuf) oriented_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+    int oriented_width = gdk_pixbuf_get_width (oriented_pixbuf);
+    int oriented_height = gdk_pixbuf_get_height (oriented_pixbuf);
+    double scale = (double) request->size / MAX (oriented_width, oriented_height);
+
+    if (scale >= 1.0)
+    {
+        g_task_return_pointer (task, g_steal_pointer (&oriented_pixbuf), g_object_unref);
+
+        return;
+    }
+
+    g_task_return_pointer (task,
+                           gdk_pixbuf_scale_simple (oriented_pixbuf,
+                                                    MAX (1, round (oriented_width * scale)),
+                                                    MAX (1, round (oriented_height * scale)),
+                                                    GDK_INTERP_BILINEAR),
+                           g_object_unref);
+}
+
+static void
+embedded_preview_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      data)
+{
+    NautilusThumbnailInfo *info = data;
+    g_autoptr (GError) error = NULL;
+    GdkPixbuf *pixbuf = g_task_propagate_pointer (G_TASK (result), &error);
+
+    if (pixbuf == NULL)
+    {
+        g_debug ("(Thumbnail Async Thread) No usable embedded preview: %s (%s)",
+                 info->image_uri, error->message);
+
+        thumbnail_generate_with_factory (info);
+
+        return;
+    }
+
+    g_debug ("(Thumbnail Async Thread) Using embedded preview: %s",
+             info->image_uri);
+
+    thumbnail_save (info, pixbuf);
+}
+
+/* Many cameras and video containers already embed a preview image. Extracting
+ * it is much cheaper than decoding the whole file, so try that first and
+ * only fall back to the external thumbnailers when there is no preview, or it
+ * is too small. */
+static void
+thumbnail_generate (NautilusThumbnailInfo *info)
+{
+    if (!nautilus_embedded_preview_is_supported (info->mime_type))
+    {
+        thumbnail_generate_with_factory (info);
+
+        return;
+    }
+
+    g_autoptr (GFile) file = g_file_new_for_uri (info->image_uri);
+    g_autoptr (GTask) task = g_task_new (file, NULL, embedded_preview_cb, info);
+    EmbeddedPreviewRequest *request = g_new0 (EmbeddedPreviewRequest, 1);
+
+    request->mime_type = g_strdup (info->mime_type);
+    request->size = nautilus_thumbnail_get_max_size ();
+
+    g_task_set_task_data (task, request, (GDestroyNotify) embedded_preview_request_free);
+    g_task_set_priority (task, G_PRIORITY_LOW);
+    g_task_run_in_thread (task, embedded_preview_thread);
+}
+
 /* This function is added as a very low priority idle function to start the
  *  async threads to create any needed thumbnails. It is added with a very
  *  low priority so that it doesn't delay showing the directory in the
@@ -648,17 +992,10 @@ thumbnail_generated_cb (GObject      *source_object,
 static gboolean
 thumbnail_starter_cb (gpointer data)
 {
-    GnomeDesktopThumbnailFactory *thumbnail_factory;
     NautilusThumbnailInfo *info = NULL;
-    guint ignored_thumbnails = 0;
-    time_t current_orig_mtime = 0;
-    time_t current_time;
-    guint backoff_time;
-    guint backoff_time_min = THUMBNAIL_CREATION_DELAY_SECS + 1;
 
     g_debug ("(Main Thread) Creating thumbnails thread");
 
-    thumbnail_factory = get_thumbnail_factory ();
     thumbnail_thread_starter_id = 0;
 
     if (G_UNLIKELY (max_threads == 0))
@@ -666,8 +1003,9 @@ thumbnail_starter_cb (gpointer data)
         max_threads = MAX_THUMBNAILING_THREADS
     }
 
-    /* We loop until the queue is empty, or we reach the thread limit. */
-    while (ignored_thumbnails < nautilus_hash_queue_get_length (thumbnails_to_make) &&
+    /* We loop until the queue is empty, or we reach the thread limit. Files
+     *  in their cool-off period are in the wheel, so everything here is due. */
+    while (!nautilus_hash_queue_is_empty (thumbnails_to_make) &&
            running_threads <= max_threads)
     {
         info = nautilus_hash_queue_peek_head (thumbnails_to_make);
@@ -682,26 +1020,6 @@ thumbnail_starter_cb (gpointer data)
             continue;
         }
 
-        current_orig_mtime = info->updated_file_mtime;
-        time (&current_time);
-
-        /* Don't try to create a thumbnail if the file was modified recently.
-         *  This prevents constant re-thumbnailing of changing files. */
-        if (current_time < current_orig_mtime + THUMBNAIL_CREATION_DELAY_SECS &&
-            current_time >= current_orig_mtime)
-        {
-            g_debug ("(Thumbnail Thread) Skipping: %s",
-                     info->image_uri);
-
-            /* Only retain the smallest backoff time */
-            backoff_time = THUMBNAIL_CREATION_DELAY_SECS - (current_time - current_orig_mtime);
-            backoff_time_min = MIN (backoff_time, backoff_time_min);
-
-            nautilus_hash_queue_enqueue (thumbnails_to_make, info->image_uri, info);
-            ignored_thumbnails += 1;
-            continue;
-        }
-
         /* Create the thumbnail. */
         g_debug ("(Thumbnail Thread) Creating thumbnail: %s",
                  info->image_uri);
@@ -709,20 +1027,7 @@ thumbnail_starter_cb (gpointer data)
         running_threads += 1;
         g_hash_table_insert (currently_thumbnailing_hash, info->image_uri, info);
 
-        gnome_desktop_thumbnail_factory_generate_thumbnail_async (thumbnail_factory,
-                                                                  info->image_uri,
-                                                                  info->mime_type,
-                                                                  NULL,
-                                                                  thumbnail_generated_cb,
-                                                                  info);
-    }
-
-    /* Reschedule thumbnailing via a change notification */
-    if (thumbnail_thread_starter_id == 0 &&
-        ignored_thumbnails > 0)
-    {
-        thumbnail_thread_starter_id = g_timeout_add_seconds (backoff_time_min,
-                                                             thumbnail_starter_cb, NULL);
+        thumbnail_generate (info);
     }
 
     return G_SOURCE_REMOVE;
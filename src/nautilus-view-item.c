@@ -16,6 +16,9 @@ struct _NautilusViewItem
     gboolean loading;
     NautilusFile *file;
     GtkWidget *item_ui;
+    /* Whether item_ui was set, even if it got destroyed since */
+    gboolean is_bound;
+    gboolean tracks_visibility;
 };
 
 G_DEFINE_FINAL_TYPE (NautilusViewItem, nautilus_view_item, G_TYPE_OBJECT)
@@ -47,6 +50,18 @@ nautilus_view_item_dispose (GObject *object)
 
     g_clear_weak_pointer (&self->item_ui);
 
+    if (self->is_bound)
+    {
+        self->is_bound = FALSE;
+        nautilus_file_set_on_screen (self->file, FALSE);
+    }
+
+    if (self->tracks_visibility)
+    {
+        self->tracks_visibility = FALSE;
+        nautilus_file_set_in_view (self->file, FALSE);
+    }
+
     G_OBJECT_CLASS (nautilus_view_item_parent_class)->dispose (object);
 }
 
@@ -263,6 +278,30 @@ nautilus_view_item_set_item_ui (NautilusViewItem *self,
     g_return_if_fail (NAUTILUS_IS_VIEW_ITEM (self));
 
     g_set_weak_pointer (&self->item_ui, item_ui);
+
+    if (self->is_bound != (item_ui != NULL))
+    {
+        self->is_bound = (item_ui != NULL);
+        nautilus_file_set_on_screen (self->file, self->is_bound);
+    }
+}
+
+/**
+ * nautilus_view_item_track_visibility:
+ *
+ * Declares that @self belongs to a view which sets its item UI while it is
+ * visible, so that its file is known to be off screen otherwise.
+ */
+void
+nautilus_view_item_track_visibility (NautilusViewItem *self)
+{
+    g_return_if_fail (NAUTILUS_IS_VIEW_ITEM (self));
+
+    if (!self->tracks_visibility)
+    {
+        self->tracks_visibility = TRUE;
+        nautilus_file_set_in_view (self->file, TRUE);
+    }
 }
 
 void
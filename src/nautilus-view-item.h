@@ -33,6 +33,7 @@ void               nautilus_view_item_set_item_ui   (NautilusViewItem *self,
                                                      GtkWidget        *item_ui);
 
 GtkWidget *        nautilus_view_item_get_item_ui   (NautilusViewItem *self);
+void               nautilus_view_item_track_visibility (NautilusViewItem *self);
 void               nautilus_view_item_file_changed  (NautilusViewItem *self);
 
 G_END_DECLS
@@ -2513,6 +2513,7 @@ create_and_bind_new_content_view (NautilusWindowSlot *self,
                                   guint               view_id)
 {
     self->content_view = nautilus_files_view_new (view_id, self);
+    nautilus_files_view_set_monitoring_suspended (self->content_view, !self->active);
 
     GtkWidget *widget = GTK_WIDGET (self->content_view);
     gtk_box_append (GTK_BOX (self->vbox), widget);
@@ -2906,6 +2907,11 @@ nautilus_window_slot_set_active (NautilusWindowSlot *self,
 
         self->active = active;
 
+        if (self->content_view != NULL)
+        {
+            nautilus_files_view_set_monitoring_suspended (self->content_view, !active);
+        }
+
         if (active)
         {
             /* sync window to new slot */
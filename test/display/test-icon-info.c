@@ -72,6 +72,86 @@ test_themed_cache (void)
     }
 }
 
+static GdkTexture *
+find_texture (GskRenderNode *node)
+{
+    switch (gsk_render_node_get_node_type (node))
+    {
+        case GSK_TEXTURE_NODE:
+        {
+            return gsk_texture_node_get_texture (node);
+        }
+
+        case GSK_CLIP_NODE:
+        {
+            return find_texture (gsk_clip_node_get_child (node));
+        }
+
+        case GSK_TRANSFORM_NODE:
+        {
+            return find_texture (gsk_transform_node_get_child (node));
+        }
+
+        case GSK_CONTAINER_NODE:
+        {
+            for (guint i = 0; i < gsk_container_node_get_n_children (node); i++)
+            {
+                GdkTexture *texture = find_texture (gsk_container_node_get_child (node, i));
+
+                if (texture != NULL)
+                {
+                    return texture;
+                }
+            }
+        }
+        break;
+
+        default:
+        {
+        }
+        break;
+    }
+
+    return NULL;
+}
+
+static GskRenderNode *
+snapshot_paintable (GdkPaintable *paintable,
+                    int           size)
+{
+    GtkSnapshot *snapshot = gtk_snapshot_new ();
+
+    gdk_paintable_snapshot (paintable, GDK_SNAPSHOT (snapshot), size, size);
+
+    return gtk_snapshot_free_to_node (snapshot);
+}
+
+static void
+test_themed_atlas (void)
+{
+    g_autoptr (GIcon) text_icon = g_themed_icon_new ("text-x-generic");
+    g_autoptr (GIcon) image_icon = g_themed_icon_new ("image-x-generic");
+    g_autoptr (GdkPaintable) text_paintable = nautilus_icon_info_lookup (text_icon, 32, 1);
+    g_autoptr (GdkPaintable) image_paintable = nautilus_icon_info_lookup (image_icon, 32, 1);
+    g_autoptr (GdkPaintable) large_paintable = nautilus_icon_info_lookup (text_icon, 64, 1);
+
+    /* Snapshot only after all lookups, as adding icons updates the texture */
+    g_autoptr (GskRenderNode) text_node = snapshot_paintable (text_paintable, 32);
+    g_autoptr (GskRenderNode) image_node = snapshot_paintable (image_paintable, 32);
+    g_autoptr (GskRenderNode) large_node = snapshot_paintable (large_paintable, 64);
+    GdkTexture *text_texture = find_texture (text_node);
+    GdkTexture *image_texture = find_texture (image_node);
+    GdkTexture *large_texture = find_texture (large_node);
+
+    g_assert_nonnull (text_texture);
+    g_assert_nonnull (image_texture);
+    g_assert_nonnull (large_texture);
+
+    /* Icons of the same size share a texture, other sizes get their own */
+    g_assert_true (text_texture == image_texture);
+    g_assert_false (text_texture == large_texture);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -80,6 +160,8 @@ main (int   argc,
 
     g_test_add_func ("/icon-info/themed/cache",
                      test_themed_cache);
+    g_test_add_func ("/icon-info/themed/atlas",
+                     test_themed_atlas);
 
     return g_test_run ();
 }
@@ -230,6 +230,45 @@ test_image_source_image_thumbnail (void)
     test_clear_tmp_dir ();
 }
 
+static void
+test_image_source_image_zoom (void)
+{
+    GtkWindow *window;
+    NautilusImage *image = build_window_with_image (&window);
+    g_autoptr (GFile) image_source = g_file_new_build_filename (test_get_tmp_dir (),
+                                                                "Image.png",
+                                                                NULL);
+    guint8 color[4] = {255, 255, 0, 0};
+    const int sizes[] =
+    {
+        NAUTILUS_GRID_ICON_SIZE_EXTRA_LARGE,
+        NAUTILUS_GRID_ICON_SIZE_MEDIUM,
+        NAUTILUS_LIST_ICON_SIZE_SMALL,
+        NAUTILUS_GRID_ICON_SIZE_LARGE,
+    };
+
+    make_image_file_full (image_source, color, 512, 256, 1);
+    nautilus_image_set_size (image, DEFAULT_SIZE);
+    nautilus_image_set_source (image, image_source);
+    ITER_CONTEXT_WHILE (nautilus_image_get_status (image) != NAUTILUS_IMAGE_STATUS_THUMBNAIL &&
+                        nautilus_image_get_status (image) != NAUTILUS_IMAGE_STATUS_FALLBACK);
+    g_assert_true (nautilus_image_get_status (image) == NAUTILUS_IMAGE_STATUS_THUMBNAIL);
+
+    /* Zooming is served from the loaded mipmaps, without reloading */
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+        nautilus_image_set_size (image, sizes[i]);
+        g_assert_true (nautilus_image_get_status (image) == NAUTILUS_IMAGE_STATUS_THUMBNAIL);
+
+        gtk_test_widget_wait_for_draw (GTK_WIDGET (image));
+        g_assert_cmpint (gtk_widget_get_width (GTK_WIDGET (image)), ==, sizes[i]);
+        g_assert_cmpint (gtk_widget_get_height (GTK_WIDGET (image)), ==, sizes[i] / 2);
+    }
+
+    gtk_window_close (window);
+    test_clear_tmp_dir ();
+}
+
 static void
 test_image_fallback (void)
 {
@@ -307,6 +346,8 @@ main (int   argc,
                      test_image_source_image_thumbnailed);
     g_test_add_func ("/image/source/image/thumbnail",
                      test_image_source_image_thumbnail);
+    g_test_add_func ("/image/source/image/zoom",
+                     test_image_source_image_zoom);
     g_test_add_func ("/image/fallback",
                      test_image_fallback);
 
@@ -0,0 +1,238 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "test-utilities.h"
+
+#include <nautilus-application.h>
+#include <nautilus-global-preferences.h>
+#include <nautilus-thumbnail-warmup.h>
+#include <nautilus-thumbnails.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+typedef struct
+{
+    gboolean done;
+    gboolean success;
+    guint n_generated;
+    GError *error;
+    /* Paths of the files reported by the progress callback */
+    GPtrArray *processed;
+} WarmupData;
+
+static void
+warmup_data_clear (WarmupData *data)
+{
+    g_clear_error (&data->error);
+    g_clear_pointer (&data->processed, g_ptr_array_unref);
+}
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (WarmupData, warmup_data_clear)
+
+static void
+warmup_progress_cb (GFile    *file,
+                    guint     n_done,
+                    guint     n_found,
+                    gpointer  user_data)
+{
+    WarmupData *data = user_data;
+
+    g_assert_cmpuint (n_done, <=, n_found);
+    g_ptr_array_add (data->processed, g_file_get_path (file));
+}
+
+static void
+warmup_done_cb (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+    WarmupData *data = user_data;
+
+    data->success = nautilus_thumbnail_warmup_finish (result, &data->n_generated, &data->error);
+    data->done = TRUE;
+}
+
+static void
+run_warmup (GFile      *root,
+            WarmupData *data)
+{
+    *data = (WarmupData)
+    {
+        .processed = g_ptr_array_new_with_free_func (g_free),
+    };
+
+    nautilus_thumbnail_warmup_async (root, NULL,
+                                     warmup_progress_cb, data,
+                                     warmup_done_cb, data);
+
+    ITER_CONTEXT_WHILE (!data->done);
+}
+
+static GFile *
+make_tree_image (const char *relative_path)
+{
+    g_autoptr (GFile) file = g_file_new_build_filename (test_get_tmp_dir (), relative_path, NULL);
+    g_autoptr (GFile) parent = g_file_get_parent (file);
+
+    g_file_make_directory_with_parents (parent, NULL, NULL);
+    make_image_file_with_mtime (file, 1);
+
+    return g_steal_pointer (&file);
+}
+
+static gboolean
+has_thumbnail (GFile *file)
+{
+    g_autofree char *uri = g_file_get_uri (file);
+    g_autofree char *thumbnail_path = nautilus_thumbnail_get_path_for_uri (uri);
+
+    return g_file_test (thumbnail_path, G_FILE_TEST_EXISTS);
+}
+
+static void
+delete_thumbnail (GFile *file)
+{
+    g_autofree char *uri = g_file_get_uri (file);
+    g_autofree char *thumbnail_path = nautilus_thumbnail_get_path_for_uri (uri);
+
+    g_unlink (thumbnail_path);
+}
+
+static void
+test_warmup_root_error (void)
+{
+    g_autoptr (GFile) root = g_file_new_build_filename (test_get_tmp_dir (), "missing", NULL);
+    g_auto (WarmupData) data = { 0 };
+
+    run_warmup (root, &data);
+
+    g_assert_false (data.success);
+    g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+    g_assert_cmpuint (data.processed->len, ==, 0);
+}
+
+static void
+test_warmup_rules (void)
+{
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autoptr (GFile) image = make_tree_image ("Image.png");
+    g_autoptr (GFile) nested_image = make_tree_image ("Folder/Nested/Image.png");
+    g_autoptr (GFile) hidden_image = make_tree_image (".Hidden.png");
+    g_autoptr (GFile) image_in_hidden = make_tree_image (".Hidden/Image.png");
+    g_auto (WarmupData) data = { 0 };
+
+    run_warmup (root, &data);
+
+    g_assert_true (data.success);
+    g_assert_no_error (data.error);
+    g_assert_cmpuint (data.n_generated, ==, 2);
+    g_assert_cmpuint (data.processed->len, ==, 2);
+    g_assert_true (g_ptr_array_find_with_equal_func (data.processed, g_file_peek_path (image),
+                                                     g_str_equal, NULL));
+    g_assert_true (g_ptr_array_find_with_equal_func (data.processed, g_file_peek_path (nested_image),
+                                                     g_str_equal, NULL));
+    g_assert_true (has_thumbnail (image));
+    g_assert_true (has_thumbnail (nested_image));
+    g_assert_false (has_thumbnail (hidden_image));
+    g_assert_false (has_thumbnail (image_in_hidden));
+
+    /* Files with a valid thumbnail are skipped */
+    warmup_data_clear (&data);
+    run_warmup (root, &data);
+
+    g_assert_true (data.success);
+    g_assert_cmpuint (data.n_generated, ==, 0);
+    g_assert_cmpuint (data.processed->len, ==, 0);
+
+    delete_thumbnail (image);
+    delete_thumbnail (nested_image);
+    test_clear_tmp_dir ();
+}
+
+static void
+test_warmup_size_limit (void)
+{
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autoptr (GFile) image = make_tree_image ("Image.png");
+    g_auto (WarmupData) data = { 0 };
+
+    g_settings_set_uint64 (nautilus_preferences, NAUTILUS_PREFERENCES_FILE_THUMBNAIL_LIMIT, 0);
+
+    run_warmup (root, &data);
+
+    g_settings_reset (nautilus_preferences, NAUTILUS_PREFERENCES_FILE_THUMBNAIL_LIMIT);
+
+    g_assert_true (data.success);
+    g_assert_cmpuint (data.n_generated, ==, 0);
+    g_assert_cmpuint (data.processed->len, ==, 0);
+    g_assert_false (has_thumbnail (image));
+
+    test_clear_tmp_dir ();
+}
+
+static void
+test_warmup_thumbnails_disabled (void)
+{
+    g_autoptr (GFile) root = g_file_new_for_path (test_get_tmp_dir ());
+    g_autoptr (GFile) image = make_tree_image ("Image.png");
+    g_auto (WarmupData) data = { 0 };
+
+    g_settings_set_enum (nautilus_preferences, NAUTILUS_PREFERENCES_SHOW_FILE_THUMBNAILS,
+                         NAUTILUS_SPEED_TRADEOFF_NEVER);
+
+    run_warmup (root, &data);
+
+    g_settings_reset (nautilus_preferences, NAUTILUS_PREFERENCES_SHOW_FILE_THUMBNAILS);
+
+    g_assert_true (data.success);
+    g_assert_cmpuint (data.n_generated, ==, 0);
+    g_assert_cmpuint (data.processed->len, ==, 0);
+    g_assert_false (has_thumbnail (image));
+
+    test_clear_tmp_dir ();
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    nautilus_ensure_extension_points ();
+
+    gtk_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+    g_test_set_nonfatal_assertions ();
+    nautilus_global_preferences_init ();
+
+    if (nautilus_application_is_sandboxed ())
+    {
+        g_message ("Cannot run thumbnails tests inside a sandbox.");
+
+        return 77;
+    }
+
+    /* HACK: Pretend to be a snap to disable sandboxing in libgnome-desktop */
+    g_setenv ("SNAP_NAME", "1", TRUE);
+
+    g_test_add_func ("/thumbnail-warmup/root-error",
+                     test_warmup_root_error);
+    g_test_add_func ("/thumbnail-warmup/thumbnails-disabled",
+                     test_warmup_thumbnails_disabled);
+
+    if (nautilus_can_thumbnail ("file:///tmp/nautilus_tests/image.png", "image/png", 1))
+    {
+        g_test_add_func ("/thumbnail-warmup/rules",
+                         test_warmup_rules);
+        g_test_add_func ("/thumbnail-warmup/size-limit",
+                         test_warmup_size_limit);
+    }
+    else
+    {
+        g_message ("System has no thumbnailer for PNGs, skipping the tests generating thumbnails.");
+    }
+
+    return g_test_run ();
+}
@@ -0,0 +1,597 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Replays a trace of file monitor events as real file system operations in
+ * a monitored directory, and measures how long each one takes to reach a
+ * headless NautilusViewModel. This covers the GFileMonitor callback, the
+ * file changes queue, the NautilusDirectory notify paths and the model.
+ *
+ * Each trace line is "<event> <name> [<new name>]", where the event is one
+ * of "created", "changed", "deleted" or "moved". Without --trace, a
+ * synthetic trace is generated from a fixed seed.
+ *
+ * Files which keep changing are throttled by NautilusDirectory, so their
+ * latencies are reported apart from the others. The items of the model are
+ * never bound, so they only count as off screen, and wait the longest, when
+ * --off-screen is given.
+ */
+
+#include "test-utilities.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <nautilus-directory.h>
+#include <nautilus-directory-notify.h>
+#include <nautilus-file.h>
+#include <nautilus-file-private.h>
+#include <nautilus-file-utilities.h>
+#include <nautilus-view-item.h>
+#include <nautilus-view-model.h>
+
+#define DEFAULT_N_EVENTS 2000
+/* Events performed per main loop iteration, to replay bursts. */
+#define REPLAY_BURST_SIZE 20
+/* Well above the longest deferral of changes, for off-screen files */
+#define SETTLE_TIMEOUT_SECONDS 120
+
+typedef struct
+{
+    GFileMonitorEvent event;
+    char *name;
+    char *other_name;
+} TraceEvent;
+
+typedef struct
+{
+    NautilusDirectory *directory;
+    NautilusViewModel *model;
+    GFile *location;
+
+    GPtrArray *trace;
+    guint next_event;
+    guint n_skipped;
+
+    /* Name → monotonic time of the oldest event not yet seen by the model */
+    GHashTable *pending;
+    /* Of model updates for files refreshed while still changing, and others */
+    GArray *throttled_latencies;
+    GArray *latencies;
+    gboolean off_screen;
+
+    gint64 start_time;
+    gint64 end_time;
+    GMainLoop *loop;
+} Benchmark;
+
+static void
+trace_event_free (TraceEvent *trace_event)
+{
+    g_free (trace_event->name);
+    g_free (trace_event->other_name);
+    g_free (trace_event);
+}
+
+static void
+trace_add (GPtrArray         *trace,
+           GFileMonitorEvent  event,
+           const char        *name,
+           const char        *other_name)
+{
+    TraceEvent *trace_event = g_new0 (TraceEvent, 1);
+
+    trace_event->event = event;
+    trace_event->name = g_strdup (name);
+    trace_event->other_name = g_strdup (other_name);
+    g_ptr_array_add (trace, trace_event);
+}
+
+static GPtrArray *
+trace_load (const char  *path,
+            GError     **error)
+{
+    g_autoptr (GPtrArray) trace = g_ptr_array_new_with_free_func ((GDestroyNotify) trace_event_free);
+    g_autofree char *contents = NULL;
+    g_auto (GStrv) lines = NULL;
+
+    if (!g_file_get_contents (path, &contents, NULL, error))
+    {
+        return NULL;
+    }
+
+    lines = g_strsplit (contents, "\n", -1);
+    for (guint i = 0; lines[i] != NULL; i++)
+    {
+        g_auto (GStrv) fields = g_strsplit (g_strstrip (lines[i]), " ", 3);
+        guint n_fields = g_strv_length (fields);
+
+        if (n_fields < 2 || fields[0][0] == '#')
+        {
+            continue;
+        }
+
+        if (g_str_equal (fields[0], "created"))
+        {
+            trace_add (trace, G_FILE_MONITOR_EVENT_CREATED, fields[1], NULL);
+        }
+        else if (g_str_equal (fields[0], "changed"))
+        {
+            trace_add (trace, G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT, fields[1], NULL);
+        }
+        else if (g_str_equal (fields[0], "deleted"))
+        {
+            trace_add (trace, G_FILE_MONITOR_EVENT_DELETED, fields[1], NULL);
+        }
+        else if (g_str_equal (fields[0], "moved") && n_fields == 3)
+        {
+            trace_add (trace, G_FILE_MONITOR_EVENT_RENAMED, fields[1], fields[2]);
+        }
+        else
+        {
+            g_printerr ("Ignoring trace line %u: %s\n", i + 1, lines[i]);
+        }
+    }
+
+    return g_steal_pointer (&trace);
+}
+
+/* Roughly what a build or a VCS checkout does: mostly creations and
+ * modifications, with some renames and deletions.
+ */
+static GPtrArray *
+trace_generate (guint n_events)
+{
+    GPtrArray *trace = g_ptr_array_new_with_free_func ((GDestroyNotify) trace_event_free);
+    g_autoptr (GPtrArray) names = g_ptr_array_new_with_free_func (g_free);
+    g_autoptr (GRand) rand = g_rand_new_with_seed (0);
+    guint counter = 0;
+
+    while (trace->len < n_events)
+    {
+        gint32 roll = g_rand_int_range (rand, 0, 100);
+        g_autofree char *name = NULL;
+        guint index;
+
+        if (names->len == 0 || roll < 40)
+        {
+            name = g_strdup_printf ("file-%u.txt", counter++);
+            trace_add (trace, G_FILE_MONITOR_EVENT_CREATED, name, NULL);
+            g_ptr_array_add (names, g_steal_pointer (&name));
+            continue;
+        }
+
+        index = g_rand_int_range (rand, 0, names->len);
+        if (roll < 75)
+        {
+            trace_add (trace, G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT,
+                       g_ptr_array_index (names, index), NULL);
+        }
+        else if (roll < 90)
+        {
+            name = g_strdup_printf ("file-%u.txt", counter++);
+            trace_add (trace, G_FILE_MONITOR_EVENT_RENAMED,
+                       g_ptr_array_index (names, index), name);
+            g_free (g_ptr_array_index (names, index));
+            g_ptr_array_index (names, index) = g_steal_pointer (&name);
+        }
+        else
+        {
+            trace_add (trace, G_FILE_MONITOR_EVENT_DELETED,
+                       g_ptr_array_index (names, index), NULL);
+            g_ptr_array_remove_index_fast (names, index);
+        }
+    }
+
+    return trace;
+}
+
+static gboolean
+perform_event (Benchmark  *benchmark,
+               TraceEvent *trace_event)
+{
+    g_autoptr (GFile) file = g_file_get_child (benchmark->location, trace_event->name);
+    g_autofree char *path = g_file_get_path (file);
+
+    switch (trace_event->event)
+    {
+        case G_FILE_MONITOR_EVENT_CREATED:
+        {
+            return g_file_set_contents (path, "", 0, NULL);
+        }
+
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        {
+            FILE *stream = g_fopen (path, "a");
+
+            if (stream == NULL)
+            {
+                return FALSE;
+            }
+            fputs ("changed\n", stream);
+            return fclose (stream) == 0;
+        }
+
+        case G_FILE_MONITOR_EVENT_DELETED:
+        {
+            return g_unlink (path) == 0;
+        }
+
+        case G_FILE_MONITOR_EVENT_RENAMED:
+        {
+            g_autoptr (GFile) other_file = g_file_get_child (benchmark->location,
+                                                             trace_event->other_name);
+            g_autofree char *other_path = g_file_get_path (other_file);
+
+            return g_rename (path, other_path) == 0;
+        }
+
+        default:
+        {
+            g_assert_not_reached ();
+        }
+    }
+}
+
+static void
+benchmark_check_done (Benchmark *benchmark)
+{
+    if (benchmark->next_event == benchmark->trace->len &&
+        g_hash_table_size (benchmark->pending) == 0)
+    {
+        benchmark->end_time = g_get_monotonic_time ();
+        g_main_loop_quit (benchmark->loop);
+    }
+}
+
+static void
+record_seen (Benchmark    *benchmark,
+             NautilusFile *file)
+{
+    gint64 *start_time;
+    gint64 latency;
+
+    start_time = g_hash_table_lookup (benchmark->pending, nautilus_file_get_name (file));
+    if (start_time == NULL)
+    {
+        return;
+    }
+
+    latency = g_get_monotonic_time () - *start_time;
+    if (file->details->change_refresh_interval > 0)
+    {
+        g_array_append_val (benchmark->throttled_latencies, latency);
+    }
+    else
+    {
+        g_array_append_val (benchmark->latencies, latency);
+    }
+    g_hash_table_remove (benchmark->pending, nautilus_file_get_name (file));
+}
+
+static gboolean
+model_has_name (Benchmark  *benchmark,
+                const char *name)
+{
+    g_autoptr (GFile) location = g_file_get_child (benchmark->location, name);
+    g_autoptr (NautilusFile) file = nautilus_file_get_existing (location);
+
+    return file != NULL && nautilus_view_model_get_item_for_file (benchmark->model, file) != NULL;
+}
+
+static gboolean
+replay_burst (gpointer user_data)
+{
+    Benchmark *benchmark = user_data;
+
+    for (guint i = 0; i < REPLAY_BURST_SIZE && benchmark->next_event < benchmark->trace->len; i++)
+    {
+        TraceEvent *trace_event = g_ptr_array_index (benchmark->trace, benchmark->next_event++);
+        const char *seen_name = trace_event->other_name != NULL ? trace_event->other_name
+                                                                : trace_event->name;
+        gint64 *start_time = g_new (gint64, 1);
+
+        *start_time = g_get_monotonic_time ();
+        if (!perform_event (benchmark, trace_event))
+        {
+            benchmark->n_skipped++;
+            g_free (start_time);
+            continue;
+        }
+
+        if (trace_event->event == G_FILE_MONITOR_EVENT_DELETED &&
+            g_hash_table_contains (benchmark->pending, seen_name) &&
+            !model_has_name (benchmark, seen_name))
+        {
+            /* Created and deleted before the model saw it, which coalesces
+             * to nothing reaching the model. */
+            g_hash_table_remove (benchmark->pending, seen_name);
+            g_free (start_time);
+            continue;
+        }
+        else if (trace_event->event == G_FILE_MONITOR_EVENT_RENAMED)
+        {
+            g_autofree char *name = NULL;
+            g_autofree gint64 *name_start_time = NULL;
+
+            /* Whatever is pending for the old name reaches the model under
+             * the new one. */
+            if (g_hash_table_steal_extended (benchmark->pending, trace_event->name,
+                                             (gpointer *) &name, (gpointer *) &name_start_time))
+            {
+                *start_time = MIN (*start_time, *name_start_time);
+            }
+        }
+
+        /* Keep the oldest start time when events for a name coalesce. */
+        if (g_hash_table_contains (benchmark->pending, seen_name))
+        {
+            g_free (start_time);
+        }
+        else
+        {
+            g_hash_table_insert (benchmark->pending, g_strdup (seen_name), start_time);
+        }
+    }
+
+    if (benchmark->next_event < benchmark->trace->len)
+    {
+        return G_SOURCE_CONTINUE;
+    }
+
+    benchmark_check_done (benchmark);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+add_files_to_model (Benchmark *benchmark,
+                    GList     *files)
+{
+    g_autolist (NautilusViewItem) items = NULL;
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        if (nautilus_view_model_get_item_for_file (benchmark->model, l->data) == NULL)
+        {
+            NautilusViewItem *item = nautilus_view_item_new (l->data);
+
+            if (benchmark->off_screen)
+            {
+                nautilus_view_item_track_visibility (item);
+            }
+            items = g_list_prepend (items, item);
+        }
+    }
+
+    if (items != NULL)
+    {
+        nautilus_view_model_add_items (benchmark->model, items);
+    }
+}
+
+static void
+on_files_added (NautilusDirectory *directory,
+                GList             *files,
+                gpointer           user_data)
+{
+    Benchmark *benchmark = user_data;
+
+    add_files_to_model (benchmark, files);
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        record_seen (benchmark, l->data);
+    }
+
+    benchmark_check_done (benchmark);
+}
+
+static void
+on_files_changed (NautilusDirectory *directory,
+                  GList             *files,
+                  gpointer           user_data)
+{
+    Benchmark *benchmark = user_data;
+    g_autoptr (GHashTable) removed_items = g_hash_table_new (NULL, NULL);
+    g_autoptr (GList) added_files = NULL;
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        NautilusFile *file = l->data;
+        NautilusViewItem *item = nautilus_view_model_get_item_for_file (benchmark->model, file);
+
+        if (nautilus_file_is_gone (file))
+        {
+            if (item != NULL)
+            {
+                g_hash_table_insert (removed_items, item, file);
+            }
+        }
+        else if (item != NULL)
+        {
+            nautilus_view_item_file_changed (item);
+        }
+        else
+        {
+            added_files = g_list_prepend (added_files, file);
+        }
+    }
+
+    if (g_hash_table_size (removed_items) > 0)
+    {
+        nautilus_view_model_remove_items (benchmark->model, removed_items, directory);
+    }
+    add_files_to_model (benchmark, added_files);
+
+    for (GList *l = files; l != NULL; l = l->next)
+    {
+        record_seen (benchmark, l->data);
+    }
+
+    benchmark_check_done (benchmark);
+}
+
+static void
+on_initial_files_ready (NautilusDirectory *directory,
+                        GList             *files,
+                        gpointer           user_data)
+{
+    Benchmark *benchmark = user_data;
+
+    add_files_to_model (benchmark, files);
+
+    benchmark->start_time = g_get_monotonic_time ();
+    g_idle_add (replay_burst, benchmark);
+}
+
+static gboolean
+on_settle_timeout (gpointer user_data)
+{
+    Benchmark *benchmark = user_data;
+
+    g_printerr ("Timed out after %d seconds waiting for the model to settle\n",
+                SETTLE_TIMEOUT_SECONDS);
+    benchmark->end_time = g_get_monotonic_time ();
+    g_main_loop_quit (benchmark->loop);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gint
+compare_latencies (gconstpointer a,
+                   gconstpointer b)
+{
+    gint64 latency_a = *(const gint64 *) a;
+    gint64 latency_b = *(const gint64 *) b;
+
+    return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+static double
+get_percentile_ms (GArray *latencies,
+                   guint   percentile)
+{
+    if (latencies->len == 0)
+    {
+        return 0;
+    }
+
+    return g_array_index (latencies, gint64, (latencies->len - 1) * percentile / 100) / 1000.0;
+}
+
+static void
+report_latencies (const char *label,
+                  GArray     *latencies)
+{
+    g_array_sort (latencies, compare_latencies);
+
+    g_print ("%s latency p50 %.1f ms, p99 %.1f ms, max %.1f ms over %u model updates\n",
+             label,
+             get_percentile_ms (latencies, 50),
+             get_percentile_ms (latencies, 99),
+             get_percentile_ms (latencies, 100),
+             latencies->len);
+}
+
+static void
+benchmark_report (Benchmark *benchmark)
+{
+    double seconds = (benchmark->end_time - benchmark->start_time) / (double) G_USEC_PER_SEC;
+    guint n_replayed = benchmark->next_event - benchmark->n_skipped;
+    NautilusChangeThrottleStats stats;
+
+    g_print ("Replayed %u events (%u skipped) in %.2f s, %.0f events/s\n",
+             n_replayed, benchmark->n_skipped, seconds, n_replayed / MAX (seconds, 0.001));
+    report_latencies ("Unthrottled", benchmark->latencies);
+    report_latencies (benchmark->off_screen ? "Throttled off-screen" : "Throttled",
+                      benchmark->throttled_latencies);
+
+    nautilus_directory_get_change_throttle_stats (&stats);
+    g_print ("Change refreshes: %u, of which %u throttled, %u changes suppressed\n",
+             stats.n_refreshed, stats.n_throttled, stats.n_suppressed);
+    if (g_hash_table_size (benchmark->pending) > 0)
+    {
+        g_print ("%u events never reached the model\n",
+                 g_hash_table_size (benchmark->pending));
+    }
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autofree char *trace_path = NULL;
+    int n_events = DEFAULT_N_EVENTS;
+    Benchmark benchmark = { 0 };
+    GOptionEntry entries[] =
+    {
+        { "trace", 't', 0, G_OPTION_ARG_FILENAME, &trace_path, "Trace to replay", "FILE" },
+        { "events", 'n', 0, G_OPTION_ARG_INT, &n_events, "Number of events to generate without a trace", "N" },
+        { "off-screen", 0, 0, G_OPTION_ARG_NONE, &benchmark.off_screen, "Replay into a view with all files scrolled out of sight", NULL },
+        { NULL }
+    };
+    g_autoptr (GOptionContext) context = g_option_context_new ("- replay file change traces into a monitored directory");
+    g_autoptr (GError) error = NULL;
+    gint client;
+    guint timeout_id;
+
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        return 1;
+    }
+
+    nautilus_ensure_extension_points ();
+
+    benchmark.trace = (trace_path != NULL) ? trace_load (trace_path, &error)
+                                           : trace_generate (MAX (n_events, 1));
+    if (benchmark.trace == NULL)
+    {
+        g_printerr ("Failed to load trace: %s\n", error->message);
+        return 1;
+    }
+
+    benchmark.location = g_file_new_for_path (test_get_tmp_dir ());
+    benchmark.directory = nautilus_directory_get (benchmark.location);
+    benchmark.model = nautilus_view_model_new (FALSE);
+    benchmark.pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    benchmark.throttled_latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+    benchmark.latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+    benchmark.loop = g_main_loop_new (NULL, FALSE);
+
+    g_signal_connect (benchmark.directory, "files-added",
+                      G_CALLBACK (on_files_added), &benchmark);
+    g_signal_connect (benchmark.directory, "files-changed",
+                      G_CALLBACK (on_files_changed), &benchmark);
+    nautilus_directory_file_monitor_add (benchmark.directory, &client, TRUE,
+                                         NAUTILUS_ATTRIBUTE_INFO,
+                                         on_initial_files_ready, &benchmark);
+
+    timeout_id = g_timeout_add_seconds (SETTLE_TIMEOUT_SECONDS, on_settle_timeout, &benchmark);
+    g_main_loop_run (benchmark.loop);
+    g_clear_handle_id (&timeout_id, g_source_remove);
+
+    benchmark_report (&benchmark);
+
+    nautilus_directory_file_monitor_remove (benchmark.directory, &client);
+    g_signal_handlers_disconnect_by_data (benchmark.directory, &benchmark);
+    nautilus_view_model_remove_all_items (benchmark.model);
+
+    g_main_loop_unref (benchmark.loop);
+    g_array_unref (benchmark.throttled_latencies);
+    g_array_unref (benchmark.latencies);
+    g_hash_table_unref (benchmark.pending);
+    g_object_unref (benchmark.model);
+    nautilus_directory_unref (benchmark.directory);
+    g_object_unref (benchmark.location);
+    g_ptr_array_unref (benchmark.trace);
+
+    test_clear_tmp_dir ();
+
+    return 0;
+}
@@ -126,7 +126,7 @@ test_directory_call_when_ready (void)
 
     /* Every NautilusFile created by call_when_ready must have been
      * unref'd and destroyed after the NautilusDirectoryCallback returns */
-    g_assert_null (directory->details->file_list);
+    g_assert_cmpuint (directory->details->files->len, ==, 0);
 }
 
 int
@@ -0,0 +1,294 @@
+/*
+ * Copyright © 2026 The Files contributors
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "test-utilities.h"
+
+#include <nautilus-embedded-preview.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+/* Not decodable, but enough to pass the signature check */
+static const guchar fake_jpeg[] = { 0xff, 0xd8, 'p', 'r', 'e', 'v', 'i', 'e', 'w', 0xff, 0xd9 };
+static const guchar fake_png[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 'c', 'o', 'v', 'e', 'r' };
+
+static void
+append_u16_be (GByteArray *array,
+               guint16     value)
+{
+    guchar data[2] = { value >> 8, value & 0xff };
+
+    g_byte_array_append (array, data, sizeof (data));
+}
+
+static void
+append_u16_le (GByteArray *array,
+               guint16     value)
+{
+    guchar data[2] = { value & 0xff, value >> 8 };
+
+    g_byte_array_append (array, data, sizeof (data));
+}
+
+static void
+append_u32_be (GByteArray *array,
+               guint32     value)
+{
+    guchar data[4] = { value >> 24, (value >> 16) & 0xff, (value >> 8) & 0xff, value & 0xff };
+
+    g_byte_array_append (array, data, sizeof (data));
+}
+
+static void
+append_u32_le (GByteArray *array,
+               guint32     value)
+{
+    guchar data[4] = { value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, value >> 24 };
+
+    g_byte_array_append (array, data, sizeof (data));
+}
+
+static void
+append_ifd_entry (GByteArray *array,
+                  guint16     tag,
+                  guint16     type,
+                  guint32     value)
+{
+    append_u16_le (array, tag);
+    append_u16_le (array, type);
+    append_u32_le (array, 1);
+
+    if (type == 3)
+    {
+        append_u16_le (array, value);
+        append_u16_le (array, 0);
+    }
+    else
+    {
+        append_u32_le (array, value);
+    }
+}
+
+static GFile *
+write_test_file (const char *name,
+                 GByteArray *contents)
+{
+    g_autofree gchar *path = g_build_filename (test_get_tmp_dir (), name, NULL);
+    g_autoptr (GError) error = NULL;
+
+    g_file_set_contents (path, (const gchar *) contents->data, contents->len, &error);
+    g_assert_no_error (error);
+
+    return g_file_new_for_path (path);
+}
+
+/* A JPEG with an EXIF segment: IFD0 carries the orientation, IFD1 the
+ * location of the thumbnail, which follows right after the IFDs. */
+static GFile *
+create_jpeg_with_exif (void)
+{
+    g_autoptr (GByteArray) tiff = g_byte_array_new ();
+    const guint32 ifd0_offset = 8;
+    const guint32 ifd1_offset = ifd0_offset + 2 + 12 + 4;
+    const guint32 thumbnail_offset = ifd1_offset + 2 + 2 * 12 + 4;
+
+    g_byte_array_append (tiff, (const guint8 *) "II", 2);
+    append_u16_le (tiff, 42);
+    append_u32_le (tiff, ifd0_offset);
+
+    append_u16_le (tiff, 1);
+    append_ifd_entry (tiff, 0x0112, 3, 6);
+    append_u32_le (tiff, ifd1_offset);
+
+    append_u16_le (tiff, 2);
+    append_ifd_entry (tiff, 0x0201, 4, thumbnail_offset);
+    append_ifd_entry (tiff, 0x0202, 4, sizeof (fake_jpeg));
+    append_u32_le (tiff, 0);
+
+    g_assert_cmpuint (tiff->len, ==, thumbnail_offset);
+    g_byte_array_append (tiff, fake_jpeg, sizeof (fake_jpeg));
+
+    g_autoptr (GByteArray) jpeg = g_byte_array_new ();
+    const guchar start_of_image[] = { 0xff, 0xd8 };
+    const guchar app1[] = { 0xff, 0xe1 };
+    const guchar start_of_scan[] = { 0xff, 0xda, 0x00, 0x02 };
+
+    g_byte_array_append (jpeg, start_of_image, sizeof (start_of_image));
+    g_byte_array_append (jpeg, app1, sizeof (app1));
+    append_u16_be (jpeg, 2 + 6 + tiff->len);
+    g_byte_array_append (jpeg, (const guint8 *) "Exif\0\0", 6);
+    g_byte_array_append (jpeg, tiff->data, tiff->len);
+    g_byte_array_append (jpeg, start_of_scan, sizeof (start_of_scan));
+
+    return write_test_file ("exif.jpg", jpeg);
+}
+
+static void
+append_atom (GByteArray *array,
+             const char *type,
+             GByteArray *content)
+{
+    append_u32_be (array, 8 + content->len);
+    g_byte_array_append (array, (const guint8 *) type, 4);
+    g_byte_array_append (array, content->data, content->len);
+}
+
+/* An MP4 with cover art, with the media data before the movie header. */
+static GFile *
+create_mp4_with_cover (void)
+{
+    g_autoptr (GByteArray) data = g_byte_array_new ();
+    g_autoptr (GByteArray) covr = g_byte_array_new ();
+    g_autoptr (GByteArray) ilst = g_byte_array_new ();
+    g_autoptr (GByteArray) meta = g_byte_array_new ();
+    g_autoptr (GByteArray) udta = g_byte_array_new ();
+    g_autoptr (GByteArray) moov = g_byte_array_new ();
+    g_autoptr (GByteArray) mdat = g_byte_array_new ();
+    g_autoptr (GByteArray) mp4 = g_byte_array_new ();
+
+    append_u32_be (data, 14);
+    append_u32_be (data, 0);
+    g_byte_array_append (data, fake_png, sizeof (fake_png));
+    append_atom (covr, "data", data);
+    append_atom (ilst, "covr", covr);
+    append_u32_be (meta, 0);
+    append_atom (meta, "ilst", ilst);
+    append_atom (udta, "meta", meta);
+    append_atom (moov, "udta", udta);
+
+    g_byte_array_set_size (mdat, 4096);
+    memset (mdat->data, 0xff, mdat->len);
+
+    append_u32_be (mp4, 16);
+    g_byte_array_append (mp4, (const guint8 *) "ftypisom", 8);
+    append_u32_be (mp4, 0x200);
+    append_atom (mp4, "mdat", mdat);
+    append_atom (mp4, "moov", moov);
+
+    return write_test_file ("cover.mp4", mp4);
+}
+
+static void
+test_embedded_preview_jpeg_exif (void)
+{
+    g_autoptr (GFile) file = create_jpeg_with_exif ();
+    g_autoptr (GError) error = NULL;
+    int orientation = 0;
+    g_autoptr (GBytes) bytes = nautilus_embedded_preview_extract (file, "image/jpeg", &orientation,
+                                                                  NULL, &error);
+    g_autoptr (GBytes) expected = g_bytes_new_static (fake_jpeg, sizeof (fake_jpeg));
+
+    g_assert_no_error (error);
+    g_assert_nonnull (bytes);
+    g_assert_true (g_bytes_equal (bytes, expected));
+    g_assert_cmpint (orientation, ==, 6);
+}
+
+static void
+test_embedded_preview_mp4_cover (void)
+{
+    g_autoptr (GFile) file = create_mp4_with_cover ();
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GBytes) bytes = nautilus_embedded_preview_extract (file, "video/mp4", NULL,
+                                                                  NULL, &error);
+    g_autoptr (GBytes) expected = g_bytes_new_static (fake_png, sizeof (fake_png));
+
+    g_assert_no_error (error);
+    g_assert_nonnull (bytes);
+    g_assert_true (g_bytes_equal (bytes, expected));
+}
+
+static void
+test_embedded_preview_missing (void)
+{
+    g_autoptr (GByteArray) contents = g_byte_array_new ();
+    const guchar jpeg_without_exif[] = { 0xff, 0xd8, 0xff, 0xda, 0x00, 0x02, 0xff, 0xd9 };
+    g_autoptr (GError) error = NULL;
+
+    g_byte_array_append (contents, jpeg_without_exif, sizeof (jpeg_without_exif));
+
+    g_autoptr (GFile) file = write_test_file ("plain.jpg", contents);
+    g_autoptr (GBytes) bytes = nautilus_embedded_preview_extract (file, "image/jpeg", NULL,
+                                                                  NULL, &error);
+
+    g_assert_null (bytes);
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+}
+
+static void
+test_embedded_preview_unsupported (void)
+{
+    g_autoptr (GFile) file = create_jpeg_with_exif ();
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GBytes) bytes = nautilus_embedded_preview_extract (file, "image/png", NULL,
+                                                                  NULL, &error);
+
+    g_assert_false (nautilus_embedded_preview_is_supported ("image/png"));
+    g_assert_true (nautilus_embedded_preview_is_supported ("image/x-canon-cr2"));
+    g_assert_null (bytes);
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+}
+
+static void
+test_embedded_preview_get_size (void)
+{
+    /* Start of image, an APP0 segment, then a baseline frame header */
+    const guchar jpeg[] =
+    {
+        0xff, 0xd8,
+        0xff, 0xe0, 0x00, 0x04, 0x00, 0x00,
+        0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x78, 0x00, 0xa0,
+    };
+    const guchar png[] =
+    {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n',
+        0x00, 0x00, 0x00, 0x0d, 'I', 'H', 'D', 'R',
+        0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0xc0,
+    };
+    g_autoptr (GBytes) jpeg_bytes = g_bytes_new_static (jpeg, sizeof (jpeg));
+    g_autoptr (GBytes) png_bytes = g_bytes_new_static (png, sizeof (png));
+    g_autoptr (GBytes) fake_bytes = g_bytes_new_static (fake_jpeg, sizeof (fake_jpeg));
+    guint width = 0;
+    guint height = 0;
+
+    g_assert_true (nautilus_embedded_preview_get_size (jpeg_bytes, &width, &height));
+    g_assert_cmpuint (width, ==, 160);
+    g_assert_cmpuint (height, ==, 120);
+
+    g_assert_true (nautilus_embedded_preview_get_size (png_bytes, &width, &height));
+    g_assert_cmpuint (width, ==, 256);
+    g_assert_cmpuint (height, ==, 192);
+
+    g_assert_false (nautilus_embedded_preview_get_size (fake_bytes, &width, &height));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    int ret;
+
+    g_test_init (&argc, &argv, NULL);
+    g_test_set_nonfatal_assertions ();
+
+    g_test_add_func ("/embedded-preview/jpeg-exif",
+                     test_embedded_preview_jpeg_exif);
+    g_test_add_func ("/embedded-preview/mp4-cover",
+                     test_embedded_preview_mp4_cover);
+    g_test_add_func ("/embedded-preview/missing",
+                     test_embedded_preview_missing);
+    g_test_add_func ("/embedded-preview/unsupported",
+                     test_embedded_preview_unsupported);
+    g_test_add_func ("/embedded-preview/get-size",
+                     test_embedded_preview_get_size);
+
+    ret = g_test_run ();
+
+    test_clear_tmp_dir ();
+
+    return ret;
+}
@@ -0,0 +1,83 @@
+#include "test-utilities.h"
+
+#include <src/nautilus-global-preferences.h>
+#include <src/nautilus-query.h>
+
+static void
+test_query_exact (void)
+{
+    g_autoptr (NautilusQuery) query = nautilus_query_new ();
+
+    nautilus_query_set_fuzzy (query, FALSE);
+    nautilus_query_set_text (query, "report");
+
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "Report.odt"), >, 0);
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "raport.odt"), ==, -1);
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "rprt.odt"), ==, -1);
+}
+
+static void
+test_query_fuzzy (void)
+{
+    g_autoptr (NautilusQuery) query = nautilus_query_new ();
+    gdouble exact, typo, abbreviation;
+
+    nautilus_query_set_fuzzy (query, TRUE);
+    nautilus_query_set_text (query, "report");
+
+    exact = nautilus_query_matches_string (query, "report.odt");
+    typo = nautilus_query_matches_string (query, "raport.odt");
+    abbreviation = nautilus_query_matches_string (query, "r-e-p-o-r-t.odt");
+
+    g_assert_cmpfloat (typo, >, 0);
+    g_assert_cmpfloat (abbreviation, >, 0);
+    g_assert_cmpfloat (exact, >, typo);
+    g_assert_cmpfloat (typo, >, abbreviation);
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "holidays.png"), ==, -1);
+
+    /* Short words must not match with typos or gaps. */
+    nautilus_query_set_text (query, "cat");
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "car.png"), ==, -1);
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "cabinet.png"), ==, -1);
+    nautilus_query_set_text (query, "doc");
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "download_cache"), ==, -1);
+
+    /* Letters spread over a long name are no abbreviation. */
+    nautilus_query_set_text (query, "rprt");
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "report.odt"), >, 0);
+    g_assert_cmpfloat (nautilus_query_matches_string (query, "r_backup_of_party.txt"), ==, -1);
+}
+
+static void
+test_query_fuzzy_not_refinement (void)
+{
+    g_autoptr (NautilusQuery) previous = nautilus_query_new ();
+    g_autoptr (NautilusQuery) query = NULL;
+
+    nautilus_query_set_fuzzy (previous, TRUE);
+    nautilus_query_set_text (previous, "report");
+    query = nautilus_query_copy (previous);
+    nautilus_query_set_text (query, "reports");
+
+    g_assert_true (nautilus_query_get_fuzzy (query));
+    g_assert_false (nautilus_query_is_refinement_of (query, previous));
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+    nautilus_ensure_extension_points ();
+    /* Needed for nautilus-query.c. */
+    nautilus_global_preferences_init ();
+
+    g_test_add_func ("/query/exact",
+                     test_query_exact);
+    g_test_add_func ("/query/fuzzy",
+                     test_query_fuzzy);
+    g_test_add_func ("/query/fuzzy-not-refinement",
+                     test_query_fuzzy_not_refinement);
+
+    return g_test_run ();
+}
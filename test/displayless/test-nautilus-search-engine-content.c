@@ -0,0 +1,122 @@
+#include "test-utilities.h"
+
+#include <src/nautilus-file-utilities.h>
+#include <src/nautilus-global-preferences.h>
+#include <src/nautilus-query.h>
+#include <src/nautilus-search-engine.h>
+#include <src/nautilus-search-hit.h>
+#include <src/nautilus-search-provider.h>
+
+#include <string.h>
+
+static guint total_hits = 0;
+static gchar *snippet = NULL;
+
+static void
+hits_added_cb (NautilusSearchEngine *engine,
+               GPtrArray            *hits)
+{
+    g_print ("Hits added for search engine content!\n");
+    for (guint i = 0; i < hits->len; i++)
+    {
+        NautilusSearchHit *hit = hits->pdata[i];
+
+        g_print ("Hit %i: %s\n", i, nautilus_search_hit_get_uri (hit));
+        total_hits += 1;
+        g_set_str (&snippet, nautilus_search_hit_get_fts_snippet (hit));
+    }
+}
+
+static void
+finished_cb (NautilusSearchEngine *engine,
+             GMainLoop            *loop)
+{
+    g_print ("\nNautilus search engine content finished!\n");
+
+    g_main_loop_quit (loop);
+}
+
+static void
+create_file (const gchar *name,
+             const gchar *contents,
+             gssize       length)
+{
+    g_autofree gchar *path = g_build_filename (test_get_tmp_dir (), name, NULL);
+
+    g_assert_true (g_file_set_contents (path, contents, length, NULL));
+}
+
+static void
+run_search (NautilusSearchEngine *engine,
+            GMainLoop            *loop,
+            const char           *text)
+{
+    g_autoptr (NautilusQuery) query = nautilus_query_new ();
+    g_autoptr (GFile) location = g_file_new_for_path (test_get_tmp_dir ());
+
+    total_hits = 0;
+    g_clear_pointer (&snippet, g_free);
+
+    nautilus_query_set_text (query, text);
+    nautilus_query_set_location (query, location);
+    g_assert_true (nautilus_query_get_search_content (query));
+
+    nautilus_search_engine_start (engine, query);
+
+    g_main_loop_run (loop);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_autoptr (GMainLoop) loop = NULL;
+
+    loop = g_main_loop_new (NULL, FALSE);
+
+    nautilus_ensure_extension_points ();
+    /* Needed for nautilus-query.c.
+     * FIXME: tests are not installed, so the system does not
+     * have the gschema. Installed tests is a long term GNOME goal.
+     */
+    nautilus_global_preferences_init ();
+    g_settings_set_boolean (nautilus_preferences, NAUTILUS_PREFERENCES_FTS_ENABLED, TRUE);
+
+    g_autoptr (NautilusSearchEngine) engine =
+        nautilus_search_engine_new (NAUTILUS_SEARCH_TYPE_CONTENT);
+    g_signal_connect (engine, "hits-added",
+                      G_CALLBACK (hits_added_cb), NULL);
+    g_signal_connect (engine, "search-finished", G_CALLBACK (finished_cb), loop);
+
+    create_file ("notes.txt", "Agenda\nSome notes about the Quarterly Report\n", -1);
+    create_file ("other.txt", "Nothing to see here\n", -1);
+    /* Binary, so not searched */
+    create_file ("report.bin", "\0quarterly report", 17);
+
+    run_search (engine, loop, "quarterly report");
+
+    g_assert_cmpint (total_hits, ==, 1);
+    g_assert_cmpstr (snippet, ==, "Some notes about the <b>Quarterly</b> Report");
+
+    /* A word straddling the boundary of the 64 KiB read chunks, with the
+     * start of its line in the first chunk. */
+    const gsize chunk_size = 64 * 1024;
+    g_autofree char *start_filler = g_strnfill (chunk_size - strlen ("\nbefore stra"), 'x');
+    g_autofree char *end_filler = g_strnfill (chunk_size, 'y');
+    g_autoptr (GString) large = g_string_new (start_filler);
+
+    g_string_append (large, "\nbefore straddling after\n");
+    g_assert_cmpint (strstr (large->str, "straddling") - large->str, ==, chunk_size - strlen ("stra"));
+    g_string_append (large, end_filler);
+    create_file ("large.txt", large->str, large->len);
+
+    run_search (engine, loop, "straddling");
+
+    g_assert_cmpint (total_hits, ==, 1);
+    g_assert_cmpstr (snippet, ==, "before <b>straddling</b> after");
+
+    g_free (snippet);
+    test_clear_tmp_dir ();
+
+    return 0;
+}
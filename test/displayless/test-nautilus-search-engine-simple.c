@@ -8,68 +8,193 @@
 #include <src/nautilus-search-hit.h>
 #include <src/nautilus-search-provider.h>
 
-static guint total_hits = 0;
+#define N_WIDE_DIRECTORIES 200
+#define DEEP_LEVELS 10
+
+typedef struct
+{
+    GMainLoop *loop;
+    /* The text to refine the first search with */
+    const char *refined_text;
+    /* Whether to stop the first search at its first hits */
+    gboolean interrupt;
+    /* Created in an already visited directory before refining */
+    GFile *late_file;
+
+    gboolean refining;
+    GPtrArray *hits;
+    GPtrArray *refined_hits;
+} SearchData;
 
 static void
 hits_added_cb (NautilusSearchEngine *engine,
-               GPtrArray            *hits)
+               GPtrArray            *hits,
+               SearchData           *data)
 {
     g_print ("Hits added for search engine simple!\n");
     for (guint i = 0; i < hits->len; i++)
     {
-        g_print ("Hit %i: %s\n", i, nautilus_search_hit_get_uri (hits->pdata[i]));
-        total_hits += 1;
+        const char *uri = nautilus_search_hit_get_uri (hits->pdata[i]);
+
+        g_print ("Hit %i: %s\n", i, uri);
+        g_ptr_array_add (data->refining ? data->refined_hits : data->hits, g_strdup (uri));
+    }
+
+    if (data->interrupt && !data->refining)
+    {
+        /* Leaves a frontier of unvisited directories for refining */
+        nautilus_search_engine_stop (engine);
     }
 }
 
 static void
-finished_cb (GMainLoop *loop)
+finished_cb (NautilusSearchEngine *engine,
+             SearchData           *data)
 {
     g_print ("\nNautilus search engine simple finished!\n");
 
-    delete_search_file_hierarchy ("simple");
+    if (!data->refining)
+    {
+        g_autoptr (NautilusQuery) query = nautilus_query_new ();
+        g_autoptr (GFile) location = g_file_new_for_path (test_get_tmp_dir ());
+
+        /* A refined search doesn't list the visited directories again. */
+        g_assert_true (g_file_replace_contents (data->late_file, "", 0, NULL, FALSE,
+                                                G_FILE_CREATE_NONE, NULL, NULL, NULL));
 
-    g_main_loop_quit (loop);
+        /* Narrow down the search, which reuses the previous results. */
+        data->refining = TRUE;
+        nautilus_query_set_text (query, data->refined_text);
+        nautilus_query_set_location (query, location);
+        nautilus_search_engine_start (engine, query);
+
+        return;
+    }
+
+    g_main_loop_quit (data->loop);
 }
 
-int
-main (int   argc,
-      char *argv[])
+static gboolean
+hits_contain (GPtrArray *hits,
+              GFile     *file)
 {
-    g_autoptr (GMainLoop) loop = NULL;
-    g_autoptr (NautilusQuery) query = NULL;
-    g_autoptr (GFile) location = NULL;
+    g_autofree char *uri = g_file_get_uri (file);
 
-    loop = g_main_loop_new (NULL, FALSE);
-
-    nautilus_ensure_extension_points ();
-    /* Needed for nautilus-query.c.
-     * FIXME: tests are not installed, so the system does not
-     * have the gschema. Installed tests is a long term GNOME goal.
-     */
-    nautilus_global_preferences_init ();
+    return g_ptr_array_find_with_equal_func (hits, uri, g_str_equal, NULL);
+}
 
+static void
+run_search (SearchData *data,
+            const char *text)
+{
+    g_autoptr (NautilusQuery) query = nautilus_query_new ();
+    g_autoptr (GFile) location = g_file_new_for_path (test_get_tmp_dir ());
     g_autoptr (NautilusSearchEngine) engine =
         nautilus_search_engine_new (NAUTILUS_SEARCH_TYPE_SIMPLE);
-    g_signal_connect (engine, "hits-added",
-                      G_CALLBACK (hits_added_cb), NULL);
-    g_signal_connect_swapped (engine, "search-finished", G_CALLBACK (finished_cb), loop);
 
-    query = nautilus_query_new ();
-    nautilus_query_set_text (query, "engine_simple");
+    data->loop = g_main_loop_new (NULL, FALSE);
+    data->hits = g_ptr_array_new_with_free_func (g_free);
+    data->refined_hits = g_ptr_array_new_with_free_func (g_free);
+
+    g_signal_connect (engine, "hits-added", G_CALLBACK (hits_added_cb), data);
+    g_signal_connect (engine, "search-finished", G_CALLBACK (finished_cb), data);
 
-    location = g_file_new_for_path (test_get_tmp_dir ());
+    nautilus_query_set_text (query, text);
     nautilus_query_set_location (query, location);
+    nautilus_search_engine_start (engine, query);
+
+    g_main_loop_run (data->loop);
+}
+
+static void
+search_data_clear (SearchData *data)
+{
+    g_clear_pointer (&data->loop, g_main_loop_unref);
+    g_clear_object (&data->late_file);
+    g_clear_pointer (&data->hits, g_ptr_array_unref);
+    g_clear_pointer (&data->refined_hits, g_ptr_array_unref);
+}
+
+static void
+test_refine (void)
+{
+    SearchData data = { .refined_text = "engine_simple_d" };
+    g_autoptr (GFile) refined_match = g_file_new_build_filename (test_get_tmp_dir (),
+                                                                 "engine_simple_directory",
+                                                                 NULL);
 
+    data.late_file = g_file_new_build_filename (test_get_tmp_dir (), "engine_simple_d_late", NULL);
     create_search_file_hierarchy ("simple");
 
-    nautilus_search_engine_start (engine, query);
+    run_search (&data, "engine_simple");
+
+    g_assert_cmpint (data.hits->len, ==, 3);
+    g_assert_cmpint (data.refined_hits->len, ==, 1);
+    g_assert_true (hits_contain (data.refined_hits, refined_match));
+    g_assert_false (hits_contain (data.refined_hits, data.late_file));
+
+    g_file_delete (data.late_file, NULL, NULL);
+    delete_search_file_hierarchy ("simple");
+    search_data_clear (&data);
+}
+
+/* The directories left unvisited by an interrupted search are crawled when
+ * refining it, the visited ones are not. */
+static void
+test_refine_frontier (void)
+{
+    SearchData data = { .refined_text = "refine_t", .interrupt = TRUE };
+    g_autoptr (GString) deep_path = g_string_new (test_get_tmp_dir ());
+    g_autoptr (GFile) top_file = g_file_new_build_filename (test_get_tmp_dir (), "refine_top", NULL);
+
+    g_assert_true (g_file_replace_contents (top_file, "", 0, NULL, FALSE,
+                                            G_FILE_CREATE_NONE, NULL, NULL, NULL));
+
+    for (guint i = 0; i < N_WIDE_DIRECTORIES; i++)
+    {
+        g_autofree char *path = g_strdup_printf ("%s/wide/directory_%u", test_get_tmp_dir (), i);
+
+        g_assert_cmpint (g_mkdir_with_parents (path, 0700), ==, 0);
+    }
+
+    g_string_append (deep_path, "/deep");
+    for (guint i = 0; i < DEEP_LEVELS; i++)
+    {
+        g_string_append_printf (deep_path, "/level_%u", i);
+    }
+    g_assert_cmpint (g_mkdir_with_parents (deep_path->str, 0700), ==, 0);
+
+    g_autoptr (GFile) deep_directory = g_file_new_for_path (deep_path->str);
+    g_autoptr (GFile) deep_file = g_file_get_child (deep_directory, "refine_target_deep");
+
+    g_assert_true (g_file_replace_contents (deep_file, "", 0, NULL, FALSE,
+                                            G_FILE_CREATE_NONE, NULL, NULL, NULL));
 
-    g_main_loop_run (loop);
+    data.late_file = g_file_new_build_filename (test_get_tmp_dir (), "refine_target_late", NULL);
 
-    g_assert_cmpint (total_hits, ==, 3);
+    run_search (&data, "refine");
 
+    g_assert_true (hits_contain (data.refined_hits, top_file));
+    g_assert_true (hits_contain (data.refined_hits, deep_file));
+    g_assert_false (hits_contain (data.refined_hits, data.late_file));
+
+    search_data_clear (&data);
     test_clear_tmp_dir ();
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    nautilus_ensure_extension_points ();
+    /* Needed for nautilus-query.c.
+     * FIXME: tests are not installed, so the system does not
+     * have the gschema. Installed tests is a long term GNOME goal.
+     */
+    nautilus_global_preferences_init ();
+
+    test_refine ();
+    test_refine_frontier ();
 
     return 0;
 }
@@ -9,6 +9,7 @@
 #include <src/nautilus-search-provider.h>
 
 static guint total_hits = 0;
+static gboolean last_tier_finished = FALSE;
 
 static void
 hits_added_cb (NautilusSearchEngine *engine,
@@ -22,11 +23,22 @@ hits_added_cb (NautilusSearchEngine *engine,
     }
 }
 
+static void
+tier_finished_cb (NautilusSearchEngine *engine,
+                  gboolean              more_coming)
+{
+    g_assert_false (last_tier_finished);
+
+    last_tier_finished = !more_coming;
+}
+
 static void
 finished_cb (GMainLoop *loop)
 {
     g_print ("\nNautilus search engine finished!\n");
 
+    g_assert_true (last_tier_finished);
+
     delete_search_file_hierarchy ("all_engines");
 
     g_main_loop_quit (loop);
@@ -53,6 +65,8 @@ main (int   argc,
         nautilus_search_engine_new (NAUTILUS_SEARCH_TYPE_ALL);
     g_signal_connect (engine, "hits-added",
                       G_CALLBACK (hits_added_cb), NULL);
+    g_signal_connect (engine, "tier-finished",
+                      G_CALLBACK (tier_finished_cb), NULL);
     g_signal_connect_swapped (engine, "search-finished", G_CALLBACK (finished_cb), loop);
 
     query = nautilus_query_new ();
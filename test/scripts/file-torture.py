@@ -212,6 +212,10 @@ def main ():
     option_parser.add_option ("",
                               "--no-sleep", dest="sleep_enabled", action="store_false", default=True,
                               help="Disable short sleeps between operations.  Will use a lot of CPU!")
+    option_parser.add_option ("-n",
+                              "--count", dest="count",
+                              metavar="NUMBER",
+                              help="Stop after NUMBER operations and report the event rate")
     option_parser.add_option ("-v",
                               "--verbose", dest="verbose", action="store_true", default=False,
                               help="Enable verbose output")
@@ -254,12 +258,21 @@ def main ():
     except:
         pass  # directory exists or cannot be created; ignore
 
-    while True:
+    # Run with --no-sleep and --count to measure how Nautilus copes with
+    # event storms, e.g. the time until the view settles after the run.
+    count = 0
+    start_time = time.time ()
+
+    while not options.count or count < int (options.count):
         op = operations [random_gen.randrange (len (operations))]
-        op ()
+        if op ():
+            count += 1
         if sleep_enabled:
             time.sleep (random_gen.random () / 100)
 
+    elapsed = time.time () - start_time
+    print 'Performed %d operations in %.2f seconds (%.0f operations per second)' % (count, elapsed, count / max (elapsed, 0.001))
+
     return 0
 
 if __name__ == "__main__":